@@ -0,0 +1,64 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "../../hash-table/include/hash-table.h"
+#include "../../linked-list/include/linked-list.h"
+
+#define CACHE_OK			0	/* Operation completed successfully */
+#define CACHE_MEM_ERROR		-1	/* Memory allocation error */
+#define CACHE_SIZE_ERROR	-2	/* Value width, budget or charge is not usable */
+#define CACHE_MISS			-3	/* Key is not in the cache */
+
+#define CACHE_INLINE_KEY	16	/* Keys up to this many bytes are stored in the entry, longer ones are allocated */
+
+typedef enum cache_policy_t {
+	CACHE_LRU,					/* Evict the least recently used entry. Every hit moves its entry to the back of the list */
+	CACHE_CLOCK					/* Evict the oldest entry not hit since the hand last passed it. A hit only sets a flag */
+} cache_policy_t;
+
+typedef void (*cache_evict_t)(const void * key, size_t length, void * value, void * context);
+
+typedef struct cache_options_t {
+	size_t max_entries;			/* Evict once more than this many entries are stored, 0 for no limit */
+	size_t max_bytes;			/* Evict once the entries' charges add up to more than this, 0 for no limit */
+	cache_policy_t policy;		/* Which entry to evict, CACHE_LRU by default */
+	cache_evict_t evict;		/* Called on every entry evicted to stay within budget, before it is freed. May be NULL */
+	void * context;				/* Passed to evict */
+} cache_options_t;
+
+typedef struct cache_stats_t {
+	size_t hits;				/* Lookups that found their key */
+	size_t misses;				/* Lookups that did not */
+	size_t evictions;			/* Entries evicted to stay within budget */
+	size_t entries;				/* Entries currently stored */
+	size_t bytes;				/* The sum of the stored entries' charges */
+} cache_stats_t;
+
+typedef struct cache_t {
+	pthread_mutex_t lock;		/* Guards every field below */
+	table_t * index;			/* Maps each key to its list element */
+	llist_t entries;			/* Entries in eviction order, the next victim at the head */
+	size_t value_width;			/* The size of each value */
+	size_t max_entries;
+	size_t max_bytes;
+	cache_policy_t policy;
+	cache_evict_t evict;
+	void * context;
+	size_t bytes;				/* The sum of the stored entries' charges */
+	size_t hits;
+	size_t misses;
+	size_t evictions;
+} cache_t;
+
+int cache_init(cache_t * cache, size_t value_width, const cache_options_t * options);					/* Initialise a cache, at least one of the budgets must be set */
+int cache_get(cache_t * cache, const void * key, size_t length, void * value);							/* Copy the value stored under a key into value, CACHE_MISS if there is none */
+void * cache_get_ref(cache_t * cache, const void * key, size_t length);									/* As cache_get, returning the stored value in place. Valid until the entry is replaced, deleted or evicted */
+int cache_put(cache_t * cache, const void * key, size_t length, const void * value, size_t charge);	/* Store a value under a key, evicting as needed. A charge of 0 counts the value and key widths */
+int cache_delete(cache_t * cache, const void * key, size_t length);										/* Remove a key without calling evict, CACHE_MISS if it is not stored */
+void cache_stats(cache_t * cache, cache_stats_t * stats);												/* Fill stats with the cache's counters */
+void cache_destroy(cache_t * cache);																	/* Free every entry without calling evict */
+
+#endif
@@ -0,0 +1,317 @@
+/*
+ * Filename:	cache.c
+ * Author:		Jess Turner
+ * Date:		16/10/26
+ * Licence:		GNU GPL V3
+ *
+ * Bounded key/value cache built from a hash table and a doubly linked list
+ *
+ * Every entry lives in one list element holding its charge, its key and its value. The table maps
+ * each key to that element, so finding, moving and removing an entry are all O(1). The list is kept
+ * in eviction order with the next victim at the head and new entries pushed at the tail.
+ *
+ * With CACHE_LRU every hit moves its entry to the tail, so the head is always the least recently
+ * used entry. With CACHE_CLOCK a hit only sets the entry's referenced flag and the list stays in
+ * insertion order. To evict, the head is examined like the hand of a clock: a referenced entry has
+ * its flag cleared and goes to the tail for a second chance, and the first unreferenced entry is the
+ * victim. Read heavy workloads then touch one byte per hit instead of relinking three elements.
+ *
+ * Entries are evicted from the head until the cache is back within both budgets. The evict callback
+ * sees each victim's key and value before it is freed. Deleting, replacing or destroying entries
+ * does not call it.
+ *
+ * Every function takes the cache's lock, so a cache may be shared between threads. Pointers returned
+ * by cache_get_ref are only safe to use while no other thread can evict the entry.
+ *
+ * Return/exit codes:
+ *		CACHE_OK			- The operation completed successfuly
+ *		CACHE_MEM_ERROR		- Memory allocation error
+ *		CACHE_SIZE_ERROR	- Zero value width, no budget or a charge larger than the byte budget
+ *		CACHE_MISS			- The key is not in the cache
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "../include/cache.h"
+
+typedef struct cache_entry_t {
+	size_t charge;					/* What the entry counts against max_bytes */
+	size_t key_length;				/* The length of the key in bytes */
+	int referenced;					/* Set by hits under CACHE_CLOCK, cleared as the hand passes */
+	union {
+		unsigned char bytes[CACHE_INLINE_KEY];	/* Short keys are stored in the entry itself */
+		unsigned char * pointer;	/* Longer keys are allocated separately */
+	} key;
+} cache_entry_t;
+
+#define ENTRY_SIZE ((sizeof(cache_entry_t) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))	/* Offset of the value from the start of its entry */
+
+static inline const unsigned char * entry_key(cache_entry_t * entry)
+{
+	return entry->key_length <= CACHE_INLINE_KEY ? entry->key.bytes : entry->key.pointer;
+}
+
+static inline void * entry_value(cache_entry_t * entry)
+{
+	return (unsigned char *) entry + ENTRY_SIZE;
+}
+
+/* Called with the cache locked. Unlinks and frees an entry, which must already be out of the index */
+static void free_entry(cache_t * cache, llist_element_t * element)
+{
+	cache_entry_t * entry = element->data;
+
+	cache->bytes -= entry->charge;
+
+	if(entry->key_length > CACHE_INLINE_KEY)
+		free(entry->key.pointer);
+
+	llist_remove(element, &cache->entries);
+}
+
+/* Called with the cache locked */
+static llist_element_t * find_element(cache_t * cache, const void * key, size_t length)
+{
+	llist_element_t ** element = htlookup_ref_n(cache->index, key, length);
+
+	return element ? *element : NULL;
+}
+
+/* Called with the cache locked. Records a hit on an entry for the eviction policy */
+static inline void touch_element(cache_t * cache, llist_element_t * element)
+{
+	if(cache->policy == CACHE_CLOCK)
+		((cache_entry_t *) element->data)->referenced = 1;
+	else
+		llist_move_to_back(element, &cache->entries);
+}
+
+/* Called with the cache locked. Returns the head once the hand reaches one that has not been hit */
+static llist_element_t * pick_victim(cache_t * cache)
+{
+	llist_element_t * element = cache->entries.head;
+
+	while(((cache_entry_t *) element->data)->referenced) {
+		((cache_entry_t *) element->data)->referenced = 0;
+		llist_move_to_back(element, &cache->entries);
+		element = cache->entries.head;
+	}
+
+	return element;
+}
+
+/* Called with the cache locked. Evicts from the head until both budgets are met, keeping keep */
+static void evict_entries(cache_t * cache, llist_element_t * keep)
+{
+	while(cache->entries.length > 0 && ((cache->max_entries && (size_t) cache->entries.length > cache->max_entries) || (cache->max_bytes && cache->bytes > cache->max_bytes))) {
+		llist_element_t * element = pick_victim(cache);
+		cache_entry_t * entry = element->data;
+
+		if(element == keep) { /* The new entry survived a full lap, so pass over it once more */
+			llist_move_to_back(element, &cache->entries);
+			element = pick_victim(cache);
+			entry = element->data;
+		}
+
+		if(cache->evict)
+			cache->evict(entry_key(entry), entry->key_length, entry_value(entry), cache->context);
+
+		htdelete_n(cache->index, entry_key(entry), entry->key_length);
+		free_entry(cache, element);
+		cache->evictions++;
+	}
+}
+
+int cache_init(cache_t * cache, size_t value_width, const cache_options_t * options)
+{
+	if(value_width == 0 || !options || (!options->max_entries && !options->max_bytes))
+		return CACHE_SIZE_ERROR;
+
+	if(!(cache->index = malloc(httable_size())))
+		return CACHE_MEM_ERROR;
+
+	if(htinit(cache->index, sizeof(llist_element_t *), DEFAULT_TABLE_SIZE) != TABLE_OK) {
+		free(cache->index);
+		return CACHE_MEM_ERROR;
+	}
+
+	if(llist_init(&cache->entries, ENTRY_SIZE + value_width) != LIST_OK) {
+		htdestroy(cache->index);
+		free(cache->index);
+		return CACHE_MEM_ERROR;
+	}
+
+	cache->value_width	= value_width;
+	cache->max_entries	= options->max_entries;
+	cache->max_bytes	= options->max_bytes;
+	cache->policy		= options->policy;
+	cache->evict		= options->evict;
+	cache->context		= options->context;
+	cache->bytes		= 0;
+	cache->hits			= 0;
+	cache->misses		= 0;
+	cache->evictions	= 0;
+
+	pthread_mutex_init(&cache->lock, NULL);
+
+	return CACHE_OK;
+}
+
+int cache_get(cache_t * cache, const void * key, size_t length, void * value)
+{
+	pthread_mutex_lock(&cache->lock);
+
+	llist_element_t * element = find_element(cache, key, length);
+
+	if(!element) {
+		cache->misses++;
+		pthread_mutex_unlock(&cache->lock);
+		return CACHE_MISS;
+	}
+
+	cache->hits++;
+	touch_element(cache, element);
+
+	if(value)
+		memcpy(value, entry_value(element->data), cache->value_width);
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return CACHE_OK;
+}
+
+void * cache_get_ref(cache_t * cache, const void * key, size_t length)
+{
+	void * value = NULL;
+
+	pthread_mutex_lock(&cache->lock);
+
+	llist_element_t * element = find_element(cache, key, length);
+
+	if(element) {
+		cache->hits++;
+		touch_element(cache, element);
+		value = entry_value(element->data);
+	} else {
+		cache->misses++;
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return value;
+}
+
+int cache_put(cache_t * cache, const void * key, size_t length, const void * value, size_t charge)
+{
+	cache_entry_t * entry;
+
+	if(charge == 0)
+		charge = cache->value_width + length;
+
+	if(cache->max_bytes && charge > cache->max_bytes)
+		return CACHE_SIZE_ERROR;
+
+	pthread_mutex_lock(&cache->lock);
+
+	llist_element_t * element = find_element(cache, key, length);
+
+	if(element) { /* Replace the value in place and count it as a use */
+		entry = element->data;
+		cache->bytes += charge - entry->charge;
+		entry->charge = charge;
+		memcpy(entry_value(entry), value, cache->value_width);
+		touch_element(cache, element);
+	} else {
+		unsigned char * long_key = NULL;
+
+		if(length > CACHE_INLINE_KEY && !(long_key = malloc(length))) {
+			pthread_mutex_unlock(&cache->lock);
+			return CACHE_MEM_ERROR;
+		}
+
+		/* Pushed uninitialised and filled in place, so the value is only copied once */
+		if(!(entry = llist_emplace(&cache->entries))) {
+			free(long_key);
+			pthread_mutex_unlock(&cache->lock);
+			return CACHE_MEM_ERROR;
+		}
+
+		element = cache->entries.tail;
+		entry->charge = charge;
+		entry->key_length = length;
+		entry->referenced = 0;
+
+		if(long_key)
+			entry->key.pointer = long_key;
+
+		memcpy(long_key ? long_key : entry->key.bytes, key, length);
+		memcpy(entry_value(entry), value, cache->value_width);
+
+		cache->bytes += charge; /* Counted first so free_entry can take it back out */
+
+		if(htinsert_n(cache->index, key, length, &element) != TABLE_OK) {
+			free_entry(cache, element);
+			pthread_mutex_unlock(&cache->lock);
+			return CACHE_MEM_ERROR;
+		}
+	}
+
+	evict_entries(cache, element);
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return CACHE_OK;
+}
+
+int cache_delete(cache_t * cache, const void * key, size_t length)
+{
+	pthread_mutex_lock(&cache->lock);
+
+	llist_element_t * element = find_element(cache, key, length);
+
+	if(!element) {
+		pthread_mutex_unlock(&cache->lock);
+		return CACHE_MISS;
+	}
+
+	htdelete_n(cache->index, key, length);
+	free_entry(cache, element);
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return CACHE_OK;
+}
+
+void cache_stats(cache_t * cache, cache_stats_t * stats)
+{
+	pthread_mutex_lock(&cache->lock);
+
+	stats->hits			= cache->hits;
+	stats->misses		= cache->misses;
+	stats->evictions	= cache->evictions;
+	stats->entries		= (size_t) cache->entries.length;
+	stats->bytes		= cache->bytes;
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+void cache_destroy(cache_t * cache)
+{
+	for(llist_element_t * element = cache->entries.head; element != NULL; element = element->next) {
+		cache_entry_t * entry = element->data;
+
+		if(entry->key_length > CACHE_INLINE_KEY)
+			free(entry->key.pointer);
+	}
+
+	llist_destroy(&cache->entries);
+	htdestroy(cache->index);
+	free(cache->index);
+
+	cache->index = NULL;
+	cache->bytes = 0;
+
+	pthread_mutex_destroy(&cache->lock);
+}
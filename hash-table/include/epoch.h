@@ -0,0 +1,35 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define EBR_OK			0	/* Operation completed successfully */
+#define EBR_MEM_ERROR	-1	/* Memory allocation error */
+
+#define EBR_RECLAIM_BATCH (size_t) 64	/* Number of retirements between attempts to advance the epoch */
+
+typedef void (*ebr_reclaim_t)(void * context, void * pointer);	/* Frees a retired pointer once no reader can still hold it */
+
+typedef struct ebr_retired_t {
+	void * pointer;				/* The object waiting to be reclaimed */
+	ebr_reclaim_t reclaim;		/* The function that frees it */
+	size_t epoch;				/* The global epoch at the time it was retired */
+} ebr_retired_t;
+
+typedef struct ebr_limbo_t {
+	pthread_mutex_t lock;		/* Serialises retirements and reclamation */
+	ebr_retired_t * items;		/* Retired objects, ordered by epoch */
+	size_t count;				/* The number of retired objects */
+	size_t allocated;			/* The capacity of items */
+	size_t pending;				/* Retirements since the last reclamation attempt */
+	void * context;				/* Passed to every reclaim function */
+} ebr_limbo_t;
+
+void ebr_enter(void);														/* Begin a read side critical section, these may be nested */
+void ebr_exit(void);														/* End a read side critical section */
+int ebr_limbo_init(ebr_limbo_t * limbo, void * context);					/* Initialise a list of objects waiting for reclamation */
+int ebr_retire(ebr_limbo_t * limbo, void * pointer, ebr_reclaim_t reclaim);	/* Reclaim an unlinked object once every reader that could see it has exited */
+void ebr_limbo_destroy(ebr_limbo_t * limbo);								/* Reclaim everything immediately, no reader may still be active */
+
+#endif
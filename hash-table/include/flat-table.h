@@ -0,0 +1,20 @@
+#ifndef FLAT_TABLE_H
+#define FLAT_TABLE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash-table.h"		/* Shares the TABLE_OK, MEM_ERROR and INVALID_ENTRY return codes with table_t */
+
+#define FLAT_GROUP_WIDTH	(size_t) 8	/* Number of control bytes probed at once */
+#define FLAT_INLINE_NAME	16			/* Keys up to this length are stored inside the slot itself */
+
+typedef struct flat_table_t flat_table_t;
+
+int ftinit(flat_table_t * table, size_t entry_width, size_t slot_count); 	/* Initialise the table data structure */
+int ftinsert(flat_table_t * table, char * entry_name, void * data); 		/* Insert an entry into the table */
+int ftlookup(flat_table_t * table, char * entry_name, void * value);		/* Check if a given key is valid and place the corresponding value into value. If value is NULL it will simply check if the value exists. */
+int ftdelete(flat_table_t * table, char * entry_name);						/* Delete a key and value from the table */
+void ftdestroy(flat_table_t * table);										/* Destroy the table and table metadata */
+
+#endif
@@ -5,18 +5,72 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "hash-functions.h"
+#include "../../pool/include/pool.h"
+
 #define TABLE_OK		0	/* Operation completed successfully */
 #define MEM_ERROR		-1	/* Memory allocation error */
 #define INVALID_ENTRY	-2	/* Key has no corresponding value in the table */
+#define UNSUPPORTED		-3	/* Operation is not available in the table's mode */
+#define IO_ERROR		-4	/* Reading, writing or verifying a table image failed */
 
 #define DEFAULT_TABLE_SIZE (size_t) 1024
+#define DEFAULT_LOAD_FACTOR 1.0
+#define HT_NO_GROWTH -1.0	/* A max_load_factor that disables growth */
+#define DEFAULT_MIGRATE_STEP (size_t) 4
+#define HT_INLINE_KEY 16
+#define HT_LOCK_STRIPES (size_t) 64
+#define HT_STATS_CHAINS 8	/* Chains this long or longer share the last bucket of the histogram reported by htstats */
+#define HT_BUILD_MAX_THREADS 64	/* The most threads htbuild_finish will use */
 
 typedef struct table_t table_t;
 
+typedef struct ht_options_t {
+	double max_load_factor;	/* Average entries per bucket at which the table doubles its bucket count, 0 selects DEFAULT_LOAD_FACTOR and HT_NO_GROWTH disables growth */
+	size_t migrate_step;	/* Number of old buckets moved to the new bucket array by each operation while growing */
+	ht_hash_t hash;			/* Hash function applied to every key, NULL selects hthash_wy */
+	int concurrent;			/* Non-zero makes htinsert, htlookup and htdelete safe to call from several threads at once */
+	void (*destructor)(void * value);	/* Run on a stored value before it is overwritten, deleted or destroyed, may be NULL */
+	pool_t * pool;			/* Pool to allocate entries from, its objects must be at least htnode_size(entry_width) bytes. NULL uses malloc */
+} ht_options_t;
+
+typedef struct ht_stats_t {
+	size_t entry_count;		/* The number of entries stored */
+	size_t bucket_count;	/* The number of buckets, not counting any still being migrated from while the table grows */
+	double load_factor;		/* Average entries per bucket */
+	size_t chain_lengths[HT_STATS_CHAINS];	/* The number of buckets holding each number of entries */
+	size_t max_chain;		/* The longest chain */
+	int counting;			/* Non-zero if the table was built with HT_STATS, otherwise the counters below are always zero */
+	size_t lookups;			/* Lookups since the table was initialised */
+	size_t hits;			/* Lookups that found their key */
+	size_t misses;			/* Lookups that did not */
+	size_t collisions;		/* Entries examined by lookups that held other keys */
+	size_t max_probe;		/* The most entries examined by one lookup */
+} ht_stats_t;
+
 int htinit(table_t * table, size_t entry_width, size_t bucket_count); 	/* Initialise the table data structure */
+int htinit_opts(table_t * table, size_t entry_width, size_t bucket_count, const ht_options_t * options);	/* Initialise the table with explicit growth options, NULL selects the defaults */
+size_t htnode_size(size_t entry_width);								/* The size of one entry and its value, for sizing a pool shared between tables */
+size_t httable_size(void);												/* The size of a table_t, for code that allocates tables through the opaque type */
 int htinsert(table_t * table, char * entry_name, void * data); 			/* Insert an entry into the table */
 int htlookup(table_t * table, char * entry_name, void * value);			/* Check if a given key is valid and place the corresponding value into value. If value is NULL it will simply check if the value exists. */
 int htdelete(table_t * table, char * entry_name);						/* Delete a key and value from the table */
+int htinsert_n(table_t * table, const void * key, size_t length, void * data);		/* Insert an entry under a key of length bytes, which need not be NUL terminated */
+int htlookup_n(table_t * table, const void * key, size_t length, void * value);	/* As htlookup, for a key of length bytes */
+int htdelete_n(table_t * table, const void * key, size_t length);					/* As htdelete, for a key of length bytes */
+void * htlookup_ref(table_t * table, char * entry_name);							/* Return a pointer to the value stored under a key, or NULL. Valid until the key is deleted or the table destroyed */
+void * htlookup_ref_n(table_t * table, const void * key, size_t length);			/* As htlookup_ref, for a key of length bytes */
+int htemplace(table_t * table, char * entry_name, void ** slot);					/* Place a pointer to the value storage for a key in slot for the caller to construct the value in. An existing value is destroyed first */
+int htemplace_n(table_t * table, const void * key, size_t length, void ** slot);	/* As htemplace, for a key of length bytes */
+int htinsert_batch(table_t * table, char ** entry_names, size_t count, void * data);					/* Insert count entries whose values are laid out contiguously in data, stopping at the first failure */
+int htlookup_batch(table_t * table, char ** entry_names, size_t count, void * values, int * results);	/* Look up count keys at once, overlapping their cache misses. Values and per key results are optional, returns INVALID_ENTRY if any key is missing */
+int htbuild_begin(table_t * table, size_t entry_width, size_t expected, const ht_options_t * options);	/* Initialise the table for a bulk build of about expected entries, sizing its buckets once */
+int htbuild_add(table_t * table, char * entry_name, void * data);		/* Add an entry to a bulk build without looking for its key. A key added twice keeps the later value */
+int htbuild_add_n(table_t * table, const void * key, size_t length, void * data);	/* As htbuild_add, for a key of length bytes */
+int htbuild_finish(table_t * table, int nthreads);						/* Link every added entry into the buckets, sharing the partitions of the bucket array between up to nthreads threads. No other function may be used on the table before this except htdestroy */
+int htsave(table_t * table, int fd);									/* Write the table as an image from the start of fd, a regular file open for writing. Tables must use a built in hash function */
+table_t * htopen_mmap(const char * path);								/* Map a saved image read-only and return a table serving lookups from it, NULL if it cannot be opened or fails its checks. htdestroy unmaps and frees it */
+int htstats(table_t * table, ht_stats_t * stats);						/* Report the table's shape and, when built with HT_STATS, its lookup counters */
 void htdestroy(table_t * table);										/* Destroy the table and table metadata */
 
 #endif
\ No newline at end of file
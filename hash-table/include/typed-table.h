@@ -0,0 +1,266 @@
+/*
+ * Filename:	typed-table.h
+ * Author:		Jess Turner
+ * Date:		16/10/26
+ * Licence:		GNU GPL V3
+ *
+ * Macro template for hash tables specialised to one key type and one value type
+ *
+ * HT_DEFINE(name, key_type, value_type, hash_fn, eq_fn) emits a table type name_t and the functions
+ * name_init, name_insert, name_lookup, name_lookup_ref, name_delete and name_destroy. hash_fn takes a
+ * key by value and returns a size_t, and eq_fn takes two keys and returns non-zero if they are equal.
+ * Either may be a function or a function-like macro. Expand it once per type at file scope, without
+ * a trailing semicolon:
+ *
+ *		HT_DEFINE(u64map, uint64_t, uint64_t, htkey_hash_u64, htkey_equal_u64)
+ *
+ * The tables work like table_t: separate chaining with the full hash cached in every entry, power of
+ * two bucket counts and incremental growth once the load factor passes DEFAULT_LOAD_FACTOR. Because
+ * the key and value types are known, entries store them directly, keys are compared with eq_fn
+ * instead of memcmp, values are copied by assignment, and the compiler can inline all of it.
+ * Functions are static inline, so every file that expands the macro gets its own copy.
+ *
+ * The tables are not safe to share between threads and have no destructor, pool or image support.
+ * Use table_t for those.
+ *
+ * Return/exit codes:
+ *		TABLE_OK		- The operation completed successfuly
+ *		MEM_ERROR		- Memory allocation error
+ *		INVALID_ENTRY	- The referenced entry does not exist in the table
+ *
+ */
+
+#ifndef TYPED_TABLE_H
+#define TYPED_TABLE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "hash-table.h"		/* Shares the TABLE_OK, MEM_ERROR and INVALID_ENTRY return codes and the growth defaults with table_t */
+
+static inline size_t htkey_hash_u64(uint64_t key)	/* The MurmurHash3 finaliser, which spreads every input bit over the whole hash */
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+
+	return (size_t) key;
+}
+
+static inline int htkey_equal_u64(uint64_t first, uint64_t second)
+{
+	return first == second;
+}
+
+#define HT_DEFINE(name, key_type, value_type, hash_fn, eq_fn)												\
+																											\
+typedef struct name##_entry_t {																				\
+	size_t hash;						/* The full hash of the key */										\
+	struct name##_entry_t * next;		/* The next entry in the current bucket */							\
+	key_type key;																							\
+	value_type value;																						\
+} name##_entry_t;																							\
+																											\
+typedef struct name##_t {																					\
+	name##_entry_t ** buckets;			/* The list of all current buckets */								\
+	size_t bucket_count;				/* The number of buckets, always a power of two */					\
+	size_t entry_count;					/* The number of entries across both bucket arrays */				\
+	name##_entry_t ** old_buckets;		/* The bucket array being migrated from while the table grows, NULL otherwise */ \
+	size_t old_bucket_count;			/* The number of buckets in old_buckets */							\
+	size_t migrate_index;				/* The next old bucket to be migrated */							\
+} name##_t;																									\
+																											\
+static inline int name##_init(name##_t * table, size_t bucket_count)										\
+{																											\
+	size_t count;																							\
+																											\
+	for(count = 1; count < bucket_count; count <<= 1);														\
+																											\
+	if(!(table->buckets = calloc(count, sizeof(name##_entry_t *))))											\
+		return MEM_ERROR;																					\
+																											\
+	table->bucket_count = count;																			\
+	table->entry_count = 0;																					\
+	table->old_buckets = NULL;																				\
+	table->old_bucket_count = 0;																			\
+	table->migrate_index = 0;																				\
+																											\
+	return TABLE_OK;																						\
+}																											\
+																											\
+static inline void name##_migrate_bucket(name##_t * table, size_t index)									\
+{																											\
+	name##_entry_t * cur_entry = table->old_buckets[index];													\
+																											\
+	table->old_buckets[index] = NULL;																		\
+																											\
+	while(cur_entry) {																						\
+		name##_entry_t * temp = cur_entry->next;															\
+		size_t bucket = cur_entry->hash & (table->bucket_count - 1);										\
+																											\
+		cur_entry->next = table->buckets[bucket];															\
+		table->buckets[bucket] = cur_entry;																	\
+		cur_entry = temp;																					\
+	}																										\
+}																											\
+																											\
+static inline void name##_migrate_step(name##_t * table)													\
+{																											\
+	if(!table->old_buckets)																					\
+		return;																								\
+																											\
+	for(size_t i = 0; i < DEFAULT_MIGRATE_STEP && table->migrate_index < table->old_bucket_count; i++)		\
+		name##_migrate_bucket(table, table->migrate_index++);												\
+																											\
+	if(table->migrate_index == table->old_bucket_count) {													\
+		free(table->old_buckets);																			\
+		table->old_buckets = NULL;																			\
+		table->old_bucket_count = 0;																		\
+	}																										\
+}																											\
+																											\
+static inline void name##_start_growth(name##_t * table)													\
+{																											\
+	name##_entry_t ** buckets;																				\
+																											\
+	if(table->old_buckets || (double) table->entry_count <= DEFAULT_LOAD_FACTOR * (double) table->bucket_count) \
+		return;																								\
+																											\
+	if(!(buckets = calloc(table->bucket_count << 1, sizeof(name##_entry_t *))))								\
+		return; /* Growth is only an optimisation, so carry on with the current buckets */					\
+																											\
+	table->old_buckets = table->buckets;																	\
+	table->old_bucket_count = table->bucket_count;															\
+	table->migrate_index = 0;																				\
+	table->buckets = buckets;																				\
+	table->bucket_count <<= 1;																				\
+}																											\
+																											\
+static inline name##_entry_t * name##_find(name##_t * table, key_type key, size_t hash)						\
+{																											\
+	name##_entry_t * cur_entry = table->buckets[hash & (table->bucket_count - 1)];							\
+																											\
+	while(cur_entry && !(cur_entry->hash == hash && eq_fn(cur_entry->key, key)))							\
+		cur_entry = cur_entry->next;																		\
+																											\
+	if(!cur_entry && table->old_buckets) {																	\
+		cur_entry = table->old_buckets[hash & (table->old_bucket_count - 1)];								\
+																											\
+		while(cur_entry && !(cur_entry->hash == hash && eq_fn(cur_entry->key, key)))						\
+			cur_entry = cur_entry->next;																	\
+	}																										\
+																											\
+	return cur_entry;																						\
+}																											\
+																											\
+static inline int name##_insert(name##_t * table, key_type key, value_type value)							\
+{																											\
+	size_t hash = hash_fn(key);																				\
+																											\
+	name##_migrate_step(table);																				\
+																											\
+	if(table->old_buckets) /* Leaves the key only findable in the current buckets */						\
+		name##_migrate_bucket(table, hash & (table->old_bucket_count - 1));									\
+																											\
+	name##_entry_t ** bucket = &table->buckets[hash & (table->bucket_count - 1)];							\
+	name##_entry_t * cur_entry;																				\
+																											\
+	for(cur_entry = *bucket; cur_entry; cur_entry = cur_entry->next) {										\
+		if(cur_entry->hash == hash && eq_fn(cur_entry->key, key)) {											\
+			cur_entry->value = value;																		\
+			return TABLE_OK;																				\
+		}																									\
+	}																										\
+																											\
+	if(!(cur_entry = malloc(sizeof(name##_entry_t))))														\
+		return MEM_ERROR;																					\
+																											\
+	cur_entry->hash = hash;																					\
+	cur_entry->key = key;																					\
+	cur_entry->value = value;																				\
+	cur_entry->next = *bucket;																				\
+	*bucket = cur_entry;																					\
+	table->entry_count++;																					\
+																											\
+	name##_start_growth(table);																				\
+																											\
+	return TABLE_OK;																						\
+}																											\
+																											\
+static inline int name##_lookup(name##_t * table, key_type key, value_type * value)							\
+{																											\
+	name##_migrate_step(table);																				\
+																											\
+	name##_entry_t * cur_entry = name##_find(table, key, hash_fn(key));										\
+																											\
+	if(!cur_entry)																							\
+		return INVALID_ENTRY;																				\
+																											\
+	if(value)																								\
+		*value = cur_entry->value;																			\
+																											\
+	return TABLE_OK;																						\
+}																											\
+																											\
+static inline value_type * name##_lookup_ref(name##_t * table, key_type key)								\
+{																											\
+	name##_migrate_step(table);																				\
+																											\
+	name##_entry_t * cur_entry = name##_find(table, key, hash_fn(key));										\
+																											\
+	return cur_entry ? &cur_entry->value : NULL;															\
+}																											\
+																											\
+static inline int name##_delete(name##_t * table, key_type key)												\
+{																											\
+	size_t hash = hash_fn(key);																				\
+																											\
+	name##_migrate_step(table);																				\
+																											\
+	if(table->old_buckets)																					\
+		name##_migrate_bucket(table, hash & (table->old_bucket_count - 1));									\
+																											\
+	name##_entry_t ** link = &table->buckets[hash & (table->bucket_count - 1)];								\
+																											\
+	while(*link && !((*link)->hash == hash && eq_fn((*link)->key, key)))									\
+		link = &(*link)->next;																				\
+																											\
+	if(!*link)																								\
+		return INVALID_ENTRY;																				\
+																											\
+	name##_entry_t * cur_entry = *link;																		\
+																											\
+	*link = cur_entry->next;																				\
+	free(cur_entry);																						\
+	table->entry_count--;																					\
+																											\
+	return TABLE_OK;																						\
+}																											\
+																											\
+static inline void name##_destroy(name##_t * table)															\
+{																											\
+	name##_entry_t ** arrays[] = { table->buckets, table->old_buckets };									\
+	size_t counts[] = { table->bucket_count, table->old_bucket_count };										\
+																											\
+	for(size_t a = 0; a < 2; a++) {																			\
+		for(size_t i = 0; arrays[a] && i < counts[a]; i++) {												\
+			name##_entry_t * cur_entry = arrays[a][i];														\
+																											\
+			while(cur_entry) {																				\
+				name##_entry_t * temp = cur_entry->next;													\
+				free(cur_entry);																			\
+				cur_entry = temp;																			\
+			}																								\
+		}																									\
+																											\
+		free(arrays[a]);																					\
+	}																										\
+																											\
+	table->buckets = NULL;																					\
+	table->old_buckets = NULL;																				\
+	table->entry_count = 0;																					\
+}
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Filename:	epoch.c
+ * Author:		Jess Turner
+ * Date:		16/10/26
+ * Licence:		GNU GPL V3
+ *
+ * Epoch based reclamation for structures with lock-free readers
+ *
+ * Readers announce the global epoch they observed while inside ebr_enter()/ebr_exit(). The
+ * global epoch only advances once every active reader has observed the current one, so an object
+ * unlinked and retired in epoch e cannot be reached by any reader once the epoch reaches e + 2.
+ * Writers hand unlinked objects to a limbo list with ebr_retire() and they are freed from there.
+ *
+ * Thread records are registered on first use, reused once their thread exits and never freed.
+ *
+ * Return/exit codes:
+ *		EBR_OK			- The operation completed successfuly
+ *		EBR_MEM_ERROR	- Memory allocation error
+ *
+ */
+
+#include <sched.h>
+#include <string.h>
+
+#include "../include/epoch.h"
+
+#define CACHE_LINE 64
+
+typedef struct ebr_thread_t {
+	_Alignas(CACHE_LINE) size_t state;	/* (epoch << 1) | 1 while the thread is inside a critical section, 0 otherwise */
+	size_t depth;						/* The nesting depth of ebr_enter() calls */
+	int in_use;							/* Whether the record belongs to a running thread */
+	struct ebr_thread_t * next;			/* The next record in the global list */
+} ebr_thread_t;
+
+static size_t global_epoch = 1;
+static ebr_thread_t * thread_list = NULL;
+
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+static _Thread_local ebr_thread_t * self = NULL;
+
+static void release_thread(void * record)
+{
+	ebr_thread_t * thread = record;
+
+	__atomic_store_n(&thread->state, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&thread->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void create_thread_key(void)
+{
+	pthread_key_create(&thread_key, release_thread);
+}
+
+static ebr_thread_t * register_thread(void)
+{
+	ebr_thread_t * thread;
+
+	pthread_once(&thread_key_once, create_thread_key);
+
+	for(thread = __atomic_load_n(&thread_list, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+		int expected = 0;
+
+		if(__atomic_compare_exchange_n(&thread->in_use, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+			break;
+	}
+
+	if(!thread) {
+		if(!(thread = aligned_alloc(CACHE_LINE, sizeof(ebr_thread_t))))
+			abort(); /* Readers have no way to report failure and cannot proceed unregistered */
+
+		memset(thread, 0, sizeof(ebr_thread_t));
+		thread->in_use = 1;
+		thread->next = __atomic_load_n(&thread_list, __ATOMIC_RELAXED);
+
+		while(!__atomic_compare_exchange_n(&thread_list, &thread->next, thread, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+
+	pthread_setspecific(thread_key, thread);
+
+	return self = thread;
+}
+
+void ebr_enter(void)
+{
+	ebr_thread_t * thread = self ? self : register_thread();
+
+	if(thread->depth++)
+		return;
+
+	__atomic_store_n(&thread->state, (__atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE) << 1) | 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST); /* The announcement must be visible before any shared pointer is read */
+}
+
+void ebr_exit(void)
+{
+	if(--self->depth)
+		return;
+
+	__atomic_store_n(&self->state, 0, __ATOMIC_RELEASE);
+}
+
+static size_t try_advance(void)
+{
+	size_t epoch = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	for(ebr_thread_t * thread = __atomic_load_n(&thread_list, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+		size_t state = __atomic_load_n(&thread->state, __ATOMIC_ACQUIRE);
+
+		if((state & 1) && (state >> 1) != epoch)
+			return epoch;
+	}
+
+	if(__atomic_compare_exchange_n(&global_epoch, &epoch, epoch + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return epoch + 1;
+
+	return epoch;
+}
+
+static void reclaim_expired(ebr_limbo_t * limbo, size_t epoch)
+{
+	size_t expired = 0;
+
+	while(expired < limbo->count && limbo->items[expired].epoch + 2 <= epoch) {
+		limbo->items[expired].reclaim(limbo->context, limbo->items[expired].pointer);
+		expired++;
+	}
+
+	memmove(limbo->items, limbo->items + expired, (limbo->count - expired) * sizeof(ebr_retired_t));
+	limbo->count -= expired;
+}
+
+int ebr_limbo_init(ebr_limbo_t * limbo, void * context)
+{
+	limbo->items = NULL;
+	limbo->count = 0;
+	limbo->allocated = 0;
+	limbo->pending = 0;
+	limbo->context = context;
+
+	pthread_mutex_init(&limbo->lock, NULL);
+
+	return EBR_OK;
+}
+
+int ebr_retire(ebr_limbo_t * limbo, void * pointer, ebr_reclaim_t reclaim)
+{
+	pthread_mutex_lock(&limbo->lock);
+
+	if(limbo->count == limbo->allocated) {
+		size_t allocated = limbo->allocated ? limbo->allocated << 1 : EBR_RECLAIM_BATCH;
+		ebr_retired_t * items = realloc(limbo->items, allocated * sizeof(ebr_retired_t));
+
+		if(!items) { /* Fall back to waiting out two epochs, which is slow but never leaks or frees early */
+			size_t target = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE) + 2;
+
+			while(try_advance() < target)
+				sched_yield();
+
+			reclaim(limbo->context, pointer);
+			reclaim_expired(limbo, target);
+			pthread_mutex_unlock(&limbo->lock);
+
+			return EBR_OK;
+		}
+
+		limbo->items = items;
+		limbo->allocated = allocated;
+	}
+
+	limbo->items[limbo->count].pointer = pointer;
+	limbo->items[limbo->count].reclaim = reclaim;
+	limbo->items[limbo->count].epoch = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+	limbo->count++;
+
+	if(++limbo->pending >= EBR_RECLAIM_BATCH) {
+		limbo->pending = 0;
+		reclaim_expired(limbo, try_advance());
+	}
+
+	pthread_mutex_unlock(&limbo->lock);
+
+	return EBR_OK;
+}
+
+void ebr_limbo_destroy(ebr_limbo_t * limbo)
+{
+	for(size_t i = 0; i < limbo->count; i++)
+		limbo->items[i].reclaim(limbo->context, limbo->items[i].pointer);
+
+	free(limbo->items);
+
+	limbo->items = NULL;
+	limbo->count = 0;
+	limbo->allocated = 0;
+
+	pthread_mutex_destroy(&limbo->lock);
+}
@@ -0,0 +1,335 @@
+/*
+ * Filename:	flat-table.c
+ * Author:		Jess Turner
+ * Date:		16/10/26
+ * Licence:		GNU GPL V3
+ *
+ * Open addressing counterpart to hash-table.c with the same interface contract
+ *
+ * Every slot has a one byte control code holding either EMPTY, DELETED or the low 7 bits of the
+ * key's hash. Lookups scan the control bytes a group at a time and only touch a slot when its
+ * control byte matches, so a typical lookup costs one miss for the control group and one for the
+ * slot. Slots are laid out in a single flat array and hold the full hash, the key (inline when it
+ * is short enough) and the value.
+ *
+ * Return/exit codes:
+ *		TABLE_OK		- The operation completed successfuly
+ *		MEM_ERROR		- Memory allocation error
+ *		INVALID_ENTRY	- The referenced entry does not exist in the table
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "../include/flat-table.h"
+
+#define CTRL_EMPTY		((signed char) -128)	/* 0b10000000 */
+#define CTRL_DELETED	((signed char) -2)		/* 0b11111110 */
+
+#define GROUP_LSBS		(uint64_t) 0x0101010101010101ULL
+#define GROUP_MSBS		(uint64_t) 0x8080808080808080ULL
+
+typedef struct flat_slot_t {
+	size_t hash;							/* The full hash of the key, compared before the key itself */
+	size_t name_length;						/* The length of the key, excluding the terminator */
+	union {
+		char inline_name[FLAT_INLINE_NAME];	/* Short keys are stored in the slot without a terminator */
+		char * name;						/* Longer keys are allocated separately */
+	} key;
+} flat_slot_t;								/* Followed in memory by entry_width bytes of value */
+
+typedef struct flat_table_t {
+	signed char * ctrl;		/* One control byte per slot, followed by FLAT_GROUP_WIDTH mirrored bytes */
+	unsigned char * slots;	/* The flat array of slots */
+	size_t capacity;		/* The number of slots, always a power of two */
+	size_t slot_width;		/* The size of a slot including its value */
+	size_t entry_width;		/* The size of each value in the table */
+	size_t size;			/* The number of live entries */
+	size_t growth_left;		/* The number of empty slots that may be filled before the table must grow */
+} flat_table_t;
+
+static inline signed char h2(size_t hash)
+{
+	return (signed char) (hash & 0x7F);
+}
+
+static inline size_t h1(size_t hash)
+{
+	return hash >> 7;
+}
+
+static inline uint64_t load_group(const signed char * ctrl)
+{
+	uint64_t group;
+
+	memcpy(&group, ctrl, sizeof(group));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	group = __builtin_bswap64(group);
+#endif
+
+	return group;
+}
+
+static inline uint64_t match_hash(uint64_t group, signed char hash)
+{
+	uint64_t x = group ^ (GROUP_LSBS * (unsigned char) hash);
+
+	return (x - GROUP_LSBS) & ~x & GROUP_MSBS; /* May report false positives, which are rejected by the full hash check */
+}
+
+static inline uint64_t match_empty(uint64_t group)
+{
+	return group & ~(group << 6) & GROUP_MSBS;
+}
+
+static inline uint64_t match_empty_or_deleted(uint64_t group)
+{
+	return group & ~(group << 7) & GROUP_MSBS;
+}
+
+static inline size_t lowest_match(uint64_t mask)
+{
+	return (size_t) __builtin_ctzll(mask) >> 3;
+}
+
+static inline flat_slot_t * get_slot(flat_table_t * table, size_t index)
+{
+	return (flat_slot_t *) (table->slots + index * table->slot_width);
+}
+
+static inline void * slot_data(flat_slot_t * slot)
+{
+	return (unsigned char *) slot + sizeof(flat_slot_t);
+}
+
+static inline const char * slot_name(flat_slot_t * slot)
+{
+	return slot->name_length <= FLAT_INLINE_NAME ? slot->key.inline_name : slot->key.name;
+}
+
+static inline void set_ctrl(flat_table_t * table, size_t index, signed char value)
+{
+	table->ctrl[index] = value;
+
+	if(index < FLAT_GROUP_WIDTH)
+		table->ctrl[table->capacity + index] = value;
+}
+
+static inline size_t max_load(size_t capacity)
+{
+	return capacity - capacity / 8;
+}
+
+static size_t find_slot(flat_table_t * table, const char * entry_name, size_t length, size_t hash)
+{
+	size_t mask = table->capacity - 1;
+	size_t pos = h1(hash) & mask;
+
+	for(size_t step = FLAT_GROUP_WIDTH; ; step += FLAT_GROUP_WIDTH) {
+		uint64_t group = load_group(table->ctrl + pos);
+
+		for(uint64_t match = match_hash(group, h2(hash)); match; match &= match - 1) {
+			size_t index = (pos + lowest_match(match)) & mask;
+			flat_slot_t * slot = get_slot(table, index);
+
+			if(slot->hash == hash && slot->name_length == length && !memcmp(slot_name(slot), entry_name, length))
+				return index;
+		}
+
+		if(match_empty(group))
+			return table->capacity;
+
+		pos = (pos + step) & mask;
+	}
+}
+
+static size_t find_free_slot(flat_table_t * table, size_t hash)
+{
+	size_t mask = table->capacity - 1;
+	size_t pos = h1(hash) & mask;
+
+	for(size_t step = FLAT_GROUP_WIDTH; ; step += FLAT_GROUP_WIDTH) {
+		uint64_t match = match_empty_or_deleted(load_group(table->ctrl + pos));
+
+		if(match)
+			return (pos + lowest_match(match)) & mask;
+
+		pos = (pos + step) & mask;
+	}
+}
+
+static int alloc_slots(flat_table_t * table, size_t capacity)
+{
+	if(!(table->ctrl = malloc(capacity + FLAT_GROUP_WIDTH)))
+		return MEM_ERROR;
+
+	if(!(table->slots = malloc(capacity * table->slot_width))) {
+		free(table->ctrl);
+		return MEM_ERROR;
+	}
+
+	memset(table->ctrl, CTRL_EMPTY, capacity + FLAT_GROUP_WIDTH);
+
+	table->capacity = capacity;
+	table->growth_left = max_load(capacity) - table->size;
+
+	return TABLE_OK;
+}
+
+static int resize(flat_table_t * table)
+{
+	signed char * old_ctrl = table->ctrl;
+	unsigned char * old_slots = table->slots;
+	size_t old_capacity = table->capacity;
+	size_t capacity = old_capacity;
+
+	if(table->size + 1 > max_load(old_capacity) / 2) /* Otherwise the table is mostly tombstones and a same size rehash clears them */
+		capacity <<= 1;
+
+	if(alloc_slots(table, capacity) != TABLE_OK) {
+		table->ctrl = old_ctrl;
+		table->slots = old_slots;
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < old_capacity; i++) {
+		if(old_ctrl[i] < 0)
+			continue;
+
+		flat_slot_t * old_slot = (flat_slot_t *) (old_slots + i * table->slot_width);
+		size_t index = find_free_slot(table, old_slot->hash);
+
+		set_ctrl(table, index, h2(old_slot->hash));
+		memcpy(get_slot(table, index), old_slot, table->slot_width);
+	}
+
+	free(old_ctrl);
+	free(old_slots);
+
+	return TABLE_OK;
+}
+
+int ftinit(flat_table_t * table, size_t entry_width, size_t slot_count)
+{
+	size_t capacity = FLAT_GROUP_WIDTH;
+
+	while(capacity < slot_count)
+		capacity <<= 1;
+
+	table->entry_width = entry_width;
+	table->slot_width = (sizeof(flat_slot_t) + entry_width + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+	table->size = 0;
+
+	return alloc_slots(table, capacity);
+}
+
+int ftinsert(flat_table_t * table, char * entry_name, void * data)
+{
+	size_t length = strlen(entry_name);
+	size_t hash = hthash_wy(entry_name, length);
+	size_t index = find_slot(table, entry_name, length, hash);
+	flat_slot_t * slot;
+
+	if(index != table->capacity) {
+		memcpy(slot_data(get_slot(table, index)), data, table->entry_width);
+		return TABLE_OK;
+	}
+
+	index = find_free_slot(table, hash);
+
+	if(table->growth_left == 0 && table->ctrl[index] != CTRL_DELETED) {
+		if(resize(table) != TABLE_OK)
+			return MEM_ERROR;
+
+		index = find_free_slot(table, hash);
+	}
+
+	slot = get_slot(table, index);
+
+	if(length > FLAT_INLINE_NAME) {
+		if(!(slot->key.name = malloc(length)))
+			return MEM_ERROR;
+
+		memcpy(slot->key.name, entry_name, length);
+	} else {
+		memcpy(slot->key.inline_name, entry_name, length);
+	}
+
+	slot->hash = hash;
+	slot->name_length = length;
+	memcpy(slot_data(slot), data, table->entry_width);
+
+	if(table->ctrl[index] == CTRL_EMPTY)
+		table->growth_left--;
+
+	set_ctrl(table, index, h2(hash));
+	table->size++;
+
+	return TABLE_OK;
+}
+
+int ftlookup(flat_table_t * table, char * entry_name, void * value)
+{
+	size_t length = strlen(entry_name);
+	size_t hash = hthash_wy(entry_name, length);
+	size_t index = find_slot(table, entry_name, length, hash);
+
+	if(index == table->capacity)
+		return INVALID_ENTRY;
+
+	if(value)
+		memcpy(value, slot_data(get_slot(table, index)), table->entry_width);
+
+	return TABLE_OK;
+}
+
+int ftdelete(flat_table_t * table, char * entry_name)
+{
+	size_t length = strlen(entry_name);
+	size_t hash = hthash_wy(entry_name, length);
+	size_t index = find_slot(table, entry_name, length, hash);
+	size_t mask = table->capacity - 1;
+	flat_slot_t * slot;
+
+	if(index == table->capacity)
+		return INVALID_ENTRY;
+
+	slot = get_slot(table, index);
+
+	if(slot->name_length > FLAT_INLINE_NAME)
+		free(slot->key.name);
+
+	uint64_t empty_before = match_empty(load_group(table->ctrl + ((index - FLAT_GROUP_WIDTH) & mask)));
+	uint64_t empty_after = match_empty(load_group(table->ctrl + index));
+
+	/* If no probe window of a full group can have spanned this slot, no lookup ever continued past it and it can become empty again */
+	if(empty_before && empty_after && ((size_t) __builtin_clzll(empty_before) >> 3) + lowest_match(empty_after) < FLAT_GROUP_WIDTH) {
+		set_ctrl(table, index, CTRL_EMPTY);
+		table->growth_left++;
+	} else {
+		set_ctrl(table, index, CTRL_DELETED);
+	}
+
+	table->size--;
+
+	return TABLE_OK;
+}
+
+void ftdestroy(flat_table_t * table)
+{
+	for(size_t i = 0; i < table->capacity; i++) {
+		flat_slot_t * slot = get_slot(table, i);
+
+		if(table->ctrl[i] >= 0 && slot->name_length > FLAT_INLINE_NAME)
+			free(slot->key.name);
+	}
+
+	free(table->ctrl);
+	free(table->slots);
+
+	table->capacity = 0;
+	table->size = 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * Filename:	hash-functions.c
+ * Author:		Jess Turner
+ * Date:		16/10/26
+ * Licence:		GNU GPL V3
+ *
+ * Built in hash functions for the hash tables, all sharing the ht_hash_t signature
+ *
+ * hthash_wy follows the structure of wyhash: keys are read 8 bytes at a time and folded with a
+ * 64x64->128 bit multiply, so long keys cost roughly one multiply per 16 bytes instead of one
+ * dependent step per byte.
+ *
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/hash-functions.h"
+
+#define WY_SECRET_0 0xa0761d6478bd642fULL
+#define WY_SECRET_1 0xe7037ed1a0b428dbULL
+#define WY_SECRET_2 0x8ebc6af09c88c6e3ULL
+#define WY_SECRET_3 0x589965cc75374cc3ULL
+
+static inline void wymum(uint64_t * a, uint64_t * b)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 product = (unsigned __int128) *a * *b;
+
+	*a = (uint64_t) product;
+	*b = (uint64_t) (product >> 64);
+#else
+	uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+	uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	uint64_t t = rl + (rm0 << 32);
+	uint64_t carry = t < rl;
+	uint64_t lo = t + (rm1 << 32);
+
+	carry += lo < t;
+	*a = lo;
+	*b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+}
+
+static inline uint64_t wymix(uint64_t a, uint64_t b)
+{
+	wymum(&a, &b);
+
+	return a ^ b;
+}
+
+static inline uint64_t wyr8(const unsigned char * p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap64(v);
+#endif
+
+	return v;
+}
+
+static inline uint64_t wyr4(const unsigned char * p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	v = __builtin_bswap32(v);
+#endif
+
+	return v;
+}
+
+static inline uint64_t wyr3(const unsigned char * p, size_t length)
+{
+	return ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8) | p[length - 1];
+}
+
+size_t hthash_djb2(const void * key, size_t length)
+{
+	const unsigned char * str = key;
+	size_t hash = 5381;
+
+	while(length--) /* DJB hash algorithm */
+		hash = ((hash << 5) + hash) + *str++;
+
+	return hash;
+}
+
+size_t hthash_wy(const void * key, size_t length)
+{
+	const unsigned char * p = key;
+	uint64_t seed = wymix(WY_SECRET_0, WY_SECRET_1);
+	uint64_t a, b;
+
+	if(length <= 16) {
+		if(length >= 4) {
+			a = (wyr4(p) << 32) | wyr4(p + ((length >> 3) << 2));
+			b = (wyr4(p + length - 4) << 32) | wyr4(p + length - 4 - ((length >> 3) << 2));
+		} else if(length > 0) {
+			a = wyr3(p, length);
+			b = 0;
+		} else {
+			a = b = 0;
+		}
+	} else {
+		size_t i = length;
+
+		if(i > 48) {
+			uint64_t see1 = seed, see2 = seed;
+
+			do {
+				seed = wymix(wyr8(p) ^ WY_SECRET_1, wyr8(p + 8) ^ seed);
+				see1 = wymix(wyr8(p + 16) ^ WY_SECRET_2, wyr8(p + 24) ^ see1);
+				see2 = wymix(wyr8(p + 32) ^ WY_SECRET_3, wyr8(p + 40) ^ see2);
+				p += 48;
+				i -= 48;
+			} while(i > 48);
+
+			seed ^= see1 ^ see2;
+		}
+
+		while(i > 16) {
+			seed = wymix(wyr8(p) ^ WY_SECRET_1, wyr8(p + 8) ^ seed);
+			p += 16;
+			i -= 16;
+		}
+
+		a = wyr8(p + i - 16);
+		b = wyr8(p + i - 8);
+	}
+
+	a ^= WY_SECRET_1;
+	b ^= seed;
+	wymum(&a, &b);
+
+	return (size_t) wymix(a ^ WY_SECRET_0 ^ length, b ^ WY_SECRET_1);
+}
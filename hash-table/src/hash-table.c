@@ -6,45 +6,295 @@
  *
  * Library for a fully generic hash table
  *
+ * Once the average chain length passes the load factor the bucket count is doubled. The old buckets
+ * are kept alongside the new ones and every operation migrates a few of them, so no single call pays
+ * for rehashing the whole table.
+ *
+ * Each entry caches the full hash of its key, so chain walks and migrations only touch the key
+ * itself when the hashes match. Power of two bucket counts are reduced with a mask instead of a
+ * modulo.
+ *
+ * Keys are arbitrary byte strings of up to ENTRY_MAX_KEY bytes. Keys up to HT_INLINE_KEY bytes are
+ * stored inside the entry and longer ones are bump allocated from a list of shared key chunks. A
+ * chunk is released once every key allocated from it has been deleted.
+ *
+ * Tables initialised with the concurrent option may be shared between threads. Writers take one of
+ * HT_LOCK_STRIPES striped locks, chosen by the low bits of the key's hash, and bump the stripe's
+ * sequence count around every change. Readers take no locks: they read the sequence count, walk the
+ * chain and retry if the count changed. Deleted entries and replaced bucket arrays are freed through
+ * epoch based reclamation, so a reader never follows a pointer into freed memory.
+ *
+ * htlookup_ref and htemplace hand out pointers to the value storage inside an entry so large values
+ * can be read, updated or constructed without a copy. Values never move when the table grows, so a
+ * pointer stays valid until its key is deleted. Concurrent tables cannot give these guarantees to
+ * other threads and do not support them. An optional destructor is run on every value before it is
+ * overwritten, deleted or freed with the table.
+ *
+ * Each entry and its value share one allocation. Tables given a pool in their options take entries
+ * from it instead of malloc, and a pool may be shared by any tables whose entries fit in it.
+ *
+ * htbuild_begin, htbuild_add and htbuild_finish fill a new table in bulk. The buckets are sized once
+ * for the expected count, entries are copied into a large arena grouped by the part of the bucket
+ * array they hash to instead of being allocated one at a time, and each part can be linked by a
+ * different thread. See the bulk building section below.
+ *
+ * htsave writes a table out as a relocatable image and htopen_mmap maps one back read-only. The
+ * image holds every entry grouped by bucket, with each bucket found through an array of file offsets
+ * instead of pointers, so lookups run straight from the mapping with nothing to deserialise and any
+ * number of processes share the same page cache. Mapped tables are read-only: inserts, deletes and
+ * emplaces return UNSUPPORTED and htlookup_ref points into the read-only mapping. Opening an image
+ * verifies its checksums, which reads it through once. See the image section below for the layout.
+ *
+ * htstats walks the buckets to report the table's shape: its entry count, load factor and a histogram
+ * of chain lengths. Building with HT_STATS defined also counts every lookup, hit, miss and collision,
+ * where a collision is an entry a lookup examined that held a different key, and the most entries any
+ * one lookup examined. Without HT_STATS the counting code is not compiled at all and those fields
+ * read zero. The counters are shared atomics, so enabling them adds contention to concurrent tables.
+ *
  * Return/exit codes:
  *		TABLE_OK		- The operation completed successfuly
  *		MEM_ERROR		- Memory allocation error
  *		INVALID_ENTRY	- The referenced entry does not exist in the table
+ *		UNSUPPORTED		- The operation is not available for concurrent or mapped tables, or an image cannot record the table's hash
+ *		IO_ERROR		- Reading, writing or verifying a table image failed
  *
  *	Future:
  *		- Do more comprehensive testing to check the table works under high loads and in edge cases
- *		- Add thread saftey
  *
  */
 
 #include <string.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "../include/hash-table.h"
+#include "../include/epoch.h"
+
+#define KEY_CHUNK_SIZE (size_t) 65536
+#define BATCH_WINDOW (size_t) 16
+#define CACHE_LINE 64
+#define BUILD_OVERFLOW_ENTRIES (size_t) 1024	/* The entries held by the first overflow arena of a bulk build */
+#define BUILD_PARTITION_BUCKETS (size_t) 16384	/* Buckets in one partition of a bulk build, few enough for its part of the bucket array to stay in cache */
+#define BUILD_PARALLEL_MIN (size_t) 16384		/* The fewest entries per thread worth starting a thread for */
+#define BUILD_MAPPED_ARENA (size_t) 2097152		/* Arenas this large are mapped directly so they can be backed by huge pages */
+
+#define LOAD(x)			__atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define STORE(x, value)	__atomic_store_n(&(x), (value), __ATOMIC_RELEASE)
+
+#ifdef HT_STATS
+#define STATS(...) __VA_ARGS__
+#else
+#define STATS(...)
+#endif
+
+typedef struct key_chunk_t {
+	struct key_chunk_t * prev;	/* The chunk allocated after this one */
+	struct key_chunk_t * next;	/* The chunk allocated before this one */
+	size_t size;				/* The number of key bytes the chunk can hold */
+	size_t used;				/* The number of key bytes handed out so far */
+	size_t live;				/* The number of stored keys that still point into the chunk */
+	unsigned char bytes[];		/* The key bytes themselves */
+} key_chunk_t;
 
 typedef struct entry_t {
-	void * data;			/* The value corresponding to the key */
-	char * name;			/* The full name of the key, stored to avoid issues with hash collisions */
-	struct entry_t * next;	/* The next entry in the current bucket */
+	size_t hash;							/* The full hash of the key */
+	uint32_t key_length;					/* The length of the key in bytes, at most ENTRY_MAX_KEY */
+	uint32_t in_arena;						/* Non-zero for entries placed by the bulk builder, which are freed with their arena */
+	union {
+		unsigned char inline_key[HT_INLINE_KEY];	/* Short keys are stored in the entry itself */
+		struct {
+			unsigned char * bytes;			/* Longer keys are stored in a key chunk */
+			key_chunk_t * chunk;			/* The chunk holding the key */
+		} arena;
+	} key;									/* The full key, stored to avoid issues with hash collisions */
+	void * data;							/* The value corresponding to the key */
+	struct entry_t * next;					/* The next entry in the current bucket */
 } entry_t;
 
+#define ENTRY_SIZE ((sizeof(entry_t) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))	/* Offset of the value from the start of its entry */
+#define ENTRY_MAX_KEY (size_t) UINT32_MAX	/* The longest key an entry can hold */
+
+typedef struct entry_arena_t {
+	struct entry_arena_t * next;	/* The arena allocated after this one */
+	size_t size;					/* The number of bytes of entries the arena can hold */
+	size_t used;					/* The number of bytes handed out so far, only tracked for overflow arenas */
+	int mapped;						/* Non-zero if the arena was mapped rather than allocated with malloc */
+	_Alignas(max_align_t) unsigned char bytes[];	/* The entries and their values */
+} entry_arena_t;
+
+typedef struct ht_build_t {
+	size_t stride;			/* The bytes each entry and its value take in an arena */
+	size_t partitions;		/* The number of partitions, each with a region of the first arena */
+	size_t region;			/* The number of entries one region holds */
+	size_t count;			/* The number of entries added so far */
+	entry_arena_t * last;	/* The newest arena, the first until a region overflows */
+	size_t filled[];		/* The number of entries added to each region */
+} ht_build_t;
+
+typedef struct ht_stripe_t {
+	_Alignas(CACHE_LINE) pthread_mutex_t lock;	/* Held by writers changing any bucket in the stripe */
+	size_t sequence;							/* Odd while a writer is changing the stripe */
+} ht_stripe_t;
+
+typedef struct ht_sync_t {
+	ht_stripe_t stripes[HT_LOCK_STRIPES];	/* Bucket i belongs to stripe i % HT_LOCK_STRIPES */
+	pthread_mutex_t resize_lock;			/* Held while starting, stepping or finishing growth */
+	pthread_mutex_t key_lock;				/* Protects the key chunks */
+	ebr_limbo_t limbo;						/* Entries and bucket arrays waiting for readers to move on */
+} ht_sync_t;
+
+typedef struct ht_counters_t {
+	size_t lookups;							/* Lookups of any kind */
+	size_t hits;							/* Lookups that found their key */
+	size_t misses;							/* Lookups that did not */
+	size_t collisions;						/* Entries examined by lookups that held other keys */
+	size_t max_probe;						/* The most entries examined by one lookup */
+} ht_counters_t;
+
 typedef struct table_t {
-	entry_t ** buckets;		/* The list of all current buckets */
-	size_t bucket_count;	/* The number of buckets in the table */
-	size_t entry_width;		/* The size of each value in the table */
+	entry_t ** buckets;			/* The list of all current buckets */
+	size_t bucket_count;		/* The number of buckets in the table */
+	size_t entry_width;			/* The size of each value in the table */
+	size_t entry_count;			/* The number of entries across both bucket arrays */
+	entry_t ** old_buckets;		/* The bucket array being migrated from while the table grows, NULL otherwise */
+	size_t old_bucket_count;	/* The number of buckets in old_buckets */
+	size_t migrate_index;		/* The next old bucket to be migrated */
+	double max_load_factor;		/* Load factor that triggers growth, negative if growth is disabled */
+	size_t migrate_step;		/* Number of old buckets migrated per operation */
+	ht_hash_t hash;				/* The hash function applied to every key */
+	key_chunk_t * key_chunks;	/* The chunk long keys are currently allocated from, followed by older chunks */
+	ht_sync_t * sync;			/* Locks and reclamation state for concurrent tables, NULL otherwise */
+	void (*destructor)(void * value);	/* Run on a value before it is overwritten or freed, may be NULL */
+	pool_t * pool;				/* Pool entries are allocated from, NULL to use malloc */
+	const unsigned char * image;	/* The mapped image of a table opened with htopen_mmap, NULL otherwise */
+	size_t image_size;			/* The size of the mapping */
+	entry_arena_t * entry_arenas;	/* Arenas holding the entries of a bulk build, oldest first, NULL otherwise */
+	ht_build_t * build;			/* State of a bulk build between htbuild_begin and htbuild_finish, NULL otherwise */
+#ifdef HT_STATS
+	unsigned char padding[CACHE_LINE];	/* Keeps the counters off the lines readers load the bucket arrays from */
+	ht_counters_t counters;		/* Lookup counters reported by htstats */
+#endif
 } table_t;
 
-static inline int new_entry(table_t * table, entry_t * cur_entry, char * name, void * data)
+static unsigned char * alloc_key(table_t * table, size_t length, key_chunk_t ** chunk)
+{
+	key_chunk_t * cur_chunk = table->key_chunks;
+
+	if(!cur_chunk || cur_chunk->size - cur_chunk->used < length) {
+		size_t size = length > KEY_CHUNK_SIZE ? length : KEY_CHUNK_SIZE;
+
+		if(!(cur_chunk = malloc(sizeof(key_chunk_t) + size)))
+			return NULL;
+
+		cur_chunk->prev = NULL;
+		cur_chunk->next = table->key_chunks;
+		cur_chunk->size = size;
+		cur_chunk->used = 0;
+		cur_chunk->live = 0;
+
+		if(table->key_chunks)
+			table->key_chunks->prev = cur_chunk;
+
+		table->key_chunks = cur_chunk;
+	}
+
+	*chunk = cur_chunk;
+	cur_chunk->live++;
+	cur_chunk->used += length;
+
+	return cur_chunk->bytes + cur_chunk->used - length;
+}
+
+static void release_key(table_t * table, entry_t * cur_entry)
+{
+	if(cur_entry->key_length <= HT_INLINE_KEY)
+		return;
+
+	key_chunk_t * chunk = cur_entry->key.arena.chunk;
+
+	if(--chunk->live)
+		return;
+
+	if(chunk == table->key_chunks) { /* The current chunk is simply rewound */
+		chunk->used = 0;
+		return;
+	}
+
+	chunk->prev->next = chunk->next;
+
+	if(chunk->next)
+		chunk->next->prev = chunk->prev;
+
+	free(chunk);
+}
+
+static inline const unsigned char * entry_key(entry_t * cur_entry)
+{
+	return cur_entry->key_length <= HT_INLINE_KEY ? cur_entry->key.inline_key : cur_entry->key.arena.bytes;
+}
+
+/* The value is stored directly after the entry, so every entry is a single allocation */
+static inline entry_t * alloc_entry(table_t * table)
+{
+	entry_t * cur_entry = table->pool ? pool_alloc(table->pool) : malloc(ENTRY_SIZE + table->entry_width);
+
+	if(cur_entry) {
+		cur_entry->data = (char *) cur_entry + ENTRY_SIZE;
+		cur_entry->in_arena = 0;
+	}
+
+	return cur_entry;
+}
+
+static inline void free_entry(table_t * table, entry_t * cur_entry)
 {
-	if(!(cur_entry->name = malloc(strlen(name) + 1)) || !(cur_entry->data = malloc(table->entry_width))) {
-		free(cur_entry->name);
+	if(cur_entry->in_arena) /* Released with its arena when the table is destroyed */
+		return;
+
+	if(table->pool)
+		pool_free(table->pool, cur_entry);
+	else
 		free(cur_entry);
+}
+
+static inline int new_entry(table_t * table, entry_t * cur_entry, const void * key, size_t length, size_t hash, void * data)
+{
+	if(length > ENTRY_MAX_KEY) {
+		free_entry(table, cur_entry);
 		return MEM_ERROR;
 	}
 
-	strcpy(cur_entry->name, name);
-	memcpy(cur_entry->data, data, table->entry_width);
+	if(length <= HT_INLINE_KEY) {
+		memcpy(cur_entry->key.inline_key, key, length);
+	} else {
+		if(table->sync)
+			pthread_mutex_lock(&table->sync->key_lock);
+
+		cur_entry->key.arena.bytes = alloc_key(table, length, &cur_entry->key.arena.chunk);
+
+		if(table->sync)
+			pthread_mutex_unlock(&table->sync->key_lock);
+
+		if(!cur_entry->key.arena.bytes) {
+			free_entry(table, cur_entry);
+			return MEM_ERROR;
+		}
+
+		memcpy(cur_entry->key.arena.bytes, key, length);
+	}
+
+	if(data) /* Emplaced values are constructed by the caller */
+		memcpy(cur_entry->data, data, table->entry_width);
+
+	cur_entry->hash = hash;
+	cur_entry->key_length = length;
 
 	cur_entry->next = NULL;
 
@@ -53,130 +303,1542 @@ static inline int new_entry(table_t * table, entry_t * cur_entry, char * name, v
 
 static inline void update_entry(table_t * table, entry_t * cur_entry, void * data)
 {
+	if(table->destructor)
+		table->destructor(cur_entry->data);
+
 	memcpy(cur_entry->data, data, table->entry_width);
 }
 
 static inline void delete_entry(table_t * table, entry_t * cur_entry)
 {
-	free(cur_entry->name);
-	// TODO: Run user provided function to delete generic data stored in the entry 
-	free(cur_entry->data);
+	if(table->destructor)
+		table->destructor(cur_entry->data);
+
+	free_entry(table, cur_entry);
+}
+
+static inline size_t bucket_index(size_t hash, size_t bucket_count)
+{
+	return bucket_count & (bucket_count - 1) ? hash % bucket_count : hash & (bucket_count - 1);
+}
+
+static inline int key_matches(entry_t * cur_entry, const void * key, size_t length, size_t hash)
+{
+	return cur_entry->hash == hash && cur_entry->key_length == length && !memcmp(entry_key(cur_entry), key, length);
 }
 
-static inline size_t hashstring(unsigned char *str)
+/* With HT_STATS the entries examined, the match included, are added to probes unless it is NULL */
+static inline entry_t * find_entry(entry_t * cur_entry, const void * key, size_t length, size_t hash STATS(, size_t * probes))
 {
-	size_t hash = 5381;
-	int c;
+	STATS(size_t examined = 0;)
+
+	for(; cur_entry; cur_entry = cur_entry->next) {
+		STATS(examined++;)
+
+		if(key_matches(cur_entry, key, length, hash))
+			break;
+	}
 
-	while((c = *str++)) /* DJB hash algorithm */
-		hash = ((hash << 5) + hash) + c;
+	STATS(if(probes) *probes += examined;)
 
-	return hash;
+	return cur_entry;
 }
 
-static inline size_t get_key(table_t * table, char * entry_name)
+#ifdef HT_STATS
+
+/* Only tables that may be read by several threads at once pay for atomic counters */
+static void record_lookup(table_t * table, size_t probes, int hit)
 {
-	return hashstring((unsigned char *) entry_name) % table->bucket_count;
+	ht_counters_t * counters = &table->counters;
+
+	if(!table->sync && !table->image) {
+		counters->lookups++;
+		counters->hits += hit != 0;
+		counters->misses += hit == 0;
+		counters->collisions += probes - (hit != 0);
+
+		if(probes > counters->max_probe)
+			counters->max_probe = probes;
+
+		return;
+	}
+
+	size_t max_probe = __atomic_load_n(&counters->max_probe, __ATOMIC_RELAXED);
+
+	__atomic_fetch_add(&counters->lookups, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(hit ? &counters->hits : &counters->misses, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&counters->collisions, probes - (hit != 0), __ATOMIC_RELAXED);
+
+	while(probes > max_probe && !__atomic_compare_exchange_n(&counters->max_probe, &max_probe, probes, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
 }
+#endif
 
-int htinit(table_t * table, size_t entry_width, size_t bucket_count)
+static void migrate_bucket(table_t * table, size_t index)
 {
-	if(!(table->buckets = calloc(bucket_count, sizeof(entry_t *))))
-		return MEM_ERROR;
+	entry_t * cur_entry = table->old_buckets[index];
 
-	table->bucket_count = bucket_count;
-	table->entry_width = entry_width;
+	table->old_buckets[index] = NULL;
 
-	return TABLE_OK;
+	while(cur_entry) {
+		entry_t * temp = cur_entry->next;
+		size_t bucket = bucket_index(cur_entry->hash, table->bucket_count);
+
+		cur_entry->next = table->buckets[bucket];
+		table->buckets[bucket] = cur_entry;
+		cur_entry = temp;
+	}
 }
 
-int htinsert(table_t * table, char * entry_name, void * data)
+static void migrate_step(table_t * table)
 {
-	size_t bucket = get_key(table, entry_name);
-	entry_t * temp;
+	if(!table->old_buckets)
+		return;
 
-	if(table->buckets[bucket]) {
-		entry_t * cur_entry;
+	for(size_t i = 0; i < table->migrate_step && table->migrate_index < table->old_bucket_count; i++)
+		migrate_bucket(table, table->migrate_index++);
 
-		for(cur_entry = table->buckets[bucket]; cur_entry->next; cur_entry = cur_entry->next) {
-			if(!strcmp(cur_entry->name, entry_name)) {
-				update_entry(table, cur_entry, data);
-				return TABLE_OK;
-			}
-		}
+	if(table->migrate_index == table->old_bucket_count) {
+		free(table->old_buckets);
+		table->old_buckets = NULL;
+		table->old_bucket_count = 0;
+	}
+}
 
-		if(!(temp = malloc(sizeof(entry_t))))
-			return MEM_ERROR;
+/* Move the bucket a key hashes to in the old array, so that the key can only be found in the current buckets */
+static inline void migrate_key(table_t * table, size_t hash)
+{
+	if(table->old_buckets)
+		migrate_bucket(table, bucket_index(hash, table->old_bucket_count));
+}
 
-		if(new_entry(table, temp, entry_name, data) != TABLE_OK)
-			return MEM_ERROR;
+static void start_growth(table_t * table)
+{
+	entry_t ** buckets;
 
-		cur_entry->next = temp;
-	} else {
-		if(!(temp = malloc(sizeof(entry_t))))
-			return MEM_ERROR;
+	if(table->old_buckets || table->max_load_factor <= 0 || (double) table->entry_count <= table->max_load_factor * (double) table->bucket_count)
+		return;
 
-		if(new_entry(table, temp, entry_name, data) != TABLE_OK)
-			return MEM_ERROR;
+	if(!(buckets = calloc(table->bucket_count << 1, sizeof(entry_t *))))
+		return; /* Growth is only an optimisation, so carry on with the current buckets */
+
+	table->old_buckets = table->buckets;
+	table->old_bucket_count = table->bucket_count;
+	table->migrate_index = 0;
+	table->buckets = buckets;
+	table->bucket_count <<= 1;
+}
+
+static inline ht_stripe_t * get_stripe(table_t * table, size_t hash)
+{
+	return &table->sync->stripes[hash & (HT_LOCK_STRIPES - 1)];
+}
+
+static inline void write_begin(ht_stripe_t * stripe)
+{
+	__atomic_store_n(&stripe->sequence, stripe->sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
 
-		table->buckets[bucket] = temp;
+static inline void write_end(ht_stripe_t * stripe)
+{
+	__atomic_store_n(&stripe->sequence, stripe->sequence + 1, __ATOMIC_RELEASE);
+}
+
+static inline ht_stripe_t * lock_stripe(table_t * table, size_t hash)
+{
+	ht_stripe_t * stripe = get_stripe(table, hash);
+
+	pthread_mutex_lock(&stripe->lock);
+	write_begin(stripe);
+
+	return stripe;
+}
+
+static inline void unlock_stripe(ht_stripe_t * stripe)
+{
+	write_end(stripe);
+	pthread_mutex_unlock(&stripe->lock);
+}
+
+static void lock_all_stripes(table_t * table)
+{
+	for(size_t i = 0; i < HT_LOCK_STRIPES; i++) {
+		pthread_mutex_lock(&table->sync->stripes[i].lock);
+		write_begin(&table->sync->stripes[i]);
 	}
+}
 
-	return TABLE_OK;
+static void unlock_all_stripes(table_t * table)
+{
+	for(size_t i = HT_LOCK_STRIPES; i--; )
+		unlock_stripe(&table->sync->stripes[i]);
 }
 
-int htlookup(table_t * table, char * entry_name, void * value)
+/* Keeps writers out without making lock-free readers retry, for callers that only read the table */
+static void hold_all_stripes(table_t * table)
 {
-	size_t bucket = get_key(table, entry_name);
+	for(size_t i = 0; i < HT_LOCK_STRIPES; i++)
+		pthread_mutex_lock(&table->sync->stripes[i].lock);
+}
 
-	for(entry_t * cur_entry = table->buckets[bucket]; cur_entry; cur_entry = cur_entry->next) {
-		if(!strcmp(cur_entry->name, entry_name)) {
-			if(value)
-				memcpy(value, cur_entry->data, table->entry_width);
-			return TABLE_OK;
-		}
+static void release_all_stripes(table_t * table)
+{
+	for(size_t i = HT_LOCK_STRIPES; i--; )
+		pthread_mutex_unlock(&table->sync->stripes[i].lock);
+}
+
+static void reclaim_entry(void * context, void * pointer)
+{
+	table_t * table = context;
+	entry_t * cur_entry = pointer;
+
+	pthread_mutex_lock(&table->sync->key_lock);
+	release_key(table, cur_entry);
+	pthread_mutex_unlock(&table->sync->key_lock);
+
+	delete_entry(table, cur_entry);
+}
+
+static void reclaim_buckets(void * context, void * pointer)
+{
+	(void) context;
+	free(pointer);
+}
+
+/* Readers may be walking any chain, so every link is published with a release store */
+static void migrate_bucket_sync(table_t * table, size_t index)
+{
+	entry_t * cur_entry = table->old_buckets[index];
+
+	STORE(table->old_buckets[index], NULL);
+
+	while(cur_entry) {
+		entry_t * temp = cur_entry->next;
+		entry_t ** bucket = &table->buckets[cur_entry->hash & (table->bucket_count - 1)];
+
+		STORE(cur_entry->next, *bucket);
+		STORE(*bucket, cur_entry);
+		cur_entry = temp;
 	}
+}
 
-	return INVALID_ENTRY;
+/* Called with the key's stripe held, which also covers its bucket in the old array */
+static inline void migrate_key_sync(table_t * table, size_t hash)
+{
+	if(table->old_buckets)
+		migrate_bucket_sync(table, hash & (table->old_bucket_count - 1));
 }
 
-int htdelete(table_t * table, char * entry_name)
+static void migrate_step_sync(table_t * table)
 {
-	size_t bucket = get_key(table, entry_name);
-	entry_t * cur_entry = table->buckets[bucket];
-	entry_t * prev_entry = NULL;
+	if(!LOAD(table->old_buckets) || pthread_mutex_trylock(&table->sync->resize_lock))
+		return;
 
-	while(strcmp(cur_entry->name, entry_name)) {
-		prev_entry = cur_entry;
-		cur_entry = cur_entry->next;
+	for(size_t i = 0; table->old_buckets && i < table->migrate_step && table->migrate_index < table->old_bucket_count; i++) {
+		ht_stripe_t * stripe = &table->sync->stripes[table->migrate_index & (HT_LOCK_STRIPES - 1)];
 
-		if(!cur_entry)
-			return INVALID_ENTRY;
+		pthread_mutex_lock(&stripe->lock);
+		write_begin(stripe);
+		migrate_bucket_sync(table, table->migrate_index++);
+		unlock_stripe(stripe);
 	}
 
-	if(!prev_entry)
-		table->buckets[bucket] = cur_entry->next;
-	else
-		prev_entry->next = cur_entry->next;
-		
-	delete_entry(table, cur_entry);
-	free(cur_entry);
+	if(table->old_buckets && table->migrate_index == table->old_bucket_count) {
+		entry_t ** old_buckets = table->old_buckets;
 
-	return TABLE_OK;
+		lock_all_stripes(table);
+		STORE(table->old_bucket_count, 0);	/* Readers load the count first, so they never index past a shorter array */
+		STORE(table->old_buckets, NULL);
+		unlock_all_stripes(table);
+
+		ebr_retire(&table->sync->limbo, old_buckets, reclaim_buckets);
+	}
+
+	pthread_mutex_unlock(&table->sync->resize_lock);
 }
 
-void htdestroy(table_t * table)
+static void start_growth_sync(table_t * table)
 {
-	for(size_t i = 0; i < table->bucket_count; i++) {
-		entry_t * cur_entry = table->buckets[i];
+	entry_t ** buckets;
+	double limit = table->max_load_factor * (double) LOAD(table->bucket_count);
 
-		while(cur_entry) {
-			entry_t * temp = cur_entry->next;
-			delete_entry(table, cur_entry);
-			free(cur_entry);
-			cur_entry = temp;
+	if(LOAD(table->old_buckets) || table->max_load_factor <= 0 || (double) LOAD(table->entry_count) <= limit)
+		return;
+
+	if(pthread_mutex_trylock(&table->sync->resize_lock))
+		return;
+
+	if(!table->old_buckets && (buckets = calloc(table->bucket_count << 1, sizeof(entry_t *)))) {
+		lock_all_stripes(table);
+		STORE(table->old_buckets, table->buckets);
+		STORE(table->old_bucket_count, table->bucket_count);
+		STORE(table->buckets, buckets);
+		STORE(table->bucket_count, table->bucket_count << 1);
+		table->migrate_index = 0;
+		unlock_all_stripes(table);
+	}
+
+	pthread_mutex_unlock(&table->sync->resize_lock);
+}
+
+static inline entry_t * find_entry_sync(entry_t * cur_entry, const void * key, size_t length, size_t hash STATS(, size_t * probes))
+{
+	STATS(size_t examined = 0;)
+
+	for(; cur_entry; cur_entry = LOAD(cur_entry->next)) {
+		STATS(examined++;)
+
+		if(key_matches(cur_entry, key, length, hash))
+			break;
+	}
+
+	STATS(*probes += examined;)
+
+	return cur_entry;
+}
+
+static int insert_sync(table_t * table, const void * key, size_t length, size_t hash, void * data)
+{
+	ht_stripe_t * stripe = lock_stripe(table, hash);
+	int status = TABLE_OK;
+
+	migrate_key_sync(table, hash);
+
+	entry_t ** bucket = &table->buckets[hash & (table->bucket_count - 1)];
+	entry_t * cur_entry = find_entry(*bucket, key, length, hash STATS(, NULL));
+
+	if(cur_entry) {
+		update_entry(table, cur_entry, data);
+	} else if(!(cur_entry = alloc_entry(table)) || new_entry(table, cur_entry, key, length, hash, data) != TABLE_OK) {
+		status = MEM_ERROR;
+	} else {
+		cur_entry->next = *bucket;
+		STORE(*bucket, cur_entry);
+		__atomic_fetch_add(&table->entry_count, 1, __ATOMIC_RELAXED);
+	}
+
+	unlock_stripe(stripe);
+
+	start_growth_sync(table);
+	migrate_step_sync(table);
+
+	return status;
+}
+
+static int lookup_sync(table_t * table, const void * key, size_t length, size_t hash, void * value)
+{
+	ht_stripe_t * stripe = get_stripe(table, hash);
+	entry_t * cur_entry;
+	size_t sequence;
+	STATS(size_t probes;)
+
+	ebr_enter();
+
+	do {
+		while((sequence = LOAD(stripe->sequence)) & 1)
+			sched_yield();
+
+		size_t bucket_count = LOAD(table->bucket_count);
+		entry_t ** buckets = LOAD(table->buckets);
+
+		STATS(probes = 0;)
+		cur_entry = find_entry_sync(LOAD(buckets[hash & (bucket_count - 1)]), key, length, hash STATS(, &probes));
+
+		if(!cur_entry) {
+			size_t old_bucket_count = LOAD(table->old_bucket_count);
+			entry_t ** old_buckets = LOAD(table->old_buckets);
+
+			if(old_bucket_count && old_buckets)
+				cur_entry = find_entry_sync(LOAD(old_buckets[hash & (old_bucket_count - 1)]), key, length, hash STATS(, &probes));
 		}
+
+		if(cur_entry && value)
+			memcpy(value, cur_entry->data, table->entry_width);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while(__atomic_load_n(&stripe->sequence, __ATOMIC_RELAXED) != sequence);
+
+	STATS(record_lookup(table, probes, cur_entry != NULL);)
+
+	ebr_exit();
+
+	return cur_entry ? TABLE_OK : INVALID_ENTRY;
+}
+
+static int delete_sync(table_t * table, const void * key, size_t length, size_t hash)
+{
+	ht_stripe_t * stripe = lock_stripe(table, hash);
+
+	migrate_key_sync(table, hash);
+
+	entry_t ** link = &table->buckets[hash & (table->bucket_count - 1)];
+
+	while(*link && !key_matches(*link, key, length, hash))
+		link = &(*link)->next;
+
+	entry_t * cur_entry = *link;
+
+	if(cur_entry) {
+		STORE(*link, cur_entry->next);
+		__atomic_fetch_sub(&table->entry_count, 1, __ATOMIC_RELAXED);
+	}
+
+	unlock_stripe(stripe);
+
+	if(!cur_entry)
+		return INVALID_ENTRY;
+
+	ebr_retire(&table->sync->limbo, cur_entry, reclaim_entry);
+	migrate_step_sync(table);
+
+	return TABLE_OK;
+}
+
+static int init_sync(table_t * table)
+{
+	if(!(table->sync = aligned_alloc(CACHE_LINE, (sizeof(ht_sync_t) + CACHE_LINE - 1) & ~(size_t) (CACHE_LINE - 1))))
+		return MEM_ERROR;
+
+	for(size_t i = 0; i < HT_LOCK_STRIPES; i++) {
+		pthread_mutex_init(&table->sync->stripes[i].lock, NULL);
+		table->sync->stripes[i].sequence = 0;
+	}
+
+	pthread_mutex_init(&table->sync->resize_lock, NULL);
+	pthread_mutex_init(&table->sync->key_lock, NULL);
+	ebr_limbo_init(&table->sync->limbo, table);
+
+	return TABLE_OK;
+}
+
+static void destroy_sync(table_t * table)
+{
+	ebr_limbo_destroy(&table->sync->limbo);
+
+	for(size_t i = 0; i < HT_LOCK_STRIPES; i++)
+		pthread_mutex_destroy(&table->sync->stripes[i].lock);
+
+	pthread_mutex_destroy(&table->sync->resize_lock);
+	pthread_mutex_destroy(&table->sync->key_lock);
+
+	free(table->sync);
+	table->sync = NULL;
+}
+
+static int insert_hashed(table_t * table, const void * key, size_t length, size_t hash, void * data);
+static int lookup_hashed(table_t * table, const void * key, size_t length, size_t hash, void * value);
+static void * lookup_image(table_t * table, const void * key, size_t length, size_t hash);
+static void image_stats(table_t * table, ht_stats_t * stats);
+
+int htinit(table_t * table, size_t entry_width, size_t bucket_count)
+{
+	return htinit_opts(table, entry_width, bucket_count, NULL);
+}
+
+int htinit_opts(table_t * table, size_t entry_width, size_t bucket_count, const ht_options_t * options)
+{
+	table->sync = NULL;
+
+	if(options && options->pool && options->pool->object_size < htnode_size(entry_width))
+		return MEM_ERROR;
+
+	if(options && options->concurrent) { /* Stripes are picked by masking, which needs power of two bucket counts */
+		size_t minimum = bucket_count;
+
+		for(bucket_count = HT_LOCK_STRIPES; bucket_count < minimum; bucket_count <<= 1);
+
+		if(init_sync(table) != TABLE_OK)
+			return MEM_ERROR;
+	}
+
+	if(!(table->buckets = calloc(bucket_count, sizeof(entry_t *)))) {
+		if(table->sync)
+			destroy_sync(table);
+		return MEM_ERROR;
 	}
 
-	free(table->buckets);
-}
\ No newline at end of file
+	table->bucket_count = bucket_count;
+	table->entry_width = entry_width;
+	table->entry_count = 0;
+	table->old_buckets = NULL;
+	table->old_bucket_count = 0;
+	table->migrate_index = 0;
+	table->max_load_factor = options && options->max_load_factor ? options->max_load_factor : DEFAULT_LOAD_FACTOR;
+	table->migrate_step = options && options->migrate_step ? options->migrate_step : DEFAULT_MIGRATE_STEP;
+	table->hash = options && options->hash ? options->hash : hthash_wy;
+	table->key_chunks = NULL;
+	table->destructor = options ? options->destructor : NULL;
+	table->pool = options ? options->pool : NULL;
+	table->image = NULL;
+	table->image_size = 0;
+	table->entry_arenas = NULL;
+	table->build = NULL;
+
+	STATS(memset(&table->counters, 0, sizeof(ht_counters_t));)
+
+	return TABLE_OK;
+}
+
+size_t htnode_size(size_t entry_width)
+{
+	return ENTRY_SIZE + entry_width;
+}
+
+size_t httable_size(void)
+{
+	return sizeof(table_t);
+}
+
+int htinsert(table_t * table, char * entry_name, void * data)
+{
+	return htinsert_n(table, entry_name, strlen(entry_name), data);
+}
+
+int htinsert_n(table_t * table, const void * key, size_t length, void * data)
+{
+	return insert_hashed(table, key, length, table->hash(key, length), data);
+}
+
+static int emplace_hashed(table_t * table, const void * key, size_t length, size_t hash, void ** slot)
+{
+	migrate_step(table);
+	migrate_key(table, hash);
+
+	size_t bucket = bucket_index(hash, table->bucket_count);
+	entry_t * cur_entry = find_entry(table->buckets[bucket], key, length, hash STATS(, NULL));
+
+	if(cur_entry) {
+		if(table->destructor)
+			table->destructor(cur_entry->data);
+
+		*slot = cur_entry->data;
+		return TABLE_OK;
+	}
+
+	if(!(cur_entry = alloc_entry(table)))
+		return MEM_ERROR;
+
+	if(new_entry(table, cur_entry, key, length, hash, NULL) != TABLE_OK)
+		return MEM_ERROR;
+
+	cur_entry->next = table->buckets[bucket];
+	table->buckets[bucket] = cur_entry;
+	table->entry_count++;
+	*slot = cur_entry->data;
+
+	start_growth(table);
+
+	return TABLE_OK;
+}
+
+static int insert_hashed(table_t * table, const void * key, size_t length, size_t hash, void * data)
+{
+	void * slot;
+
+	if(table->image)
+		return UNSUPPORTED;
+
+	if(table->sync)
+		return insert_sync(table, key, length, hash, data);
+
+	if(emplace_hashed(table, key, length, hash, &slot) != TABLE_OK)
+		return MEM_ERROR;
+
+	memcpy(slot, data, table->entry_width);
+
+	return TABLE_OK;
+}
+
+int htemplace(table_t * table, char * entry_name, void ** slot)
+{
+	return htemplace_n(table, entry_name, strlen(entry_name), slot);
+}
+
+int htemplace_n(table_t * table, const void * key, size_t length, void ** slot)
+{
+	if(table->sync || table->image)
+		return UNSUPPORTED;
+
+	return emplace_hashed(table, key, length, table->hash(key, length), slot);
+}
+
+int htlookup(table_t * table, char * entry_name, void * value)
+{
+	return htlookup_n(table, entry_name, strlen(entry_name), value);
+}
+
+int htlookup_n(table_t * table, const void * key, size_t length, void * value)
+{
+	return lookup_hashed(table, key, length, table->hash(key, length), value);
+}
+
+static entry_t * lookup_entry(table_t * table, const void * key, size_t length, size_t hash)
+{
+	migrate_step(table);
+
+	STATS(size_t probes = 0;)
+	entry_t * cur_entry = find_entry(table->buckets[bucket_index(hash, table->bucket_count)], key, length, hash STATS(, &probes));
+
+	if(!cur_entry && table->old_buckets)
+		cur_entry = find_entry(table->old_buckets[bucket_index(hash, table->old_bucket_count)], key, length, hash STATS(, &probes));
+
+	STATS(record_lookup(table, probes, cur_entry != NULL);)
+
+	return cur_entry;
+}
+
+static int lookup_hashed(table_t * table, const void * key, size_t length, size_t hash, void * value)
+{
+	if(table->sync)
+		return lookup_sync(table, key, length, hash, value);
+
+	if(table->image) {
+		void * data = lookup_image(table, key, length, hash);
+
+		if(data && value)
+			memcpy(value, data, table->entry_width);
+
+		return data ? TABLE_OK : INVALID_ENTRY;
+	}
+
+	entry_t * cur_entry = lookup_entry(table, key, length, hash);
+
+	if(!cur_entry)
+		return INVALID_ENTRY;
+
+	if(value)
+		memcpy(value, cur_entry->data, table->entry_width);
+
+	return TABLE_OK;
+}
+
+void * htlookup_ref(table_t * table, char * entry_name)
+{
+	return htlookup_ref_n(table, entry_name, strlen(entry_name));
+}
+
+void * htlookup_ref_n(table_t * table, const void * key, size_t length)
+{
+	if(table->sync)
+		return NULL;
+
+	if(table->image)
+		return lookup_image(table, key, length, table->hash(key, length));
+
+	entry_t * cur_entry = lookup_entry(table, key, length, table->hash(key, length));
+
+	return cur_entry ? cur_entry->data : NULL;
+}
+
+int htdelete(table_t * table, char * entry_name)
+{
+	return htdelete_n(table, entry_name, strlen(entry_name));
+}
+
+int htdelete_n(table_t * table, const void * key, size_t length)
+{
+	size_t hash = table->hash(key, length);
+
+	if(table->image)
+		return UNSUPPORTED;
+
+	if(table->sync)
+		return delete_sync(table, key, length, hash);
+
+	migrate_step(table);
+	migrate_key(table, hash);
+
+	size_t bucket = bucket_index(hash, table->bucket_count);
+	entry_t * cur_entry = table->buckets[bucket];
+	entry_t * prev_entry = NULL;
+
+	while(cur_entry && !key_matches(cur_entry, key, length, hash)) {
+		prev_entry = cur_entry;
+		cur_entry = cur_entry->next;
+	}
+
+	if(!cur_entry)
+		return INVALID_ENTRY;
+
+	if(!prev_entry)
+		table->buckets[bucket] = cur_entry->next;
+	else
+		prev_entry->next = cur_entry->next;
+		
+	release_key(table, cur_entry);
+	delete_entry(table, cur_entry);
+	table->entry_count--;
+
+	return TABLE_OK;
+}
+
+int htinsert_batch(table_t * table, char ** entry_names, size_t count, void * data)
+{
+	size_t lengths[BATCH_WINDOW];
+	size_t hashes[BATCH_WINDOW];
+
+	if(table->image)
+		return UNSUPPORTED;
+
+	for(size_t base = 0; base < count; base += BATCH_WINDOW) {
+		size_t window = count - base < BATCH_WINDOW ? count - base : BATCH_WINDOW;
+
+		for(size_t i = 0; i < window; i++)
+			__builtin_prefetch(entry_names[base + i]);
+
+		for(size_t i = 0; i < window; i++) {
+			lengths[i] = strlen(entry_names[base + i]);
+			hashes[i] = table->hash(entry_names[base + i], lengths[i]);
+
+			if(!table->sync)
+				__builtin_prefetch(&table->buckets[bucket_index(hashes[i], table->bucket_count)]);
+		}
+
+		if(!table->sync)
+			for(size_t i = 0; i < window; i++)
+				__builtin_prefetch(table->buckets[bucket_index(hashes[i], table->bucket_count)]);
+
+		for(size_t i = 0; i < window; i++)
+			if(insert_hashed(table, entry_names[base + i], lengths[i], hashes[i], (char *) data + (base + i) * table->entry_width) != TABLE_OK)
+				return MEM_ERROR;
+	}
+
+	return TABLE_OK;
+}
+
+int htlookup_batch(table_t * table, char ** entry_names, size_t count, void * values, int * results)
+{
+	size_t lengths[BATCH_WINDOW];
+	size_t hashes[BATCH_WINDOW];
+	entry_t * entries[BATCH_WINDOW];
+	int status = TABLE_OK;
+
+	for(size_t base = 0; base < count; base += BATCH_WINDOW) {
+		size_t window = count - base < BATCH_WINDOW ? count - base : BATCH_WINDOW;
+
+		if(table->sync || table->image) {
+			for(size_t i = 0; i < window; i++) {
+				int result = htlookup(table, entry_names[base + i], values ? (char *) values + (base + i) * table->entry_width : NULL);
+
+				if(results)
+					results[base + i] = result;
+				if(result != TABLE_OK)
+					status = INVALID_ENTRY;
+			}
+
+			continue;
+		}
+
+		for(size_t i = 0; i < window; i++)
+			migrate_step(table);
+
+		/* Each pass issues the loads the next one depends on, so the misses of a whole window overlap */
+		for(size_t i = 0; i < window; i++)
+			__builtin_prefetch(entry_names[base + i]);
+
+		for(size_t i = 0; i < window; i++) {
+			lengths[i] = strlen(entry_names[base + i]);
+			hashes[i] = table->hash(entry_names[base + i], lengths[i]);
+			__builtin_prefetch(&table->buckets[bucket_index(hashes[i], table->bucket_count)]);
+		}
+
+		for(size_t i = 0; i < window; i++) {
+			entries[i] = table->buckets[bucket_index(hashes[i], table->bucket_count)];
+			__builtin_prefetch(entries[i]);
+		}
+
+		for(size_t i = 0; i < window; i++) {
+			STATS(size_t probes = 0;)
+
+			entries[i] = find_entry(entries[i], entry_names[base + i], lengths[i], hashes[i] STATS(, &probes));
+
+			if(!entries[i] && table->old_buckets)
+				entries[i] = find_entry(table->old_buckets[bucket_index(hashes[i], table->old_bucket_count)], entry_names[base + i], lengths[i], hashes[i] STATS(, &probes));
+
+			STATS(record_lookup(table, probes, entries[i] != NULL);)
+
+			if(entries[i] && values)
+				__builtin_prefetch(entries[i]->data);
+		}
+
+		for(size_t i = 0; i < window; i++) {
+			if(entries[i] && values)
+				memcpy((char *) values + (base + i) * table->entry_width, entries[i]->data, table->entry_width);
+
+			if(results)
+				results[base + i] = entries[i] ? TABLE_OK : INVALID_ENTRY;
+
+			if(!entries[i])
+				status = INVALID_ENTRY;
+		}
+	}
+
+	return status;
+}
+
+/*
+ * Bulk building
+ *
+ * htbuild_begin sizes the bucket array for the expected number of entries up front, so the table
+ * never grows while it is filled, and splits it into partitions of BUILD_PARTITION_BUCKETS
+ * consecutive buckets. It then allocates one arena with a region for each partition, large enough
+ * for the partition's share of the expected entries with a sixteenth to spare for partitions the hash
+ * fills unevenly. A build with a single partition has nothing to even out and gets no spare room.
+ * Arenas of BUILD_MAPPED_ARENA bytes or more are mapped and marked for huge pages, since faulting in
+ * fresh pages one at a time costs more than filling them.
+ *
+ * htbuild_add hashes the key and copies the entry into the next free slot of its partition's region,
+ * without searching for the key, so no entry is allocated on its own. An entry whose region is full
+ * goes to an overflow arena instead. Overflow arenas start small and double in size, so a poor
+ * estimate or a skewed hash costs a few extra allocations rather than failing.
+ *
+ * htbuild_finish links each partition's entries into its buckets. A region is read from start to end
+ * and only the partition's part of the bucket array is written, so all of it stays in cache and the
+ * partitions can be shared out between threads with nothing to lock. The overflow entries are linked
+ * afterwards by the calling thread. A key added twice keeps the later value, as inserting it twice
+ * would.
+ *
+ * Built entries are flagged as living in an arena, so deleting one only leaves its slot unused.
+ * Arenas are freed when the table is destroyed.
+ */
+
+typedef struct ht_build_worker_t {
+	table_t * table;
+	size_t first_partition;		/* The first partition this worker links */
+	size_t last_partition;		/* One past the last */
+	entry_t * duplicates;		/* Entries replaced by a later one with the same key, chained through next */
+	size_t duplicate_count;		/* The number of them */
+} ht_build_worker_t;
+
+static entry_arena_t * new_arena(size_t stride, size_t entries)
+{
+	size_t size = sizeof(entry_arena_t) + stride * entries;
+	entry_arena_t * arena;
+	int mapped = size >= BUILD_MAPPED_ARENA;
+
+	if(mapped) {
+		if((arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+			return NULL;
+#ifdef MADV_HUGEPAGE
+		madvise(arena, size, MADV_HUGEPAGE); /* Only a hint, so a kernel without huge pages simply uses normal ones */
+#endif
+	} else if(!(arena = malloc(size))) {
+		return NULL;
+	}
+
+	arena->next = NULL;
+	arena->size = stride * entries;
+	arena->used = 0;
+	arena->mapped = mapped;
+
+	return arena;
+}
+
+static void free_arena(entry_arena_t * arena)
+{
+	if(arena->mapped)
+		munmap(arena, sizeof(entry_arena_t) + arena->size);
+	else
+		free(arena);
+}
+
+static inline size_t build_partition(table_t * table, size_t hash)
+{
+	return (hash & (table->bucket_count - 1)) / BUILD_PARTITION_BUCKETS;
+}
+
+static inline entry_t * region_entry(table_t * table, size_t partition, size_t index)
+{
+	return (entry_t *) (table->entry_arenas->bytes + (partition * table->build->region + index) * table->build->stride);
+}
+
+static void destroy_build(table_t * table)
+{
+	ht_build_t * build = table->build;
+
+	if(table->destructor) { /* Entries added to an unfinished build are in no bucket yet */
+		for(size_t p = 0; p < build->partitions; p++)
+			for(size_t i = 0; i < build->filled[p]; i++)
+				table->destructor(region_entry(table, p, i)->data);
+
+		for(entry_arena_t * arena = table->entry_arenas ? table->entry_arenas->next : NULL; arena; arena = arena->next)
+			for(size_t offset = 0; offset < arena->used; offset += build->stride)
+				table->destructor(((entry_t *) (arena->bytes + offset))->data);
+	}
+
+	free(build);
+	table->build = NULL;
+}
+
+int htbuild_begin(table_t * table, size_t entry_width, size_t expected, const ht_options_t * options)
+{
+	double load_factor = options && options->max_load_factor > 0 ? options->max_load_factor : DEFAULT_LOAD_FACTOR;
+	size_t bucket_count;
+
+	for(bucket_count = 1; (double) bucket_count * load_factor < (double) expected; bucket_count <<= 1);
+
+	if(htinit_opts(table, entry_width, bucket_count, options) != TABLE_OK)
+		return MEM_ERROR;
+
+	/* Concurrent tables round their bucket count up, so the partitions follow the table's count */
+	size_t partitions = (table->bucket_count + BUILD_PARTITION_BUCKETS - 1) / BUILD_PARTITION_BUCKETS;
+	size_t share = (expected + partitions - 1) / partitions;
+
+	if(!(table->build = calloc(1, sizeof(ht_build_t) + partitions * sizeof(size_t)))) {
+		htdestroy(table);
+		return MEM_ERROR;
+	}
+
+	table->build->stride = (ENTRY_SIZE + entry_width + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+	table->build->partitions = partitions;
+	table->build->region = partitions > 1 ? share + share / 16 : share;
+
+	if(!(table->entry_arenas = table->build->last = new_arena(table->build->stride, partitions * table->build->region))) {
+		htdestroy(table);
+		return MEM_ERROR;
+	}
+
+	return TABLE_OK;
+}
+
+int htbuild_add(table_t * table, char * entry_name, void * data)
+{
+	return htbuild_add_n(table, entry_name, strlen(entry_name), data);
+}
+
+int htbuild_add_n(table_t * table, const void * key, size_t length, void * data)
+{
+	ht_build_t * build = table->build;
+
+	if(!build)
+		return UNSUPPORTED;
+
+	size_t hash = table->hash(key, length);
+	size_t partition = build_partition(table, hash);
+	entry_arena_t * arena = NULL;
+	entry_t * cur_entry;
+
+	if(build->filled[partition] < build->region) {
+		cur_entry = region_entry(table, partition, build->filled[partition]);
+	} else {
+		arena = build->last;
+
+		if(arena == table->entry_arenas || arena->size - arena->used < build->stride) {
+			size_t entries = arena == table->entry_arenas ? BUILD_OVERFLOW_ENTRIES : arena->size / build->stride * 2;
+
+			if(!(arena = new_arena(build->stride, entries)))
+				return MEM_ERROR;
+
+			build->last->next = arena;
+			build->last = arena;
+		}
+
+		cur_entry = (entry_t *) (arena->bytes + arena->used);
+	}
+
+	cur_entry->data = (char *) cur_entry + ENTRY_SIZE;
+	cur_entry->in_arena = 1;
+
+	if(new_entry(table, cur_entry, key, length, hash, data) != TABLE_OK)
+		return MEM_ERROR;
+
+	if(arena)
+		arena->used += build->stride;
+	else
+		build->filled[partition]++;
+
+	build->count++;
+
+	return TABLE_OK;
+}
+
+/* Entries are linked in the order they were added, so an earlier entry with the same key is replaced */
+static inline void build_link(table_t * table, entry_t * cur_entry, ht_build_worker_t * worker)
+{
+	entry_t ** link = &table->buckets[cur_entry->hash & (table->bucket_count - 1)];
+	entry_t ** old_link = link;
+
+	while(*old_link && !key_matches(*old_link, entry_key(cur_entry), cur_entry->key_length, cur_entry->hash))
+		old_link = &(*old_link)->next;
+
+	if(*old_link) {
+		entry_t * old_entry = *old_link;
+
+		*old_link = old_entry->next;
+		old_entry->next = worker->duplicates;
+		worker->duplicates = old_entry;
+		worker->duplicate_count++;
+	}
+
+	cur_entry->next = *link;
+	*link = cur_entry;
+}
+
+static void * build_phase_link(void * argument)
+{
+	ht_build_worker_t * worker = argument;
+	table_t * table = worker->table;
+
+	for(size_t p = worker->first_partition; p < worker->last_partition; p++)
+		for(size_t i = 0; i < table->build->filled[p]; i++)
+			build_link(table, region_entry(table, p, i), worker);
+
+	return NULL;
+}
+
+static void build_run_workers(void * (*phase)(void * argument), ht_build_worker_t * workers, size_t count)
+{
+	pthread_t threads[HT_BUILD_MAX_THREADS];
+	int started[HT_BUILD_MAX_THREADS];
+
+	for(size_t i = 1; i < count; i++)
+		started[i] = !pthread_create(&threads[i], NULL, phase, &workers[i]);
+
+	phase(&workers[0]);
+
+	for(size_t i = 1; i < count; i++) {
+		if(started[i])
+			pthread_join(threads[i], NULL);
+		else
+			phase(&workers[i]);
+	}
+}
+
+int htbuild_finish(table_t * table, int nthreads)
+{
+	ht_build_t * build = table->build;
+	ht_build_worker_t workers[HT_BUILD_MAX_THREADS];
+
+	if(!build)
+		return UNSUPPORTED;
+
+	size_t count = nthreads < 1 ? 1 : nthreads > HT_BUILD_MAX_THREADS ? HT_BUILD_MAX_THREADS : (size_t) nthreads;
+
+	if(count > build->partitions)
+		count = build->partitions;
+
+	if(build->count < count * BUILD_PARALLEL_MIN)
+		count = build->count / BUILD_PARALLEL_MIN ? build->count / BUILD_PARALLEL_MIN : 1;
+
+	for(size_t i = 0; i < count; i++)
+		workers[i] = (ht_build_worker_t) {
+			.table				= table,
+			.first_partition	= build->partitions * i / count,
+			.last_partition		= build->partitions * (i + 1) / count,
+			.duplicates			= NULL,
+			.duplicate_count	= 0
+		};
+
+	build_run_workers(build_phase_link, workers, count);
+
+	/* Overflow entries were all added after their region filled, so linking them last keeps the order */
+	for(entry_arena_t * arena = table->entry_arenas->next; arena; arena = arena->next)
+		for(size_t offset = 0; offset < arena->used; offset += build->stride)
+			build_link(table, (entry_t *) (arena->bytes + offset), &workers[0]);
+
+	table->entry_count = build->count;
+
+	for(size_t i = 0; i < count; i++) {
+		while(workers[i].duplicates) {
+			entry_t * temp = workers[i].duplicates->next;
+
+			release_key(table, workers[i].duplicates);
+			delete_entry(table, workers[i].duplicates);
+			workers[i].duplicates = temp;
+		}
+
+		table->entry_count -= workers[i].duplicate_count;
+	}
+
+	free(build);
+	table->build = NULL;
+
+	return TABLE_OK;
+}
+
+static void chain_histogram(entry_t ** buckets, size_t bucket_count, ht_stats_t * stats)
+{
+	for(size_t i = 0; i < bucket_count; i++) {
+		size_t length = 0;
+
+		for(entry_t * cur_entry = buckets[i]; cur_entry; cur_entry = cur_entry->next)
+			length++;
+
+		stats->chain_lengths[length < HT_STATS_CHAINS ? length : HT_STATS_CHAINS - 1]++;
+
+		if(length > stats->max_chain)
+			stats->max_chain = length;
+	}
+}
+
+int htstats(table_t * table, ht_stats_t * stats)
+{
+	memset(stats, 0, sizeof(ht_stats_t));
+
+	if(table->sync) { /* Holding every stripe keeps writers and migration out while the chains are walked, readers carry on */
+		pthread_mutex_lock(&table->sync->resize_lock);
+		hold_all_stripes(table);
+	}
+
+	stats->entry_count	= table->entry_count;
+	stats->bucket_count	= table->bucket_count;
+	stats->load_factor	= (double) table->entry_count / (double) table->bucket_count;
+
+	if(table->image)
+		image_stats(table, stats);
+	else
+		chain_histogram(table->buckets, table->bucket_count, stats);
+
+	if(table->old_buckets) /* Buckets not yet migrated count as chains of their own, emptied ones as empty chains */
+		chain_histogram(table->old_buckets, table->old_bucket_count, stats);
+
+	if(table->sync) {
+		release_all_stripes(table);
+		pthread_mutex_unlock(&table->sync->resize_lock);
+	}
+
+#ifdef HT_STATS
+	stats->counting		= 1;
+	stats->lookups		= __atomic_load_n(&table->counters.lookups, __ATOMIC_RELAXED);
+	stats->hits			= __atomic_load_n(&table->counters.hits, __ATOMIC_RELAXED);
+	stats->misses		= __atomic_load_n(&table->counters.misses, __ATOMIC_RELAXED);
+	stats->collisions	= __atomic_load_n(&table->counters.collisions, __ATOMIC_RELAXED);
+	stats->max_probe	= __atomic_load_n(&table->counters.max_probe, __ATOMIC_RELAXED);
+#endif
+
+	return TABLE_OK;
+}
+
+static void destroy_buckets(table_t * table, entry_t ** buckets, size_t bucket_count)
+{
+	for(size_t i = 0; i < bucket_count; i++) {
+		entry_t * cur_entry = buckets[i];
+
+		while(cur_entry) {
+			entry_t * temp = cur_entry->next;
+			delete_entry(table, cur_entry);
+			cur_entry = temp;
+		}
+	}
+
+	free(buckets);
+}
+
+void htdestroy(table_t * table)
+{
+	if(table->image) { /* Tables from htopen_mmap own nothing but the mapping and the table_t itself */
+		munmap((void *) table->image, table->image_size);
+		free(table);
+		return;
+	}
+
+	if(table->sync) /* Reclaims deferred entries while the key chunks they point into still exist */
+		destroy_sync(table);
+
+	destroy_buckets(table, table->buckets, table->bucket_count);
+
+	if(table->old_buckets)
+		destroy_buckets(table, table->old_buckets, table->old_bucket_count);
+
+	if(table->build)
+		destroy_build(table);
+
+	while(table->entry_arenas) {
+		entry_arena_t * temp = table->entry_arenas->next;
+		free_arena(table->entry_arenas);
+		table->entry_arenas = temp;
+	}
+
+	while(table->key_chunks) {
+		key_chunk_t * temp = table->key_chunks->next;
+		free(table->key_chunks);
+		table->key_chunks = temp;
+	}
+
+	table->old_buckets = NULL;
+	table->entry_count = 0;
+}
+
+/*
+ * Table images
+ *
+ * An image is a header, an array of bucket_count + 1 offsets and the records. Bucket i's records sit
+ * back to back between offsets[i] and offsets[i + 1], so no record needs a next pointer and every
+ * offset is relative to the start of the image, which can be mapped anywhere. A record is its 64 bit
+ * hash and key length, the key, then the value, with the key and value each padded to IMAGE_ALIGN so
+ * values are as aligned as malloc would make them. Saved tables get a power of two bucket count of at
+ * least their entry count, however loaded they were.
+ *
+ * The header is checksummed on its own and the body in fixed blocks of IMAGE_BLOCK bytes, which lets
+ * htsave checksum the image as it streams it out. Everything is in the byte order of the machine that
+ * wrote it, and an image from a machine of the other byte order fails the magic number check. Values
+ * are copied byte for byte, so any pointers stored in them are meaningless to another process.
+ */
+
+#define IMAGE_MAGIC (uint64_t) 0x31474D49454C4254ULL	/* "TBLEIMG1" read as a little endian integer */
+#define IMAGE_VERSION 1
+#define IMAGE_ALIGN (size_t) 16
+#define IMAGE_BLOCK (size_t) 65536
+
+enum { IMAGE_HASH_WY, IMAGE_HASH_DJB2 };
+
+typedef struct ht_image_header_t {
+	uint64_t magic;				/* IMAGE_MAGIC */
+	uint32_t version;			/* IMAGE_VERSION */
+	uint32_t hash_function;		/* Which of the built in hash functions the table used */
+	uint64_t entry_width;		/* The size of each value */
+	uint64_t entry_count;		/* The number of records */
+	uint64_t bucket_count;		/* The number of buckets, always a power of two */
+	uint64_t records_offset;	/* Where the records start */
+	uint64_t image_size;		/* The size of the whole image */
+	uint64_t body_checksum;		/* Checksum of everything after the header */
+	uint64_t header_checksum;	/* Checksum of the header up to this field */
+} ht_image_header_t;
+
+typedef struct ht_image_record_t {
+	uint64_t hash;				/* The full hash of the key */
+	uint64_t key_length;		/* The length of the key in bytes */
+	unsigned char key[];		/* The key, then the value after padding */
+} ht_image_record_t;
+
+typedef struct image_writer_t {
+	int fd;
+	uint64_t offset;			/* Where the buffer will be written */
+	uint64_t checksum;			/* Checksum of the blocks written so far */
+	size_t used;				/* Bytes waiting in the buffer */
+	unsigned char buffer[IMAGE_BLOCK];
+} image_writer_t;
+
+#define IMAGE_PAD(x) (((x) + IMAGE_ALIGN - 1) & ~(IMAGE_ALIGN - 1))
+
+static inline size_t record_size(size_t key_length, size_t entry_width)
+{
+	return sizeof(ht_image_record_t) + IMAGE_PAD(key_length) + IMAGE_PAD(entry_width);
+}
+
+static inline uint64_t checksum_block(uint64_t checksum, const void * block, size_t size)
+{
+	return checksum * 0x100000001B3ULL ^ hthash_wy(block, size);
+}
+
+static uint64_t checksum_body(const unsigned char * body, size_t size)
+{
+	uint64_t checksum = 0;
+
+	for(size_t offset = 0; offset < size; offset += IMAGE_BLOCK)
+		checksum = checksum_block(checksum, body + offset, size - offset < IMAGE_BLOCK ? size - offset : IMAGE_BLOCK);
+
+	return checksum;
+}
+
+static int write_all(int fd, const void * data, size_t size, uint64_t offset)
+{
+	for(size_t done = 0; done < size; ) {
+		ssize_t written = pwrite(fd, (const unsigned char *) data + done, size - done, (off_t) (offset + done));
+
+		if(written < 0)
+			return IO_ERROR;
+
+		done += (size_t) written;
+	}
+
+	return TABLE_OK;
+}
+
+static int flush_image(image_writer_t * writer)
+{
+	if(writer->used == 0)
+		return TABLE_OK;
+
+	writer->checksum = checksum_block(writer->checksum, writer->buffer, writer->used);
+
+	if(write_all(writer->fd, writer->buffer, writer->used, writer->offset) != TABLE_OK)
+		return IO_ERROR;
+
+	writer->offset += writer->used;
+	writer->used = 0;
+
+	return TABLE_OK;
+}
+
+/* Buffers body bytes, flushing only whole blocks so the checksum sees the same blocks as the reader. NULL data writes zeros */
+static int write_image(image_writer_t * writer, const void * data, size_t size)
+{
+	while(size) {
+		size_t chunk = IMAGE_BLOCK - writer->used < size ? IMAGE_BLOCK - writer->used : size;
+
+		if(data) {
+			memcpy(writer->buffer + writer->used, data, chunk);
+			data = (const unsigned char *) data + chunk;
+		} else {
+			memset(writer->buffer + writer->used, 0, chunk);
+		}
+
+		writer->used += chunk;
+		size -= chunk;
+
+		if(writer->used == IMAGE_BLOCK && flush_image(writer) != TABLE_OK)
+			return IO_ERROR;
+	}
+
+	return TABLE_OK;
+}
+
+static void collect_entries(entry_t ** buckets, size_t bucket_count, entry_t ** entries, size_t * count)
+{
+	for(size_t i = 0; i < bucket_count; i++)
+		for(entry_t * cur_entry = buckets[i]; cur_entry; cur_entry = cur_entry->next)
+			entries[(*count)++] = cur_entry;
+}
+
+/* Called with the table held still. Streams the image out from the start of fd, then writes the header once the body checksum is known.
+ * The caller syncs the file, which can wait on the disk for much longer than the writes took */
+static int save_image(table_t * table, int fd, uint32_t hash_function)
+{
+	size_t bucket_count = 1, count = 0;
+
+	while(bucket_count < table->entry_count)
+		bucket_count <<= 1;
+
+	entry_t ** entries = malloc((table->entry_count + 1) * sizeof(entry_t *));
+	entry_t ** sorted = malloc((table->entry_count + 1) * sizeof(entry_t *));
+	size_t * starts = calloc(bucket_count + 1, sizeof(size_t));
+	uint64_t * offsets = calloc(bucket_count + 1, sizeof(uint64_t));
+	image_writer_t * writer = malloc(sizeof(image_writer_t));
+	int status = MEM_ERROR;
+
+	if(!entries || !sorted || !starts || !offsets || !writer)
+		goto done;
+
+	collect_entries(table->buckets, table->bucket_count, entries, &count);
+
+	if(table->old_buckets)
+		collect_entries(table->old_buckets, table->old_bucket_count, entries, &count);
+
+	/* Counting sort by image bucket, totalling each bucket's record bytes on the way */
+	for(size_t i = 0; i < count; i++) {
+		size_t bucket = entries[i]->hash & (bucket_count - 1);
+
+		starts[bucket + 1]++;
+		offsets[bucket + 1] += record_size(entries[i]->key_length, table->entry_width);
+	}
+
+	offsets[0] = IMAGE_PAD(sizeof(ht_image_header_t) + (bucket_count + 1) * sizeof(uint64_t));
+
+	for(size_t i = 1; i <= bucket_count; i++) {
+		starts[i] += starts[i - 1];
+		offsets[i] += offsets[i - 1];
+	}
+
+	for(size_t i = 0; i < count; i++)
+		sorted[starts[entries[i]->hash & (bucket_count - 1)]++] = entries[i];
+
+	*writer = (image_writer_t) { .fd = fd, .offset = sizeof(ht_image_header_t), .checksum = 0, .used = 0 };
+	status = IO_ERROR;
+
+	if(write_image(writer, offsets, (bucket_count + 1) * sizeof(uint64_t)) != TABLE_OK)
+		goto done;
+
+	if(write_image(writer, NULL, offsets[0] - sizeof(ht_image_header_t) - (bucket_count + 1) * sizeof(uint64_t)) != TABLE_OK)
+		goto done;
+
+	for(size_t i = 0; i < count; i++) {
+		ht_image_record_t record = { .hash = sorted[i]->hash, .key_length = sorted[i]->key_length };
+
+		if(write_image(writer, &record, sizeof(record)) != TABLE_OK
+			|| write_image(writer, entry_key(sorted[i]), record.key_length) != TABLE_OK
+			|| write_image(writer, NULL, IMAGE_PAD(record.key_length) - record.key_length) != TABLE_OK
+			|| write_image(writer, sorted[i]->data, table->entry_width) != TABLE_OK
+			|| write_image(writer, NULL, IMAGE_PAD(table->entry_width) - table->entry_width) != TABLE_OK)
+			goto done;
+	}
+
+	if(flush_image(writer) != TABLE_OK)
+		goto done;
+
+	ht_image_header_t header = {
+		.magic = IMAGE_MAGIC, .version = IMAGE_VERSION, .hash_function = hash_function, .entry_width = table->entry_width,
+		.entry_count = count, .bucket_count = bucket_count, .records_offset = offsets[0], .image_size = offsets[bucket_count],
+		.body_checksum = writer->checksum
+	};
+
+	header.header_checksum = hthash_wy(&header, offsetof(ht_image_header_t, header_checksum));
+
+	if(write_all(fd, &header, sizeof(header), 0) == TABLE_OK && ftruncate(fd, (off_t) header.image_size) == 0)
+		status = TABLE_OK;
+
+done:
+	free(entries);
+	free(sorted);
+	free(starts);
+	free(offsets);
+	free(writer);
+
+	return status;
+}
+
+int htsave(table_t * table, int fd)
+{
+	uint32_t hash_function;
+	int status;
+
+	if(table->hash == hthash_wy)
+		hash_function = IMAGE_HASH_WY;
+	else if(table->hash == hthash_djb2)
+		hash_function = IMAGE_HASH_DJB2;
+	else
+		return UNSUPPORTED; /* A mapped table could not know which function to hash with */
+
+	if(table->image)
+		return write_all(fd, table->image, table->image_size, 0) == TABLE_OK && ftruncate(fd, (off_t) table->image_size) == 0 && fsync(fd) == 0 ? TABLE_OK : IO_ERROR;
+
+	if(table->sync) { /* Writers wait for the image to be written, readers carry on */
+		pthread_mutex_lock(&table->sync->resize_lock);
+		hold_all_stripes(table);
+	}
+
+	status = save_image(table, fd, hash_function);
+
+	if(table->sync) {
+		release_all_stripes(table);
+		pthread_mutex_unlock(&table->sync->resize_lock);
+	}
+
+	return status == TABLE_OK && fsync(fd) != 0 ? IO_ERROR : status;
+}
+
+/* Checks everything a lookup will trust before the table is handed out */
+static int verify_image(const unsigned char * image, size_t size)
+{
+	const ht_image_header_t * header = (const ht_image_header_t *) image;
+
+	if(size < sizeof(ht_image_header_t) || header->magic != IMAGE_MAGIC || header->version != IMAGE_VERSION)
+		return IO_ERROR;
+
+	if(header->header_checksum != hthash_wy(header, offsetof(ht_image_header_t, header_checksum)))
+		return IO_ERROR;
+
+	if(header->image_size != size || header->hash_function > IMAGE_HASH_DJB2 || !header->bucket_count || header->bucket_count & (header->bucket_count - 1))
+		return IO_ERROR;
+
+	/* The offsets array holds bucket_count + 1 entries and must end before the records, which end within the image */
+	if(header->bucket_count >= (size - sizeof(ht_image_header_t)) / sizeof(uint64_t) || header->records_offset < sizeof(ht_image_header_t) + (header->bucket_count + 1) * sizeof(uint64_t) || header->records_offset > size)
+		return IO_ERROR;
+
+	if(checksum_body(image + sizeof(ht_image_header_t), size - sizeof(ht_image_header_t)) != header->body_checksum)
+		return IO_ERROR;
+
+	const uint64_t * offsets = (const uint64_t *) (image + sizeof(ht_image_header_t));
+	uint64_t records = 0;
+
+	if(offsets[0] != header->records_offset || offsets[0] % IMAGE_ALIGN || offsets[header->bucket_count] != size)
+		return IO_ERROR;
+
+	if(header->entry_width > size) /* No value can be larger than the image, and record_size must not wrap */
+		return IO_ERROR;
+
+	/* The checksums are no defence against a crafted image, so every record is walked once here. Each must
+	 * fit in what is left of its bucket and belong to it, and the last must end exactly on the next offset */
+	for(size_t i = 0; i < header->bucket_count; i++) {
+		uint64_t offset = offsets[i];
+
+		if(offset > offsets[i + 1])
+			return IO_ERROR;
+
+		while(offset < offsets[i + 1]) {
+			const ht_image_record_t * record = (const ht_image_record_t *) (image + offset);
+			uint64_t left = offsets[i + 1] - offset;
+
+			if(left < sizeof(ht_image_record_t) || record->key_length > left - sizeof(ht_image_record_t) || (record->hash & (header->bucket_count - 1)) != i)
+				return IO_ERROR;
+
+			if(record_size(record->key_length, header->entry_width) > left)
+				return IO_ERROR;
+
+			offset += record_size(record->key_length, header->entry_width);
+			records++;
+		}
+	}
+
+	return records == header->entry_count ? TABLE_OK : IO_ERROR;
+}
+
+table_t * htopen_mmap(const char * path)
+{
+	table_t * table = NULL;
+	unsigned char * image = MAP_FAILED;
+	struct stat info;
+	int fd;
+
+	if((fd = open(path, O_RDONLY)) < 0)
+		return NULL;
+
+	if(fstat(fd, &info) == 0 && info.st_size > 0)
+		image = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+	close(fd); /* The mapping keeps the file open */
+
+	if(image == MAP_FAILED)
+		return NULL;
+
+	if(verify_image(image, (size_t) info.st_size) != TABLE_OK || !(table = malloc(sizeof(table_t)))) {
+		munmap(image, (size_t) info.st_size);
+		return NULL;
+	}
+
+	const ht_image_header_t * header = (const ht_image_header_t *) image;
+
+	memset(table, 0, sizeof(table_t));
+
+	table->image		= image;
+	table->image_size	= (size_t) info.st_size;
+	table->bucket_count	= (size_t) header->bucket_count;
+	table->entry_width	= (size_t) header->entry_width;
+	table->entry_count	= (size_t) header->entry_count;
+	table->hash			= header->hash_function == IMAGE_HASH_WY ? hthash_wy : hthash_djb2;
+
+	return table;
+}
+
+static void * lookup_image(table_t * table, const void * key, size_t length, size_t hash)
+{
+	const uint64_t * offsets = (const uint64_t *) (table->image + sizeof(ht_image_header_t));
+	size_t bucket = hash & (table->bucket_count - 1);
+	uint64_t end = offsets[bucket + 1];
+	STATS(size_t probes = 0;)
+
+	/* verify_image has checked that the records of every bucket fit it exactly */
+	for(uint64_t offset = offsets[bucket]; offset < end; ) {
+		const ht_image_record_t * record = (const ht_image_record_t *) (table->image + offset);
+
+		STATS(probes++;)
+
+		if(record->hash == hash && record->key_length == length && !memcmp(record->key, key, length)) {
+			STATS(record_lookup(table, probes, 1);)
+			return (void *) (record->key + IMAGE_PAD(length));
+		}
+
+		offset += record_size(record->key_length, table->entry_width);
+	}
+
+	STATS(record_lookup(table, probes, 0);)
+
+	return NULL;
+}
+
+static void image_stats(table_t * table, ht_stats_t * stats)
+{
+	const uint64_t * offsets = (const uint64_t *) (table->image + sizeof(ht_image_header_t));
+
+	for(size_t i = 0; i < table->bucket_count; i++) {
+		size_t length = 0;
+
+		for(uint64_t offset = offsets[i]; offset < offsets[i + 1]; length++)
+			offset += record_size(((const ht_image_record_t *) (table->image + offset))->key_length, table->entry_width);
+
+		stats->chain_lengths[length < HT_STATS_CHAINS ? length : HT_STATS_CHAINS - 1]++;
+
+		if(length > stats->max_chain)
+			stats->max_chain = length;
+	}
+}
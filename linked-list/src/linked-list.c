@@ -4,16 +4,33 @@
  * Date:		10/10/19
  * Licence:		GNU GPL V3
  *
- * Library for a fully generic and thread-safe singly linked list
+ * Library for a fully generic and thread-safe doubly linked list
  *
  * Return/exit codes:
  *		LIST_OK			- No error
  *		SIZE_ERROR		- list size error (invalid block size or number of datas)
  *		MEM_ERROR		- Memory allocation error
  *		INDEX_ERROR		- Couldn't pop data from the list
+ *		MODE_ERROR		- Operation is not available for unrolled lists
  *
  * All functions returning pointers will return NULL on memory allocation faliure, else they will return an error for the user to handle
  *
+ * Each element and its data share one allocation, taken from the pool given to llist_init_opts() if there is one
+ *
+ * Elements link to both neighbours, so given an element llist_remove(), llist_insert_before(),
+ * llist_move_to_front() and llist_move_to_back() are O(1). They trust that the element belongs to the
+ * list rather than walking it to check.
+ *
+ * Unrolled lists store their elements inline in cache line aligned blocks instead of one node per element.
+ * Pushes fill the tail block and pops consume the head block from the front, so both stay O(1), and
+ * searches and operations walk contiguous memory. Functions taking or returning llist_element_t pointers
+ * have no meaning for unrolled lists and return MODE_ERROR or NULL.
+ *
+ * llist_find_u32(), llist_find_u64() and llist_find_u128() compare the leading 4, 8 or 16 bytes of each
+ * element with a key directly instead of calling a comparison function. Where an unrolled list's elements
+ * are exactly one key wide each block is scanned with the widest of AVX2, SSE2 or plain C that CPUID
+ * reports, chosen on the first call.
+ *
  * Todo:
  *		- Add secure versions of llist_destroy(), llist_pop(), and llist_remove() to overwrite memory blocks that are no longer in use
  *		- Add a parameter to llist_init() containing a function pointer detailing how to delete the data stored in each node
@@ -22,18 +39,97 @@
 #include "../include/linked-list.h"
 
 #include <string.h>
+#include <stddef.h>
 #include <pthread.h>
 #include <errno.h>
 
+#define ELEMENT_SIZE ((sizeof(llist_element_t) + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1))	/* Offset of the data from the start of its element */
+
+/* The data is stored directly after the element, so every element is a single allocation */
+static inline llist_element_t * alloc_element(llist_t * list)
+{
+	llist_element_t * element = list->pool ? pool_alloc(list->pool) : malloc(ELEMENT_SIZE + list->data_width);
+
+	if(element)
+		element->data = (char *) element + ELEMENT_SIZE;
+
+	return element;
+}
+
+static inline void free_element(llist_t * list, llist_element_t * element)
+{
+	if(list->pool)
+		pool_free(list->pool, element);
+	else
+		free(element);
+}
+
+/* Detach an element from its neighbours without freeing it or changing the length */
+static inline void unlink_element(llist_t * list, llist_element_t * element)
+{
+	if(element->prev)
+		element->prev->next = element->next;
+	else
+		list->head = element->next;
+
+	if(element->next)
+		element->next->prev = element->prev;
+	else
+		list->tail = element->prev;
+}
+
+/* Restore every prev link and the tail after the next links have been rearranged */
+static void relink_elements(llist_t * list)
+{
+	llist_element_t * prev = NULL;
+
+	for(llist_element_t * curr = list->head; curr != NULL; curr = curr->next) {
+		curr->prev = prev;
+		prev = curr;
+	}
+
+	list->tail = prev;
+}
+
+static inline void * block_element(llist_t * list, llist_block_t * block, size_t index)
+{
+	return block->data + index * list->data_width;
+}
+
+size_t llist_node_size(size_t data_width)
+{
+	return ELEMENT_SIZE + data_width;
+}
+
 int llist_init(llist_t * list, size_t data_width)
+{
+	return llist_init_opts(list, data_width, NULL);
+}
+
+int llist_init_opts(llist_t * list, size_t data_width, const llist_options_t * options)
 {
 	if(data_width <= 0)
 		return SIZE_ERROR;
+
+	if(options && options->pool && options->pool->object_size < llist_node_size(data_width))
+		return SIZE_ERROR;
 	
 	list->tail			= NULL;
 	list->head			= NULL;
 	list->data_width	= data_width;
 	list->length		= 0;
+	list->pool			= options ? options->pool : NULL;
+	list->head_block	= NULL;
+	list->tail_block	= NULL;
+	list->block_capacity	= 0;
+	list->block_bytes		= 0;
+
+	if(options && options->block_size) {
+		size_t bytes = options->block_size > sizeof(llist_block_t) + data_width ? options->block_size : sizeof(llist_block_t) + data_width;
+
+		list->block_bytes		= (bytes + LLIST_CACHE_LINE - 1) & ~(LLIST_CACHE_LINE - 1);
+		list->block_capacity	= (list->block_bytes - sizeof(llist_block_t)) / data_width;
+	}
 
 	pthread_mutex_init(&list->lock, NULL);
 
@@ -47,9 +143,17 @@ void llist_destroy(llist_t * list)
 
 	while(list->head) {
 		llist_element_t * temp = list->head->next;
-		free(list->head);
+		free_element(list, list->head);
 		list->head = temp;
 	}
+
+	while(list->head_block) {
+		llist_block_t * temp = list->head_block->next;
+		free(list->head_block);
+		list->head_block = temp;
+	}
+
+	list->tail_block	= NULL;
 	
 	list->data_width	= 0;
 	list->tail			= NULL;
@@ -60,42 +164,110 @@ void llist_destroy(llist_t * list)
 	return;
 }
 
+static void * llist_emplace_unrolled(llist_t * list)
+{
+	llist_block_t * block = list->tail_block;
+
+	if(!block || block->first + block->count == list->block_capacity) {
+		if(!(block = aligned_alloc(LLIST_CACHE_LINE, list->block_bytes)))
+			return NULL;
+
+		block->next		= NULL;
+		block->first	= 0;
+		block->count	= 0;
+
+		if(list->head_block == NULL)
+			list->head_block = block;
+		else
+			list->tail_block->next = block;
+
+		list->tail_block = block;
+	}
+
+	block->count++;
+	list->length++;
+
+	return block_element(list, block, block->first + block->count - 1);
+}
+
 int llist_push(void const * const data, llist_t * list)
 {
-	llist_element_t * new_element;
+	void * slot = llist_emplace(list);
 
-	if(!(new_element = malloc(sizeof(llist_element_t))) || !(new_element->data = malloc(list->data_width))) {
-		if(new_element)
-			free(new_element);
+	if(!slot)
 		return MEM_ERROR;
-	}
 
-	memcpy(new_element->data, data, list->data_width);
+	memcpy(slot, data, list->data_width);
+
+	return LIST_OK;
+}
+
+void * llist_emplace(llist_t * list)
+{
+	llist_element_t * new_element;
+
+	if(list->block_capacity)
+		return llist_emplace_unrolled(list);
+
+	if(!(new_element = alloc_element(list)))
+		return NULL;
 
 	if(list->head == NULL)
 		list->head = new_element;
 	else
 		list->tail->next = new_element;
 
+	new_element->prev = list->tail;
+	new_element->next = NULL;
 	list->tail = new_element;
-	list->tail->next = NULL;
 
 	list->length++;
 
+	return new_element->data;
+}
+
+static int llist_pop_unrolled(void * const data, llist_t * list)
+{
+	llist_block_t * block = list->head_block;
+
+	if(block == NULL)
+		return INDEX_ERROR;
+
+	memcpy(data, block_element(list, block, block->first), list->data_width);
+	block->first++;
+	list->length--;
+
+	if(--block->count == 0) {
+		list->head_block = block->next;
+
+		if(list->head_block == NULL)
+			list->tail_block = NULL;
+
+		free(block);
+	}
+
 	return LIST_OK;
 }
 
 int llist_pop(void * const data, llist_t * list)
 {
+	if(list->block_capacity)
+		return llist_pop_unrolled(data, list);
+
 	if(list->head == NULL)
 		return INDEX_ERROR;
 
 	memcpy(data, list->head->data, list->data_width);
 
-	free(list->head->data);
 	llist_element_t * temp = list->head;
 	list->head = list->head->next;
-	free(temp);
+
+	if(list->head == NULL)
+		list->tail = NULL;
+	else
+		list->head->prev = NULL;
+
+	free_element(list, temp);
 	list->length--;
 
 	return LIST_OK;
@@ -103,52 +275,86 @@ int llist_pop(void * const data, llist_t * list)
 
 int llist_remove(llist_element_t * element, llist_t * list)
 {
+	if(list->block_capacity)
+		return MODE_ERROR;
+
 	if(element == NULL || list->head == NULL)
 		return INDEX_ERROR;
 
-	if(list->head == element) {
-		list->head = list->head->next;
+	unlink_element(list, element);
+	free_element(list, element);
+	list->length--;
+
+	return LIST_OK;
+}
+
+int llist_move_to_front(llist_element_t * element, llist_t * list)
+{
+	if(list->block_capacity)
+		return MODE_ERROR;
+
+	if(element == NULL || list->head == NULL)
+		return INDEX_ERROR;
+
+	if(element == list->head)
 		return LIST_OK;
-	}
 
-	llist_element_t * prev = NULL;
-	llist_element_t * curr = list->head;
+	unlink_element(list, element);
 
-	while(curr != element) {
-		prev = curr;
-		curr = curr->next;
+	element->prev = NULL;
+	element->next = list->head;
+	list->head->prev = element;
+	list->head = element;
 
-		if(curr == NULL)
-			return INDEX_ERROR;
-	}
+	return LIST_OK;
+}
 
-	prev->next = curr->next;
-	list->length--;
+int llist_move_to_back(llist_element_t * element, llist_t * list)
+{
+	if(list->block_capacity)
+		return MODE_ERROR;
+
+	if(element == NULL || list->head == NULL)
+		return INDEX_ERROR;
+
+	if(element == list->tail)
+		return LIST_OK;
+
+	unlink_element(list, element);
+
+	element->next = NULL;
+	element->prev = list->tail;
+	list->tail->next = element;
+	list->tail = element;
 
 	return LIST_OK;
 }
 
 int	llist_insert_after(void const * const data, llist_element_t * element, llist_t * list)
 {
+	if(list->block_capacity)
+		return MODE_ERROR;
+
 	if(list->head == NULL)
 		return llist_push(data, list);
 
 	llist_element_t * new_element;
 
-	if(!(new_element = malloc(sizeof(llist_element_t))) || !(new_element->data = malloc(list->data_width))) {
-		if(new_element)
-			free(new_element);
+	if(!(new_element = alloc_element(list)))
 		return MEM_ERROR;
-	}
 
 	memcpy(new_element->data, data, list->data_width);
 
 	new_element->next = element->next;
-	element->next = new_element;
+	new_element->prev = element;
 
-	if(element == list->tail)
+	if(element->next)
+		element->next->prev = new_element;
+	else
 		list->tail = new_element;
 
+	element->next = new_element;
+
 	list->length++;
 
 	return LIST_OK;
@@ -156,37 +362,31 @@ int	llist_insert_after(void const * const data, llist_element_t * element, llist
 
 int	llist_insert_before(void const * const data, llist_element_t * element, llist_t * list)
 {
+	if(list->block_capacity)
+		return MODE_ERROR;
+
 	if(list->head == NULL)
 		return llist_push(data, list);
 
-	llist_element_t * prev = list->head;
-	llist_element_t * curr = prev->next;
-
-	while(curr != NULL && curr != element) {
-		curr = curr->next;
-		prev = prev->next;
-	}
-
-	if(curr == NULL)
+	if(element == NULL)
 		return INDEX_ERROR;
 
 	llist_element_t * new_element;
 
-	if(!(new_element = malloc(sizeof(llist_element_t))) || !(new_element->data = malloc(list->data_width))) {
-		if(new_element)
-			free(new_element);
+	if(!(new_element = alloc_element(list)))
 		return MEM_ERROR;
-	}
 
 	memcpy(new_element->data, data, list->data_width);
 
-	if(curr == list->head) {
-		new_element->next = curr;
+	new_element->next = element;
+	new_element->prev = element->prev;
+
+	if(element->prev)
+		element->prev->next = new_element;
+	else
 		list->head = new_element;
-	} else {
-		new_element->next = prev->next;
-		prev->next = new_element;
-	}
+
+	element->prev = new_element;
 
 	list->length++;
 
@@ -204,96 +404,637 @@ llist_element_t * llist_search(void const * const data, int (*compare)(const voi
 	return NULL;
 }
 
-void * llist_peek(void * const data, llist_t * list)
+void * llist_find(void const * const data, int (*compare)(const void * first_element, const void * second_element), llist_t * list)
 {
-	if(list->head == NULL)
+	if(!list->block_capacity) {
+		llist_element_t * element = llist_search(data, compare, list);
+		return element ? element->data : NULL;
+	}
+
+	for(llist_block_t * block = list->head_block; block != NULL; block = block->next) {
+		unsigned char * curr = block_element(list, block, block->first);
+		unsigned char * end = curr + block->count * list->data_width;
+
+		for(; curr != end; curr += list->data_width)
+			if(!(*compare)(curr, data))
+				return curr;
+	}
+
+	return NULL;
+}
+
+/* Scanners return the index of the first of count keys packed back to back in data that equals key, or count */
+typedef size_t (*llist_scan_t)(const unsigned char * data, size_t count, const void * key);
+
+static inline int key_equal(const void * first, const void * second, size_t width)
+{
+	switch(width) { /* Constant widths let the compiler turn each memcmp into one or two loads */
+		case 4:
+			return !memcmp(first, second, 4);
+		case 8:
+			return !memcmp(first, second, 8);
+		default:
+			return !memcmp(first, second, 16);
+	}
+}
+
+static size_t scan_scalar_32(const unsigned char * data, size_t count, const void * key)
+{
+	for(size_t i = 0; i < count; i++)
+		if(key_equal(data + i * 4, key, 4))
+			return i;
+
+	return count;
+}
+
+static size_t scan_scalar_64(const unsigned char * data, size_t count, const void * key)
+{
+	for(size_t i = 0; i < count; i++)
+		if(key_equal(data + i * 8, key, 8))
+			return i;
+
+	return count;
+}
+
+static size_t scan_scalar_128(const unsigned char * data, size_t count, const void * key)
+{
+	for(size_t i = 0; i < count; i++)
+		if(key_equal(data + i * 16, key, 16))
+			return i;
+
+	return count;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+/* Each vector scanner compares whole registers of keys, then finishes the last partial register with the scalar scanner */
+
+__attribute__((target("sse2"))) static size_t scan_sse2_32(const unsigned char * data, size_t count, const void * key)
+{
+	int value;
+	memcpy(&value, key, sizeof(value));
+
+	__m128i needle = _mm_set1_epi32(value);
+	size_t i = 0;
+
+	for(; i + 4 <= count; i += 4) {
+		int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (data + i * 4)), needle)));
+
+		if(mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	return i + scan_scalar_32(data + i * 4, count - i, key);
+}
+
+__attribute__((target("sse2"))) static size_t scan_sse2_64(const unsigned char * data, size_t count, const void * key)
+{
+	long long value;
+	memcpy(&value, key, sizeof(value));
+
+	__m128i needle = _mm_set1_epi64x(value);
+	size_t i = 0;
+
+	for(; i + 2 <= count; i += 2) {
+		__m128i halves = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (data + i * 8)), needle);
+		int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_and_si128(halves, _mm_shuffle_epi32(halves, 0xB1))));	/* SSE2 has no 64 bit compare, so both halves must match */
+
+		if(mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	return i + scan_scalar_64(data + i * 8, count - i, key);
+}
+
+__attribute__((target("sse2"))) static size_t scan_sse2_128(const unsigned char * data, size_t count, const void * key)
+{
+	__m128i needle = _mm_loadu_si128((const __m128i *) key);
+
+	for(size_t i = 0; i < count; i++)
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (data + i * 16)), needle)) == 0xFFFF)
+			return i;
+
+	return count;
+}
+
+__attribute__((target("avx2"))) static size_t scan_avx2_32(const unsigned char * data, size_t count, const void * key)
+{
+	int value;
+	memcpy(&value, key, sizeof(value));
+
+	__m256i needle = _mm256_set1_epi32(value);
+	size_t i = 0;
+
+	for(; i + 8 <= count; i += 8) {
+		int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (data + i * 4)), needle)));
+
+		if(mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	return i + scan_scalar_32(data + i * 4, count - i, key);
+}
+
+__attribute__((target("avx2"))) static size_t scan_avx2_64(const unsigned char * data, size_t count, const void * key)
+{
+	long long value;
+	memcpy(&value, key, sizeof(value));
+
+	__m256i needle = _mm256_set1_epi64x(value);
+	size_t i = 0;
+
+	for(; i + 4 <= count; i += 4) {
+		int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (data + i * 8)), needle)));
+
+		if(mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	return i + scan_scalar_64(data + i * 8, count - i, key);
+}
+
+__attribute__((target("avx2"))) static size_t scan_avx2_128(const unsigned char * data, size_t count, const void * key)
+{
+	__m256i needle = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) key));
+	size_t i = 0;
+
+	for(; i + 2 <= count; i += 2) {
+		unsigned int mask = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (data + i * 16)), needle));
+
+		if((mask & 0xFFFF) == 0xFFFF)
+			return i;
+
+		if(mask >> 16 == 0xFFFF)
+			return i + 1;
+	}
+
+	return i + scan_scalar_128(data + i * 16, count - i, key);
+}
+
+#endif
+
+static llist_scan_t scanners[3] = { scan_scalar_32, scan_scalar_64, scan_scalar_128 };
+static pthread_once_t scanners_once = PTHREAD_ONCE_INIT;
+
+/* Picks the widest scanners the CPU supports, once per process */
+static void select_scanners(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_cpu_init();
+
+	if(__builtin_cpu_supports("avx2")) {
+		scanners[0] = scan_avx2_32;
+		scanners[1] = scan_avx2_64;
+		scanners[2] = scan_avx2_128;
+	} else if(__builtin_cpu_supports("sse2")) {
+		scanners[0] = scan_sse2_32;
+		scanners[1] = scan_sse2_64;
+		scanners[2] = scan_sse2_128;
+	}
+#endif
+}
+
+/* Finds the first element whose leading width bytes equal key, scanning whole blocks at once where elements are exactly a key wide */
+static void * llist_find_width(const void * key, size_t width, llist_scan_t * scanner, llist_t * list)
+{
+	if(list->data_width < width)
+		return NULL;
+
+	if(!list->block_capacity) {
+		for(llist_element_t * curr = list->head; curr != NULL; curr = curr->next)
+			if(key_equal(curr->data, key, width))
+				return curr->data;
+
 		return NULL;
+	}
 
-	if(data)
-		memcpy(data, list->head->data, list->data_width);
+	pthread_once(&scanners_once, select_scanners);
 
-	return list->head->data;
+	for(llist_block_t * block = list->head_block; block != NULL; block = block->next) {
+		unsigned char * curr = block_element(list, block, block->first);
+
+		if(list->data_width == width) {
+			size_t index = (*scanner)(curr, block->count, key);
+
+			if(index < block->count)
+				return curr + index * width;
+
+			continue;
+		}
+
+		for(unsigned char * end = curr + block->count * list->data_width; curr != end; curr += list->data_width)
+			if(key_equal(curr, key, width))
+				return curr;
+	}
+
+	return NULL;
+}
+
+void * llist_find_u32(uint32_t key, llist_t * list)
+{
+	return llist_find_width(&key, sizeof(key), &scanners[0], list);
+}
+
+void * llist_find_u64(uint64_t key, llist_t * list)
+{
+	return llist_find_width(&key, sizeof(key), &scanners[1], list);
+}
+
+void * llist_find_u128(void const * const key, llist_t * list)
+{
+	return llist_find_width(key, 16, &scanners[2], list);
+}
+
+void * llist_peek(void * const data, llist_t * list)
+{
+	void * head;
+
+	if(list->block_capacity)
+		head = list->head_block ? block_element(list, list->head_block, list->head_block->first) : NULL;
+	else
+		head = list->head ? list->head->data : NULL;
+
+	if(head && data)
+		memcpy(data, head, list->data_width);
+
+	return head;
 }
 
 void * llist_peek_tail(void * const data, llist_t * list)
 {
-	if(list->tail == NULL)
-		return NULL;
+	void * tail;
 
-	if(data)
-		memcpy(data, list->tail->data, list->data_width);
+	if(list->block_capacity)
+		tail = list->tail_block ? block_element(list, list->tail_block, list->tail_block->first + list->tail_block->count - 1) : NULL;
+	else
+		tail = list->tail ? list->tail->data : NULL;
+
+	if(tail && data)
+		memcpy(data, tail, list->data_width);
+
+	return tail;
+}
+
+/* Detach the longest non-decreasing run from the front of *source and return its head */
+static llist_element_t * llist_take_run(int (*compare)(const void * first_element, const void * second_element), llist_element_t ** source)
+{
+	llist_element_t * head = *source;
+	llist_element_t * curr = head;
 
-	return list->tail->data;
+	while(curr->next != NULL && compare(curr->next->data, curr->data) >= 0)
+		curr = curr->next;
+
+	*source = curr->next;
+	curr->next = NULL;
+
+	return head;
 }
 
-static void llist_sort_split(llist_element_t * source, llist_element_t ** front, llist_element_t ** back)
+/* Append the merge of two runs to *out and return the new tail. Ties take the first run's element, which keeps the sort stable */
+static llist_element_t * llist_merge_runs(int (*compare)(const void * first_element, const void * second_element), llist_element_t * first, llist_element_t * second, llist_element_t ** out)
 {
-	llist_element_t * slow = source;
-	llist_element_t * fast = source->next;
- 
-	while(fast != NULL) {
-		fast = fast->next;
-		if(fast != NULL) {
-			slow = slow->next;
-			fast = fast->next;
+	llist_element_t * tail = NULL;
+
+	while(first != NULL && second != NULL) {
+		if(compare(second->data, first->data) < 0) {
+			tail = *out = second;
+			second = second->next;
+		} else {
+			tail = *out = first;
+			first = first->next;
 		}
+
+		out = &tail->next;
 	}
 
-	*front = source;
-	*back = slow->next;
-	slow->next = NULL;
+	for(*out = first ? first : second; *out != NULL; out = &(*out)->next)
+		tail = *out;
 
-	return;
+	return tail;
+}
+
+/* Return the length of the non-decreasing run of elements at the start of an array */
+static size_t llist_run_length(int (*compare)(const void * first_element, const void * second_element), const unsigned char * source, size_t count, size_t width)
+{
+	size_t length = 1;
+
+	while(length < count && compare(source + length * width, source + (length - 1) * width) >= 0)
+		length++;
+
+	return length;
 }
 
-static llist_element_t * llist_merge_sorted(int (*compare)(const void * first_element, const void * second_element), llist_element_t * head, llist_element_t * second_head)
+/* Unrolled lists are gathered into an array, merge sorted between it and a second buffer and written back into as few blocks as possible */
+static int llist_sort_unrolled(int (*compare)(const void * first_element, const void * second_element), llist_t * list)
 {
-	llist_element_t * result = NULL;
+	size_t width = list->data_width;
+	size_t count = (size_t) list->length;
+	unsigned char * source = malloc(count * width);
+	unsigned char * destination = malloc(count * width);
+	size_t runs;
+
+	if(!source || !destination) {
+		free(source);
+		free(destination);
+		return MEM_ERROR;
+	}
+
+	unsigned char * curr = source;
+
+	for(llist_block_t * block = list->head_block; block != NULL; block = block->next) {
+		memcpy(curr, block_element(list, block, block->first), block->count * width);
+		curr += block->count * width;
+	}
+
+	do {
+		size_t done = 0;
+
+		for(runs = 0; done < count; runs++) {
+			size_t first = llist_run_length(compare, source + done * width, count - done, width);
+			size_t second = done + first < count ? llist_run_length(compare, source + (done + first) * width, count - done - first, width) : 0;
+			unsigned char * a = source + done * width;
+			unsigned char * b = a + first * width;
+			unsigned char * a_end = b;
+			unsigned char * b_end = b + second * width;
+			unsigned char * out = destination + done * width;
+
+			if(!second) {
+				memcpy(out, a, first * width);
+			} else {
+				runs++;
+
+				while(a != a_end && b != b_end) {
+					if(compare(b, a) < 0) {
+						memcpy(out, b, width);
+						b += width;
+					} else {
+						memcpy(out, a, width);
+						a += width;
+					}
+
+					out += width;
+				}
+
+				memcpy(out, a, a_end - a);
+				memcpy(out + (a_end - a), b, b_end - b);
+			}
+
+			done += first + second;
+		}
+
+		curr = source;
+		source = destination;
+		destination = curr;
+	} while(runs > 2);
+
+	llist_block_t * block = list->head_block;
 
-	if(head == NULL)
-		return second_head;
-	else if(second_head == NULL)
-		return head;
-	 
-	if(compare(head->data, second_head->data) < 0) {
-		result = head;
-		result->next = llist_merge_sorted(compare, head->next, second_head);
-	} else {
-		result = second_head;
-		result->next = llist_merge_sorted(compare, head, second_head->next);
+	for(size_t done = 0; done < count; block = block->next) {
+		size_t fill = count - done < list->block_capacity ? count - done : list->block_capacity;
+
+		memcpy(block->data, source + done * width, fill * width);
+		block->first = 0;
+		block->count = fill;
+		done += fill;
+		list->tail_block = block;
+	}
+
+	while(list->tail_block->next != NULL) {
+		block = list->tail_block->next;
+		list->tail_block->next = block->next;
+		free(block);
 	}
 
-	return result;
+	free(source);
+	free(destination);
+
+	return LIST_OK;
 }
 
-static void llist_sort_internal(int (*compare)(const void * first_element, const void * second_element), llist_element_t ** head)
+/*
+ * Runs are merged like carries in a binary counter: pending[i] holds a run built from about 2^i of
+ * the runs found so far, and earlier elements always sit in higher levels. Sorting needs no recursion
+ * and no memory beyond this array, whatever the list length.
+ */
+#define LLIST_SORT_LEVELS 64
+
+static llist_element_t * llist_sort_chain(int (*compare)(const void * first_element, const void * second_element), llist_element_t * rest, llist_element_t ** tail)
 {
-	llist_element_t * back = NULL;
-	llist_element_t * front = NULL;
+	llist_element_t * pending[LLIST_SORT_LEVELS] = { NULL };
+	llist_element_t * head = NULL;
+	llist_element_t * run;
+	size_t level;
 
-	if(*head == NULL || (*head)->next == NULL)
-		return;
+	while(rest != NULL) {
+		run = llist_take_run(compare, &rest);
 
-	llist_sort_split(*head, &front, &back);
+		for(level = 0; pending[level] != NULL; level++) {
+			llist_merge_runs(compare, pending[level], run, &run);
+			pending[level] = NULL;
+		}
 
-	llist_sort_internal(compare, &front);
-	llist_sort_internal(compare, &back);
+		pending[level] = run;
+	}
 
-	*head = llist_merge_sorted(compare, front, back);
+	for(level = 0; level < LLIST_SORT_LEVELS; level++)
+		if(pending[level] != NULL)
+			*tail = llist_merge_runs(compare, pending[level], head, &head);
 
-	return;
+	return head;
 }
 
 int llist_sort(int (*compare)(const void * first_element, const void * second_element), llist_t * list)
 {
-	if(list->head == NULL)
+	if(list->length == 0)
 		return INDEX_ERROR;
 
-	llist_sort_internal(compare, &list->head);
+	if(list->block_capacity)
+		return llist_sort_unrolled(compare, list);
 
-	for(llist_element_t * curr = list->head; curr != NULL; curr = curr->next)
-		if(curr->next == NULL)
-			list->tail = curr;
+	list->head = llist_sort_chain(compare, list->head, &list->tail);
+
+	relink_elements(list);
+
+	return LIST_OK;
+}
+
+/*
+ * The parallel sort picks splitters from a sample of the list that divide the key space into one
+ * range per thread, then runs two phases, each on a fresh set of threads:
+ *		1. Every thread walks its share of the list and moves each element onto the end of the
+ *		   bucket for its range
+ *		2. Every thread joins the buckets for its range in list order and sorts them
+ * Buckets keep the list order and equal keys always land in the same range, so the ranges linked
+ * end to end are exactly what the stable sequential sort produces.
+ */
+typedef struct llist_sort_worker_t
+{
+	int (*compare)(const void * first_element, const void * second_element);
+	size_t				index;											/* The worker's share of the list and range */
+	size_t				count;											/* The number of workers */
+	llist_element_t *	head;											/* The worker's share of the list, then its sorted range */
+	llist_element_t *	tail;											/* The end of the sorted range */
+	const void **		splitters;										/* The greatest key of every range but the last */
+	llist_element_t **	heads;											/* heads[share * count + range] */
+	llist_element_t **	tails;											/* As heads, for the bucket tails */
+} llist_sort_worker_t;
+
+static void * llist_sort_phase_partition(void * argument)
+{
+	llist_sort_worker_t * worker = argument;
+	llist_element_t ** heads = worker->heads + worker->index * worker->count;
+	llist_element_t ** tails = worker->tails + worker->index * worker->count;
+	llist_element_t * next;
+
+	for(size_t i = 0; i < worker->count; i++)
+		heads[i] = tails[i] = NULL;
+
+	for(llist_element_t * curr = worker->head; curr != NULL; curr = next) {
+		size_t low = 0;
+		size_t high = worker->count - 1;
+
+		while(low < high) { /* Find the first range whose greatest key is not below the element */
+			size_t middle = (low + high) / 2;
+
+			if(worker->compare(curr->data, worker->splitters[middle]) > 0)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+
+		next = curr->next;
+		curr->next = NULL;
+
+		if(tails[low] != NULL)
+			tails[low]->next = curr;
+		else
+			heads[low] = curr;
+
+		tails[low] = curr;
+	}
+
+	return NULL;
+}
+
+static void * llist_sort_phase_sort(void * argument)
+{
+	llist_sort_worker_t * worker = argument;
+	llist_element_t * head = NULL;
+	llist_element_t ** link = &head;
+
+	for(size_t i = 0; i < worker->count; i++) {
+		size_t bucket = i * worker->count + worker->index;
+
+		if(worker->heads[bucket] != NULL) {
+			*link = worker->heads[bucket];
+			link = &worker->tails[bucket]->next;
+		}
+	}
+
+	worker->tail = NULL;
+	worker->head = head ? llist_sort_chain(worker->compare, head, &worker->tail) : NULL;
+
+	return NULL;
+}
+
+/* Runs phase on every worker, the first on the calling thread. A worker whose thread cannot be started runs on the caller once the others are joined */
+static void llist_run_workers(void * (*phase)(void * argument), void * workers, size_t worker_size, size_t count)
+{
+	pthread_t threads[LLIST_SORT_MAX_THREADS];
+	int started[LLIST_SORT_MAX_THREADS];
+	unsigned char * worker = workers;
+
+	for(size_t i = 1; i < count; i++)
+		started[i] = !pthread_create(&threads[i], NULL, phase, worker + i * worker_size);
+
+	phase(worker);
+
+	for(size_t i = 1; i < count; i++) {
+		if(started[i])
+			pthread_join(threads[i], NULL);
+		else
+			phase(worker + i * worker_size);
+	}
+}
+
+int llist_sort_parallel(int (*compare)(const void * first_element, const void * second_element), llist_t * list, int nthreads)
+{
+	size_t count = nthreads < 1 ? 1 : nthreads > LLIST_SORT_MAX_THREADS ? LLIST_SORT_MAX_THREADS : (size_t) nthreads;
+	size_t length = (size_t) list->length;
+
+	if(length == 0)
+		return INDEX_ERROR;
+
+	if(list->block_capacity || count < 2 || length < count * LLIST_PARALLEL_MIN)
+		return llist_sort(compare, list);
+
+	size_t sample_count = count * LLIST_SORT_OVERSAMPLE;
+	const void ** samples = malloc(sample_count * sizeof(const void *));
+	llist_element_t ** heads = malloc(count * count * sizeof(llist_element_t *));
+	llist_element_t ** tails = malloc(count * count * sizeof(llist_element_t *));
+	llist_sort_worker_t workers[LLIST_SORT_MAX_THREADS];
+	llist_element_t * curr = list->head;
+	size_t position = 0;
+	size_t sampled = 0;
+
+	if(!samples || !heads || !tails) {
+		free(samples);
+		free(heads);
+		free(tails);
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < count; i++) { /* Cut the list into equal shares, sampling it at evenly spaced points on the way */
+		size_t end = (i + 1) * length / count;
+
+		workers[i] = (llist_sort_worker_t) { .compare = compare, .index = i, .count = count, .head = curr, .splitters = samples, .heads = heads, .tails = tails };
+
+		for(;; curr = curr->next) {
+			if(sampled < sample_count && position == sampled * length / sample_count)
+				samples[sampled++] = curr->data;
+
+			if(++position == end)
+				break;
+		}
+
+		llist_element_t * next = curr->next;
+		curr->next = NULL;
+		curr = next;
+	}
+
+	for(size_t i = 1; i < sample_count; i++) { /* Only a few thousand samples at most */
+		const void * sample = samples[i];
+		size_t j = i;
+
+		for(; j > 0 && compare(samples[j - 1], sample) > 0; j--)
+			samples[j] = samples[j - 1];
+
+		samples[j] = sample;
+	}
+
+	for(size_t i = 0; i + 1 < count; i++)
+		samples[i] = samples[(i + 1) * LLIST_SORT_OVERSAMPLE - 1];
+
+	llist_run_workers(llist_sort_phase_partition, workers, sizeof(workers[0]), count);
+	llist_run_workers(llist_sort_phase_sort, workers, sizeof(workers[0]), count);
+
+	llist_element_t ** link = &list->head;
+
+	for(size_t i = 0; i < count; i++) {
+		if(workers[i].head != NULL) {
+			*link = workers[i].head;
+			list->tail = workers[i].tail;
+			link = &list->tail->next;
+		}
+	}
+
+	relink_elements(list);
+
+	free(samples);
+	free(heads);
+	free(tails);
 
 	return LIST_OK;
 }
@@ -303,5 +1044,175 @@ void llist_operate(void(*operation)(const void * data, const void * parameter),
 	for(llist_element_t * curr = list->head; curr != NULL; curr = curr->next)
 		operation(curr->data, parameter);
 
+	for(llist_block_t * block = list->head_block; block != NULL; block = block->next) {
+		unsigned char * curr = block_element(list, block, block->first);
+		unsigned char * end = curr + block->count * list->data_width;
+
+		for(; curr != end; curr += list->data_width)
+			operation(curr, parameter);
+	}
+
 	return;
 }
+
+/*
+ * llist_operate_parallel() and llist_reduce() cut the list into chunks of LLIST_REDUCE_CHUNK elements
+ * with one walk, recording where each chunk starts, then give each thread a run of whole chunks. For
+ * llist_reduce() every chunk folds its elements into its own partial result, left to right starting
+ * from the identity, and the caller folds the partials together in list order once the threads are
+ * joined. Chunk boundaries depend only on the length of the list, so the result is the same for every
+ * thread count and is what a sequential left to right fold gives whenever combine is associative.
+ */
+
+typedef struct llist_cursor_t
+{
+	llist_element_t *	element;										/* The current element of a list of nodes */
+	llist_block_t *		block;											/* The current block of an unrolled list */
+	size_t				index;											/* The current element's index in block */
+} llist_cursor_t;
+
+typedef struct llist_apply_worker_t
+{
+	void (*operation)(const void * data, const void * parameter);
+	void (*map)(const void * data, void * value, const void * parameter);
+	void (*combine)(void * accumulator, const void * value);
+	const void *		parameter;										/* Passed to operation and map */
+	const void *		identity;										/* The value every partial result starts from */
+	llist_t *			list;
+	llist_cursor_t *	starts;											/* Where each chunk starts */
+	size_t				first;											/* The worker's first chunk */
+	size_t				last;											/* One past the worker's last chunk */
+	unsigned char *		partials;										/* One partial result per chunk, stride bytes apart */
+	size_t				width;											/* The size of a mapped value and of a result */
+	size_t				stride;											/* width rounded up to keep each partial aligned */
+	unsigned char *		value;											/* Scratch space the worker maps each element into */
+} llist_apply_worker_t;
+
+static inline void * cursor_data(llist_t * list, llist_cursor_t * cursor)
+{
+	return list->block_capacity ? block_element(list, cursor->block, cursor->index) : cursor->element->data;
+}
+
+static inline void cursor_next(llist_t * list, llist_cursor_t * cursor)
+{
+	if(!list->block_capacity) {
+		cursor->element = cursor->element->next;
+	} else if(++cursor->index == cursor->block->first + cursor->block->count && cursor->block->next) {
+		cursor->block = cursor->block->next;
+		cursor->index = cursor->block->first;
+	}
+}
+
+static void * llist_apply_chunks(void * argument)
+{
+	llist_apply_worker_t * worker = argument;
+	llist_t * list = worker->list;
+	size_t length = (size_t) list->length;
+
+	for(size_t chunk = worker->first; chunk < worker->last; chunk++) {
+		llist_cursor_t cursor = worker->starts[chunk];
+		size_t end = (chunk + 1) * LLIST_REDUCE_CHUNK < length ? (chunk + 1) * LLIST_REDUCE_CHUNK : length;
+		unsigned char * partial = worker->partials + chunk * worker->stride;
+
+		if(worker->combine)
+			memcpy(partial, worker->identity, worker->width);
+
+		for(size_t i = chunk * LLIST_REDUCE_CHUNK; i < end; i++, cursor_next(list, &cursor)) {
+			void * data = cursor_data(list, &cursor);
+
+			if(worker->combine) {
+				worker->map(data, worker->value, worker->parameter);
+				worker->combine(partial, worker->value);
+			} else {
+				worker->operation(data, worker->parameter);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Splits the list into chunks and runs the workers over them. worker->partials must hold a partial per chunk when reducing */
+static int llist_apply_parallel(llist_apply_worker_t * worker, int nthreads)
+{
+	llist_t * list = worker->list;
+	size_t length = (size_t) list->length;
+	size_t chunks = (length + LLIST_REDUCE_CHUNK - 1) / LLIST_REDUCE_CHUNK;
+	size_t count = nthreads < 1 ? 1 : nthreads > LLIST_SORT_MAX_THREADS ? LLIST_SORT_MAX_THREADS : (size_t) nthreads;
+
+	if(length < count * LLIST_PARALLEL_MIN) /* Too little work to be worth a thread each */
+		count = length / LLIST_PARALLEL_MIN > 1 ? length / LLIST_PARALLEL_MIN : 1;
+
+	if(count > chunks)
+		count = chunks;
+
+	llist_cursor_t * starts = malloc(chunks * sizeof(llist_cursor_t));
+	unsigned char * values = worker->stride ? malloc(count * worker->stride) : NULL;	/* Only reductions need scratch values */
+	llist_apply_worker_t workers[LLIST_SORT_MAX_THREADS];
+
+	if(!starts || (worker->stride && !values)) {
+		free(starts);
+		free(values);
+		return MEM_ERROR;
+	}
+
+	llist_cursor_t cursor = { .element = list->head, .block = list->head_block, .index = list->head_block ? list->head_block->first : 0 };
+
+	for(size_t i = 0; i < length; i++, cursor_next(list, &cursor))
+		if(i % LLIST_REDUCE_CHUNK == 0)
+			starts[i / LLIST_REDUCE_CHUNK] = cursor;
+
+	for(size_t i = 0; i < count; i++) {
+		workers[i]			= *worker;
+		workers[i].starts	= starts;
+		workers[i].first	= i * chunks / count;
+		workers[i].last		= (i + 1) * chunks / count;
+		workers[i].value	= values ? values + i * worker->stride : NULL;
+	}
+
+	llist_run_workers(llist_apply_chunks, workers, sizeof(workers[0]), count);
+
+	free(starts);
+	free(values);
+
+	return LIST_OK;
+}
+
+int llist_operate_parallel(void (*operation)(const void * data, const void * parameter), const void * parameter, llist_t * list, int nthreads)
+{
+	llist_apply_worker_t worker = { .operation = operation, .parameter = parameter, .list = list };
+
+	if(list->length == 0)
+		return LIST_OK;
+
+	return llist_apply_parallel(&worker, nthreads);
+}
+
+int llist_reduce(void (*map)(const void * data, void * value, const void * parameter), void (*combine)(void * accumulator, const void * value), const void * identity, void * result, size_t width, const void * parameter, llist_t * list, int nthreads)
+{
+	size_t stride = (width + _Alignof(max_align_t) - 1) & ~(_Alignof(max_align_t) - 1);
+	size_t chunks = ((size_t) list->length + LLIST_REDUCE_CHUNK - 1) / LLIST_REDUCE_CHUNK;
+
+	if(width == 0)
+		return SIZE_ERROR;
+
+	memcpy(result, identity, width);
+
+	if(chunks == 0)
+		return LIST_OK;
+
+	llist_apply_worker_t worker = { .map = map, .combine = combine, .parameter = parameter, .identity = identity, .list = list, .width = width, .stride = stride };
+
+	if(!(worker.partials = malloc(chunks * stride)))
+		return MEM_ERROR;
+
+	int status = llist_apply_parallel(&worker, nthreads);
+
+	if(status == LIST_OK)
+		for(size_t i = 0; i < chunks; i++)
+			combine(result, worker.partials + i * stride);
+
+	free(worker.partials);
+
+	return status;
+}
@@ -0,0 +1,45 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define POOL_OK			0	/* Operation completed successfully */
+#define POOL_MEM_ERROR	-1	/* Memory allocation error */
+#define POOL_SIZE_ERROR	-2	/* Object size is not usable */
+
+#define POOL_SLAB_SIZE		(size_t) 65536	/* Bytes requested from malloc each time the pool runs dry */
+#define POOL_BATCH			(size_t) 32		/* Objects moved between a thread's free list and the shared depot at once */
+#define POOL_CACHE_SLOTS	8				/* Pools a thread keeps a free list for at once */
+
+typedef struct pool_slab_t pool_slab_t;
+typedef struct pool_cache_t pool_cache_t;
+
+typedef struct pool_t {
+	size_t object_size;			/* The size of every object, rounded up to the maximum alignment */
+	size_t generation;			/* Unique to this pool, so free lists of a destroyed pool at the same address are never used */
+	pthread_mutex_t lock;		/* Guards every field below */
+	void * depot;				/* Objects returned by threads with too many free ones, linked through their first word */
+	size_t depot_count;			/* The number of objects in the depot */
+	pool_slab_t * slabs;		/* Every slab allocated, freed by pool_destroy */
+	char * carve;				/* The next uncarved byte in the newest slab */
+	char * carve_end;			/* The end of the newest slab */
+	size_t total_bytes;			/* Bytes allocated for slabs, excluding their headers */
+	size_t orphan_frees;		/* Objects freed by threads that could not get a free list of their own */
+	pool_cache_t * caches;		/* Per thread free lists and counters, owned by the pool */
+	struct pool_t * next;		/* The next live pool */
+} pool_t;
+
+typedef struct pool_stats_t {
+	size_t live_bytes;			/* Bytes in objects handed out and not yet freed */
+	size_t free_bytes;			/* Bytes in free lists or not yet carved from a slab */
+	size_t total_bytes;			/* Bytes held by the pool, the sum of the two above */
+} pool_stats_t;
+
+int pool_init(pool_t * pool, size_t object_size);			/* Initialise a pool of fixed size objects */
+void * pool_alloc(pool_t * pool);							/* Return an object from the calling thread's free list, the depot or a new slab, NULL on failure */
+void pool_free(pool_t * pool, void * object);				/* Return an object to the calling thread's free list */
+void pool_stats(pool_t * pool, pool_stats_t * stats);		/* Fill stats with the pool's current byte counts */
+void pool_destroy(pool_t * pool);							/* Free every slab, no object from the pool may still be in use */
+
+#endif
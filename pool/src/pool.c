@@ -0,0 +1,400 @@
+/*
+ * Filename:	pool.c
+ * Author:		Jess Turner
+ * Date:		16/10/26
+ * Licence:		GNU GPL V3
+ *
+ * Pool allocator for fixed size objects such as list elements and hash table entries
+ *
+ * Objects are carved from large slabs and recycled through free lists instead of going back to
+ * malloc, so a structure that keeps adding and removing nodes stops paying for the allocator and
+ * stops fragmenting the heap. Freed objects are linked through their first word.
+ *
+ * Every thread keeps its own free list for each pool it uses, so allocating and freeing take no
+ * locks. Lists are balanced through a shared depot in batches of POOL_BATCH: a thread whose list
+ * runs dry takes a batch from the depot before carving new objects, and a thread holding twice that
+ * many free objects gives a batch back. A producer on one thread and a consumer on another therefore
+ * keep reusing the same objects instead of growing the pool.
+ *
+ * A thread's free lists are returned to the depot when it exits. Free lists are found through a
+ * small table per thread, and when it is full the least recently used list is evicted and
+ * returned in the same way.
+ * Pools are kept in a global list so a list is never returned to a pool that has been destroyed.
+ *
+ * Slabs are only returned to malloc by pool_destroy.
+ *
+ * Return/exit codes:
+ *		POOL_OK			- The operation completed successfuly
+ *		POOL_MEM_ERROR	- Memory allocation error
+ *		POOL_SIZE_ERROR	- The object size is zero
+ *
+ */
+
+#include <stddef.h>
+
+#include "../include/pool.h"
+
+#define ALIGNMENT _Alignof(max_align_t)
+
+#define LOAD(x)			__atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STORE(x, value)	__atomic_store_n(&(x), (value), __ATOMIC_RELAXED)
+
+struct pool_slab_t {
+	struct pool_slab_t * next;	/* The previously allocated slab */
+	max_align_t bytes[];		/* The objects carved from this slab */
+};
+
+struct pool_cache_t {
+	void * free_list;			/* Freed objects, only touched by the owning thread */
+	void * tail;				/* The last object on the free list, so the list can be returned in one step */
+	size_t count;				/* The number of objects on the free list */
+	size_t allocs;				/* Objects allocated through this list, written by the owner and read by pool_stats */
+	size_t frees;				/* Objects freed through this list, as above */
+	int owned;					/* Whether a thread is using the list, guarded by the pool lock */
+	struct pool_cache_t * next;	/* The next list belonging to the pool */
+};
+
+typedef struct pool_slot_t {
+	pool_t * pool;				/* The pool the list belongs to */
+	size_t generation;			/* The pool's generation when the list was claimed */
+	pool_cache_t * cache;		/* The thread's free list for the pool */
+	size_t used;				/* The thread's clock when the slot was last used, for choosing which slot to evict */
+} pool_slot_t;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static pool_t * registry = NULL;
+static size_t next_generation = 0;
+
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t thread_key;
+static _Thread_local pool_slot_t slots[POOL_CACHE_SLOTS];
+static _Thread_local size_t slot_clock = 0;
+
+/* Called with the registry locked, so the pool cannot be destroyed underneath */
+static int pool_alive(pool_t * pool, size_t generation)
+{
+	for(pool_t * cur_pool = registry; cur_pool; cur_pool = cur_pool->next)
+		if(cur_pool == pool && cur_pool->generation == generation)
+			return 1;
+
+	return 0;
+}
+
+/* Called with the pool locked */
+static void push_depot(pool_t * pool, void * head, void * tail, size_t count)
+{
+	*(void **) tail = pool->depot;
+	pool->depot = head;
+	pool->depot_count += count;
+}
+
+static void release_slot(pool_slot_t * slot)
+{
+	pthread_mutex_lock(&registry_lock);
+
+	if(pool_alive(slot->pool, slot->generation)) {
+		pool_t * pool = slot->pool;
+		pool_cache_t * cache = slot->cache;
+
+		pthread_mutex_lock(&pool->lock);
+
+		if(cache->free_list)
+			push_depot(pool, cache->free_list, cache->tail, cache->count);
+
+		cache->free_list = NULL;
+		cache->tail = NULL;
+		cache->count = 0;
+		cache->owned = 0;
+
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	pthread_mutex_unlock(&registry_lock);
+
+	slot->pool = NULL;
+}
+
+static void release_thread(void * record)
+{
+	pool_slot_t * thread_slots = record;
+
+	for(size_t i = 0; i < POOL_CACHE_SLOTS; i++)
+		if(thread_slots[i].pool)
+			release_slot(&thread_slots[i]);
+}
+
+static void create_thread_key(void)
+{
+	pthread_key_create(&thread_key, release_thread);
+}
+
+static pool_cache_t * claim_cache(pool_t * pool, pool_slot_t * slot)
+{
+	pool_cache_t * cache;
+
+	pthread_once(&thread_key_once, create_thread_key);
+	pthread_setspecific(thread_key, slots);
+
+	if(slot->pool)
+		release_slot(slot);
+
+	pthread_mutex_lock(&pool->lock);
+
+	for(cache = pool->caches; cache && cache->owned; cache = cache->next);
+
+	if(!cache && (cache = calloc(1, sizeof(pool_cache_t)))) {
+		cache->next = pool->caches;
+		pool->caches = cache;
+	}
+
+	if(cache)
+		cache->owned = 1;
+
+	pthread_mutex_unlock(&pool->lock);
+
+	if(!cache)
+		return NULL;
+
+	slot->pool = pool;
+	slot->generation = pool->generation;
+	slot->cache = cache;
+	slot->used = ++slot_clock;
+
+	return cache;
+}
+
+/* An empty slot if there is one, otherwise the least recently used */
+static pool_slot_t * victim_slot(void)
+{
+	pool_slot_t * victim = &slots[0];
+
+	for(size_t i = 0; i < POOL_CACHE_SLOTS; i++) {
+		if(!slots[i].pool)
+			return &slots[i];
+
+		if(slots[i].used < victim->used)
+			victim = &slots[i];
+	}
+
+	return victim;
+}
+
+static inline pool_cache_t * own_cache(pool_t * pool)
+{
+	for(size_t i = 0; i < POOL_CACHE_SLOTS; i++) {
+		if(slots[i].pool == pool && slots[i].generation == pool->generation) {
+			slots[i].used = ++slot_clock;
+			return slots[i].cache;
+		}
+	}
+
+	return claim_cache(pool, victim_slot());
+}
+
+static int refill(pool_t * pool, pool_cache_t * cache)
+{
+	pthread_mutex_lock(&pool->lock);
+
+	if(pool->depot) {
+		void * head = pool->depot;
+		void * tail = head;
+		size_t count = 1;
+
+		for(; count < POOL_BATCH && *(void **) tail; count++)
+			tail = *(void **) tail;
+
+		pool->depot = *(void **) tail;
+		pool->depot_count -= count;
+		*(void **) tail = NULL;
+
+		cache->free_list = head;
+		cache->tail = tail;
+		cache->count = count;
+
+		pthread_mutex_unlock(&pool->lock);
+
+		return POOL_OK;
+	}
+
+	for(size_t i = 0; i < POOL_BATCH; i++) {
+		if(!pool->carve || (size_t) (pool->carve_end - pool->carve) < pool->object_size) {
+			if(i) /* Whatever is left of the slab is carved on the next refill */
+				break;
+
+			size_t size = pool->object_size * POOL_BATCH > POOL_SLAB_SIZE ? pool->object_size * POOL_BATCH : POOL_SLAB_SIZE;
+			pool_slab_t * slab = malloc(sizeof(pool_slab_t) + size);
+
+			if(!slab) {
+				pthread_mutex_unlock(&pool->lock);
+				return POOL_MEM_ERROR;
+			}
+
+			slab->next = pool->slabs;
+			pool->slabs = slab;
+			pool->carve = (char *) slab->bytes;
+			pool->carve_end = pool->carve + size;
+			pool->total_bytes += size;
+		}
+
+		if(!cache->free_list) /* Refills only start on an empty list, so the first object carved stays last */
+			cache->tail = pool->carve;
+
+		*(void **) pool->carve = cache->free_list;
+		cache->free_list = pool->carve;
+		cache->count++;
+
+		pool->carve += pool->object_size;
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return POOL_OK;
+}
+
+static void drain(pool_t * pool, pool_cache_t * cache)
+{
+	void * head = cache->free_list;
+	void * tail = head;
+
+	for(size_t i = 1; i < POOL_BATCH; i++)
+		tail = *(void **) tail;
+
+	cache->free_list = *(void **) tail;
+	cache->count -= POOL_BATCH;
+
+	pthread_mutex_lock(&pool->lock);
+	push_depot(pool, head, tail, POOL_BATCH);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+int pool_init(pool_t * pool, size_t object_size)
+{
+	if(object_size == 0)
+		return POOL_SIZE_ERROR;
+
+	if(object_size < sizeof(void *))
+		object_size = sizeof(void *);
+
+	pool->object_size = (object_size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	pool->depot = NULL;
+	pool->depot_count = 0;
+	pool->slabs = NULL;
+	pool->carve = NULL;
+	pool->carve_end = NULL;
+	pool->total_bytes = 0;
+	pool->orphan_frees = 0;
+	pool->caches = NULL;
+
+	pthread_mutex_init(&pool->lock, NULL);
+
+	pthread_mutex_lock(&registry_lock);
+
+	pool->generation = ++next_generation;
+	pool->next = registry;
+	registry = pool;
+
+	pthread_mutex_unlock(&registry_lock);
+
+	return POOL_OK;
+}
+
+void * pool_alloc(pool_t * pool)
+{
+	pool_cache_t * cache = own_cache(pool);
+	void * object;
+
+	if(!cache || (!cache->free_list && refill(pool, cache) != POOL_OK))
+		return NULL;
+
+	object = cache->free_list;
+	cache->free_list = *(void **) object;
+	cache->count--;
+
+	if(!cache->free_list)
+		cache->tail = NULL;
+
+	STORE(cache->allocs, cache->allocs + 1);
+
+	return object;
+}
+
+void pool_free(pool_t * pool, void * object)
+{
+	if(!object)
+		return;
+
+	pool_cache_t * cache = own_cache(pool);
+
+	if(!cache) { /* Without a free list of its own the thread hands objects straight to the depot */
+		pthread_mutex_lock(&pool->lock);
+		push_depot(pool, object, object, 1);
+		pool->orphan_frees++;
+		pthread_mutex_unlock(&pool->lock);
+		return;
+	}
+
+	if(!cache->free_list)
+		cache->tail = object;
+
+	*(void **) object = cache->free_list;
+	cache->free_list = object;
+	cache->count++;
+
+	STORE(cache->frees, cache->frees + 1);
+
+	if(cache->count >= POOL_BATCH << 1)
+		drain(pool, cache);
+}
+
+void pool_stats(pool_t * pool, pool_stats_t * stats)
+{
+	size_t allocs = 0;
+	size_t frees = 0;
+
+	pthread_mutex_lock(&pool->lock);
+
+	for(pool_cache_t * cache = pool->caches; cache; cache = cache->next) {
+		allocs += LOAD(cache->allocs);
+		frees += LOAD(cache->frees);
+	}
+
+	stats->total_bytes = pool->total_bytes;
+	stats->live_bytes = (allocs - frees - pool->orphan_frees) * pool->object_size;
+	stats->free_bytes = stats->total_bytes - stats->live_bytes;
+
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_destroy(pool_t * pool)
+{
+	pthread_mutex_lock(&registry_lock);
+
+	for(pool_t ** cur_pool = &registry; *cur_pool; cur_pool = &(*cur_pool)->next) {
+		if(*cur_pool == pool) {
+			*cur_pool = pool->next;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&registry_lock);
+
+	while(pool->caches) {
+		pool_cache_t * temp = pool->caches->next;
+		free(pool->caches);
+		pool->caches = temp;
+	}
+
+	while(pool->slabs) {
+		pool_slab_t * temp = pool->slabs->next;
+		free(pool->slabs);
+		pool->slabs = temp;
+	}
+
+	pthread_mutex_destroy(&pool->lock);
+
+	pool->depot = NULL;
+	pool->depot_count = 0;
+	pool->carve = NULL;
+	pool->carve_end = NULL;
+	pool->total_bytes = 0;
+}
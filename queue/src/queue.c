@@ -0,0 +1,362 @@
+/*
+ * Filename:	queue.c
+ * Author:		Jess Turner
+ * Date:		16/10/26
+ * Licence:		GNU GPL V3
+ *
+ * Bounded multi-producer multi-consumer FIFO queue of fixed width elements
+ *
+ * Elements are copied into a ring of cells allocated once by queue_init, so pushing and popping never
+ * allocate. Every cell carries a sequence number saying whose turn it is: a cell at position pos is
+ * free for the producer claiming pos when its sequence is pos, and holds an element for the consumer
+ * claiming pos once it is pos + 1. The consumer then sets it to pos + capacity, handing it to the
+ * producer one lap later. Producers and consumers claim positions with a compare and swap on their
+ * own counter and only ever touch the cells they claimed, so neither side takes a lock.
+ *
+ * Batch operations check the sequences of the cells from their position on and claim the run that
+ * is already handed over with one compare and swap. A run stops short at a cell still in use by the
+ * thread that claimed it a lap earlier, or by a producer still writing it, so batches never wait.
+ *
+ * Blocking calls retry for a while and then sleep on a condition variable. A thread that completes a
+ * push or pop only takes the lock to wake sleepers when the waiter count says there are any, so the
+ * fast path stays lock-free.
+ *
+ * Return/exit codes:
+ *		QUEUE_OK			- The operation completed successfuly
+ *		QUEUE_MEM_ERROR		- Memory allocation error
+ *		QUEUE_SIZE_ERROR	- The element width or capacity is zero or too large
+ *		QUEUE_FULL			- No free slot to push into
+ *		QUEUE_EMPTY			- No element to pop
+ *		QUEUE_CLOSED		- The queue has been closed
+ *
+ */
+
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/queue.h"
+
+#define SEQUENCE(cell) ((size_t *) (cell))
+
+static inline unsigned char * queue_cell(queue_t * queue, size_t pos)
+{
+	return queue->cells + (pos & queue->mask) * queue->cell_width;
+}
+
+/* The number of cells from pos on, up to count, whose sequence says they are ready for position
+ * pos + i, which is pos + i + offset. Only the thread claiming a position changes its cell's sequence */
+static inline size_t queue_run(queue_t * queue, size_t pos, size_t count, size_t offset)
+{
+	size_t run = 1; /* The caller has checked the first cell */
+
+	while(run < count && __atomic_load_n(SEQUENCE(queue_cell(queue, pos + run)), __ATOMIC_ACQUIRE) == pos + run + offset)
+		run++;
+
+	return run;
+}
+
+/* Wakes threads asleep on cond. The fence orders the caller's sequence store before reading waiters,
+ * pairing with the increment a sleeper makes before its last check */
+static inline void queue_notify(queue_t * queue, size_t * waiters, pthread_cond_t * cond)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if(__atomic_load_n(waiters, __ATOMIC_RELAXED)) {
+		pthread_mutex_lock(&queue->lock);
+		pthread_cond_broadcast(cond);
+		pthread_mutex_unlock(&queue->lock);
+	}
+}
+
+static int queue_ready(queue_t * queue, int popping)
+{
+	size_t dequeue_pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_SEQ_CST);
+	size_t enqueue_pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_SEQ_CST);
+
+	if(__atomic_load_n(&queue->closed, __ATOMIC_SEQ_CST))
+		return 1;
+
+	return popping ? enqueue_pos != dequeue_pos : enqueue_pos - dequeue_pos <= queue->mask;
+}
+
+/* Returns once the queue may have room (or elements, when popping) or has been closed */
+static void queue_wait(queue_t * queue, int popping)
+{
+	size_t * waiters = popping ? &queue->pop_waiters : &queue->push_waiters;
+	pthread_cond_t * cond = popping ? &queue->not_empty : &queue->not_full;
+
+	for(int spins = 0; spins < QUEUE_SPINS; spins++) {
+		sched_yield();
+
+		if(queue_ready(queue, popping))
+			return;
+	}
+
+	pthread_mutex_lock(&queue->lock);
+	__atomic_add_fetch(waiters, 1, __ATOMIC_SEQ_CST);
+
+	while(!queue_ready(queue, popping))
+		pthread_cond_wait(cond, &queue->lock);
+
+	__atomic_sub_fetch(waiters, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+int queue_init(queue_t * queue, size_t data_width, size_t capacity)
+{
+	size_t slots = 2; /* A single cell cannot tell a full queue from an empty one a lap later */
+
+	if(data_width == 0 || capacity == 0 || data_width > SIZE_MAX / 2 || capacity > SIZE_MAX / 2)
+		return QUEUE_SIZE_ERROR;
+
+	while(slots < capacity)
+		slots <<= 1;
+
+	queue->data_width = data_width;
+	queue->cell_width = (sizeof(size_t) + data_width + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+	queue->mask = slots - 1;
+
+	if(slots > SIZE_MAX / queue->cell_width - QUEUE_CACHE_LINE)
+		return QUEUE_SIZE_ERROR;
+
+	/* Rounded up to whole cache lines as aligned_alloc requires */
+	if(!(queue->cells = aligned_alloc(QUEUE_CACHE_LINE, (slots * queue->cell_width + QUEUE_CACHE_LINE - 1) & ~(size_t) (QUEUE_CACHE_LINE - 1))))
+		return QUEUE_MEM_ERROR;
+
+	for(size_t i = 0; i < slots; i++)
+		*SEQUENCE(queue_cell(queue, i)) = i;
+
+	queue->enqueue_pos = 0;
+	queue->dequeue_pos = 0;
+	queue->closed = 0;
+	queue->push_waiters = 0;
+	queue->pop_waiters = 0;
+
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->not_full, NULL);
+	pthread_cond_init(&queue->not_empty, NULL);
+
+	return QUEUE_OK;
+}
+
+int queue_try_push(void const * const data, queue_t * queue)
+{
+	size_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+	unsigned char * cell;
+
+	if(__atomic_load_n(&queue->closed, __ATOMIC_RELAXED))
+		return QUEUE_CLOSED;
+
+	for(;;) {
+		cell = queue_cell(queue, pos);
+
+		intptr_t diff = (intptr_t) __atomic_load_n(SEQUENCE(cell), __ATOMIC_ACQUIRE) - (intptr_t) pos;
+
+		if(diff == 0) {
+			if(__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if(diff < 0) { /* The cell still holds the element pushed a lap ago */
+			return QUEUE_FULL;
+		} else { /* Another producer claimed pos first */
+			pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(cell + sizeof(size_t), data, queue->data_width);
+	__atomic_store_n(SEQUENCE(cell), pos + 1, __ATOMIC_RELEASE);
+
+	queue_notify(queue, &queue->pop_waiters, &queue->not_empty);
+
+	return QUEUE_OK;
+}
+
+int queue_try_pop(void * const data, queue_t * queue)
+{
+	size_t pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+	unsigned char * cell;
+
+	for(;;) {
+		cell = queue_cell(queue, pos);
+
+		intptr_t diff = (intptr_t) __atomic_load_n(SEQUENCE(cell), __ATOMIC_ACQUIRE) - (intptr_t) (pos + 1);
+
+		if(diff == 0) {
+			if(__atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if(diff < 0) { /* Nothing has been pushed at pos yet, or it is still being written */
+			return QUEUE_EMPTY;
+		} else { /* Another consumer claimed pos first */
+			pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+		}
+	}
+
+	memcpy(data, cell + sizeof(size_t), queue->data_width);
+	__atomic_store_n(SEQUENCE(cell), pos + queue->mask + 1, __ATOMIC_RELEASE);
+
+	queue_notify(queue, &queue->push_waiters, &queue->not_full);
+
+	return QUEUE_OK;
+}
+
+size_t queue_try_push_n(void const * const data, size_t count, queue_t * queue)
+{
+	size_t pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+	size_t run;
+
+	if(count == 0 || __atomic_load_n(&queue->closed, __ATOMIC_RELAXED))
+		return 0;
+
+	for(;;) {
+		intptr_t diff = (intptr_t) __atomic_load_n(SEQUENCE(queue_cell(queue, pos)), __ATOMIC_ACQUIRE) - (intptr_t) pos;
+
+		if(diff < 0) /* Full, or the first cell is still being read by a consumer */
+			return 0;
+
+		if(diff > 0) { /* Another producer claimed pos first */
+			pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		run = queue_run(queue, pos, count, 0);
+
+		if(__atomic_compare_exchange_n(&queue->enqueue_pos, &pos, pos + run, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+
+	for(size_t i = 0; i < run; i++) {
+		unsigned char * cell = queue_cell(queue, pos + i);
+
+		memcpy(cell + sizeof(size_t), (unsigned char *) data + i * queue->data_width, queue->data_width);
+		__atomic_store_n(SEQUENCE(cell), pos + i + 1, __ATOMIC_RELEASE);
+	}
+
+	queue_notify(queue, &queue->pop_waiters, &queue->not_empty);
+
+	return run;
+}
+
+size_t queue_try_pop_n(void * const data, size_t count, queue_t * queue)
+{
+	size_t pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+	size_t run;
+
+	if(count == 0)
+		return 0;
+
+	for(;;) {
+		intptr_t diff = (intptr_t) __atomic_load_n(SEQUENCE(queue_cell(queue, pos)), __ATOMIC_ACQUIRE) - (intptr_t) (pos + 1);
+
+		if(diff < 0) /* Empty, or the first cell is still being written by a producer */
+			return 0;
+
+		if(diff > 0) { /* Another consumer claimed pos first */
+			pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		run = queue_run(queue, pos, count, 1);
+
+		if(__atomic_compare_exchange_n(&queue->dequeue_pos, &pos, pos + run, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+
+	for(size_t i = 0; i < run; i++) {
+		unsigned char * cell = queue_cell(queue, pos + i);
+
+		memcpy((unsigned char *) data + i * queue->data_width, cell + sizeof(size_t), queue->data_width);
+		__atomic_store_n(SEQUENCE(cell), pos + i + queue->mask + 1, __ATOMIC_RELEASE);
+	}
+
+	queue_notify(queue, &queue->push_waiters, &queue->not_full);
+
+	return run;
+}
+
+int queue_push(void const * const data, queue_t * queue)
+{
+	int status;
+
+	while((status = queue_try_push(data, queue)) == QUEUE_FULL)
+		queue_wait(queue, 0);
+
+	return status;
+}
+
+/* Elements pushed by a producer racing with queue_close may be left behind once it reports QUEUE_CLOSED */
+int queue_pop(void * const data, queue_t * queue)
+{
+	int status;
+
+	while((status = queue_try_pop(data, queue)) == QUEUE_EMPTY) {
+		if(__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE) && queue_length(queue) == 0)
+			return QUEUE_CLOSED;
+
+		queue_wait(queue, 1);
+	}
+
+	return status;
+}
+
+int queue_push_n(void const * const data, size_t count, queue_t * queue)
+{
+	for(size_t pushed = 0; pushed < count;) {
+		size_t run = queue_try_push_n((unsigned char *) data + pushed * queue->data_width, count - pushed, queue);
+
+		if(run == 0) {
+			if(__atomic_load_n(&queue->closed, __ATOMIC_RELAXED))
+				return QUEUE_CLOSED;
+
+			queue_wait(queue, 0);
+		}
+
+		pushed += run;
+	}
+
+	return QUEUE_OK;
+}
+
+size_t queue_pop_n(void * const data, size_t count, queue_t * queue)
+{
+	size_t run;
+
+	if(count == 0)
+		return 0;
+
+	while((run = queue_try_pop_n(data, count, queue)) == 0) {
+		if(__atomic_load_n(&queue->closed, __ATOMIC_ACQUIRE) && queue_length(queue) == 0)
+			return 0;
+
+		queue_wait(queue, 1);
+	}
+
+	return run;
+}
+
+size_t queue_length(queue_t * queue)
+{
+	size_t dequeue_pos = __atomic_load_n(&queue->dequeue_pos, __ATOMIC_ACQUIRE);
+	size_t enqueue_pos = __atomic_load_n(&queue->enqueue_pos, __ATOMIC_ACQUIRE);
+
+	return enqueue_pos - dequeue_pos;
+}
+
+void queue_close(queue_t * queue)
+{
+	__atomic_store_n(&queue->closed, 1, __ATOMIC_SEQ_CST);
+
+	pthread_mutex_lock(&queue->lock);
+	pthread_cond_broadcast(&queue->not_full);
+	pthread_cond_broadcast(&queue->not_empty);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+void queue_destroy(queue_t * queue)
+{
+	free(queue->cells);
+	queue->cells = NULL;
+
+	pthread_mutex_destroy(&queue->lock);
+	pthread_cond_destroy(&queue->not_full);
+	pthread_cond_destroy(&queue->not_empty);
+}
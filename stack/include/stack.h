@@ -10,6 +10,11 @@
 #define SIZE_ERROR -2
 
 #define BASE_STACK_LENGTH (2 << 10)
+#define STACK_SHRINK_RATIO (size_t) 4		/* Default occupancy, as a fraction 1/n of capacity, at which the array halves */
+#define STACK_NEVER_SHRINK ((size_t) -1)	/* Shrink ratio that leaves shrinking to stack_shrink_to_fit */
+
+typedef struct stack_lf_t stack_lf_t;
+typedef struct stack_seg_t stack_seg_t;
 
 typedef struct stack {
 	pthread_mutex_t lock;
@@ -17,11 +22,30 @@ typedef struct stack {
 	size_t element_width;
 	size_t allocated_blocks;
 	void * stack_base;
+	stack_lf_t * lock_free;		/* Node storage and heads for lock-free stacks, NULL otherwise */
+	stack_seg_t * segmented;	/* Segment list for segmented stacks, NULL otherwise */
+	size_t min_blocks;			/* The array never shrinks below this many elements */
+	size_t shrink_ratio;		/* The array halves once length falls to allocated_blocks / shrink_ratio */
+	size_t reserved_blocks;		/* The largest stack_reserve since the last stack_shrink_to_fit, also a floor */
 } stack_t;
 
+typedef struct stack_options_t {
+	int lock_free;				/* Non-zero stores elements in linked nodes swapped in and out with compare and swap instead of taking the lock */
+	int segmented;				/* Non-zero grows by adding segments instead of reallocating, so elements never move. Ignored if lock_free is set */
+	size_t min_capacity;		/* Initial capacity and the floor for shrinking, 0 selects BASE_STACK_LENGTH */
+	size_t shrink_ratio;		/* Halve the array once it is 1/shrink_ratio full, at least 2. 0 selects STACK_SHRINK_RATIO */
+} stack_options_t;
+
 int stack_init(stack_t * stack, size_t element_width);
+int stack_init_opts(stack_t * stack, size_t element_width, const stack_options_t * options);
 int stack_push(stack_t * stack, void * data);
 int stack_pop(stack_t * stack, void * location);
+int stack_push_n(stack_t * stack, void * data, size_t count);		/* Push count elements stored bottom first */
+int stack_pop_n(stack_t * stack, void * location, size_t count);	/* Pop count elements into location bottom first, or none if fewer are stored */
+void * stack_peek_ref(stack_t * stack);								/* The top element in place, NULL if empty or lock-free. Only for stacks used by one thread */
+void * stack_emplace(stack_t * stack);								/* Push an uninitialised element and return it, NULL on failure or if lock-free. Only for stacks used by one thread */
+int stack_reserve(stack_t * stack, size_t capacity);		/* Make room for capacity elements and keep it until stack_shrink_to_fit */
+int stack_shrink_to_fit(stack_t * stack);					/* Shrink the array to the larger of its length and floor */
 void stack_destroy(stack_t * stack);
 
 #endif
\ No newline at end of file
@@ -6,6 +6,36 @@
  *
  * Library for a fully generic and thread-safe stack
  *
+ * By default elements are stored in one array guarded by the stack's mutex. The array doubles when it
+ * fills and halves once it falls to 1/shrink_ratio occupancy, a quarter by default, so a workload
+ * that oscillates around a power of two does not reallocate on every push and pop. It never shrinks
+ * below the floor given at initialisation or the largest stack_reserve() since the last
+ * stack_shrink_to_fit().
+ *
+ * Segmented stacks store elements in a list of segments instead, where segment k holds
+ * min_capacity << k elements. Growing allocates the next segment and shrinking frees the last one,
+ * so neither copies an element and element addresses never change while the element is on the
+ * stack. The same hysteresis applies: the last segment is freed once occupancy falls to
+ * 1/shrink_ratio of the total capacity. Finding a slot costs a count leading zeros, and bulk
+ * operations copy once per segment they touch.
+ *
+ * stack_push_n() and stack_pop_n() move a run of elements with one capacity check and one memcpy.
+ * The run is stored bottom first, as stack_push_n() takes it, so a popped run can be pushed straight
+ * back. stack_peek_ref() and stack_emplace() return pointers into the array, which stay valid until
+ * the next call that changes the stack's length, or for as long as the element stays on the stack
+ * if the stack is segmented. The lock is released before the caller uses the pointer, so both are
+ * only for stacks owned by one thread: another thread could pop an emplaced element before it is
+ * written, or move or pop a peeked one. Both return NULL for lock-free stacks, whose nodes can
+ * be popped and reused by another thread at any time.
+ *
+ * Lock-free stacks are Treiber stacks. Every element lives in a node and the head is swapped with a
+ * single compare and swap. Nodes are named by a 32 bit index rather than a pointer, which leaves room
+ * for a 32 bit tag in the same 64 bit word. The tag changes on every swap, so a thread that read the
+ * head before another thread popped and pushed the same node back fails its swap instead of
+ * corrupting the stack (the ABA problem). Popped nodes are recycled through a second stack of the same
+ * kind and only freed by stack_destroy, so reading a node another thread has just popped is always
+ * safe. Node storage grows in chunks of doubling size, which keeps indices stable without copying.
+ *
  * Return/exit codes:
  *		STACK_OK		- No error
  *		SIZE_ERROR		- Stack empty or invalid element width
@@ -17,20 +47,456 @@
 
 #include <pthread.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "../include/stack.h"
 
-int stack_init(stack_t * stack, size_t element_width)
+#define CACHE_LINE 64
+#define LF_CHUNKS 32				/* Chunk k holds LF_CHUNK_BASE << k nodes */
+#define LF_CHUNK_BASE (size_t) 64
+#define LF_NODE_HEADER (size_t) 16	/* Keeps the data in each node 16 byte aligned */
+
+#define SEGMENTS 48					/* Segment k holds base << k elements */
+
+#define LF_INDEX(word)				((uint32_t) (word))
+#define LF_WORD(word, index)		((((word) >> 32) + 1) << 32 | (uint64_t) (index))
+
+struct stack_lf_t {
+	_Alignas(CACHE_LINE) uint64_t head;			/* Tag in the high 32 bits, index + 1 of the top node in the low 32 bits, 0 when empty */
+	_Alignas(CACHE_LINE) uint64_t free_head;	/* As head, for recycled nodes */
+	_Alignas(CACHE_LINE) size_t next_node;		/* Nodes handed out so far, the next new node's index */
+	size_t node_width;							/* The size of a node and its element */
+	pthread_mutex_t grow_lock;					/* Serialises allocating chunks */
+	unsigned char * chunks[LF_CHUNKS];			/* Node storage, published with release stores */
+};
+
+struct stack_seg_t {
+	size_t base;						/* Elements in the first segment */
+	size_t count;						/* Segments allocated */
+	unsigned char * segments[SEGMENTS];
+};
+
+static inline unsigned char * lf_node(stack_lf_t * lf, size_t index)
 {
-	if(element_width <= 0)
+	size_t scaled = index / LF_CHUNK_BASE + 1;
+	int chunk = 63 - __builtin_clzll(scaled);
+
+	return __atomic_load_n(&lf->chunks[chunk], __ATOMIC_ACQUIRE) + (index - LF_CHUNK_BASE * ((1ULL << chunk) - 1)) * lf->node_width;
+}
+
+static inline uint32_t * lf_next(stack_lf_t * lf, size_t index)
+{
+	return (uint32_t *) lf_node(lf, index);
+}
+
+static void lf_push(stack_lf_t * lf, uint64_t * head, size_t index)
+{
+	uint64_t old_head = __atomic_load_n(head, __ATOMIC_RELAXED);
+
+	do {
+		__atomic_store_n(lf_next(lf, index), LF_INDEX(old_head), __ATOMIC_RELAXED);
+	} while(!__atomic_compare_exchange_n(head, &old_head, LF_WORD(old_head, index + 1), 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/* Returns the index of the popped node, or -1 when the stack is empty */
+static long long lf_pop(stack_lf_t * lf, uint64_t * head)
+{
+	uint64_t old_head = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+	uint32_t next;
+
+	do {
+		if(LF_INDEX(old_head) == 0)
+			return -1;
+
+		/* The node may be popped and reused under us, in which case the tag has moved on and the swap fails */
+		next = __atomic_load_n(lf_next(lf, LF_INDEX(old_head) - 1), __ATOMIC_RELAXED);
+	} while(!__atomic_compare_exchange_n(head, &old_head, LF_WORD(old_head, next), 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+	return LF_INDEX(old_head) - 1;
+}
+
+static long long lf_alloc(stack_lf_t * lf)
+{
+	long long index = lf_pop(lf, &lf->free_head);
+
+	if(index >= 0)
+		return index;
+
+	size_t node = __atomic_fetch_add(&lf->next_node, 1, __ATOMIC_RELAXED);
+
+	if(node >= UINT32_MAX)
+		return -1;
+
+	int chunk = 63 - __builtin_clzll(node / LF_CHUNK_BASE + 1);
+
+	if(!__atomic_load_n(&lf->chunks[chunk], __ATOMIC_ACQUIRE)) {
+		pthread_mutex_lock(&lf->grow_lock);
+
+		if(!lf->chunks[chunk]) {
+			unsigned char * storage = malloc((LF_CHUNK_BASE << chunk) * lf->node_width);
+
+			if(!storage) {
+				pthread_mutex_unlock(&lf->grow_lock);
+				return -1; /* The index is lost, later allocations in this chunk retry the malloc */
+			}
+
+			__atomic_store_n(&lf->chunks[chunk], storage, __ATOMIC_RELEASE);
+		}
+
+		pthread_mutex_unlock(&lf->grow_lock);
+	}
+
+	return (long long) node;
+}
+
+static int stack_init_lf(stack_t * stack)
+{
+	stack_lf_t * lf = aligned_alloc(CACHE_LINE, sizeof(stack_lf_t));
+
+	if(!lf)
+		return MEM_ERROR;
+
+	memset(lf, 0, sizeof(stack_lf_t));
+	lf->node_width = LF_NODE_HEADER + ((stack->element_width + LF_NODE_HEADER - 1) & ~(LF_NODE_HEADER - 1));
+	pthread_mutex_init(&lf->grow_lock, NULL);
+
+	stack->lock_free = lf;
+
+	return STACK_OK;
+}
+
+static int stack_push_lf(stack_t * stack, void * data)
+{
+	stack_lf_t * lf = stack->lock_free;
+	long long index = lf_alloc(lf);
+
+	if(index < 0)
+		return MEM_ERROR;
+
+	memcpy(lf_node(lf, index) + LF_NODE_HEADER, data, stack->element_width);
+
+	__atomic_fetch_add(&stack->length, 1, __ATOMIC_RELAXED); /* Counted before it is published so a racing pop never takes length below zero */
+	lf_push(lf, &lf->head, index);
+
+	return STACK_OK;
+}
+
+/* Links count new nodes into a chain and publishes it with a single swap */
+static int stack_push_n_lf(stack_t * stack, void * data, size_t count)
+{
+	stack_lf_t * lf = stack->lock_free;
+	long long first = -1, index = -1;
+
+	for(size_t i = 0; i < count; i++) {
+		long long previous = index;
+
+		if((index = lf_alloc(lf)) < 0) {
+			while(previous >= 0) { /* Hand back the nodes taken so far */
+				long long next = (long long) *lf_next(lf, previous) - 1;
+
+				lf_push(lf, &lf->free_head, previous);
+				previous = next;
+			}
+
+			return MEM_ERROR;
+		}
+
+		memcpy(lf_node(lf, index) + LF_NODE_HEADER, (char *) data + i * stack->element_width, stack->element_width);
+		__atomic_store_n(lf_next(lf, index), (uint32_t) (previous + 1), __ATOMIC_RELAXED);
+
+		if(first < 0)
+			first = index;
+	}
+
+	if(!count)
+		return STACK_OK;
+
+	__atomic_fetch_add(&stack->length, count, __ATOMIC_RELAXED);
+
+	uint64_t old_head = __atomic_load_n(&lf->head, __ATOMIC_RELAXED);
+
+	do {
+		__atomic_store_n(lf_next(lf, first), LF_INDEX(old_head), __ATOMIC_RELAXED);
+	} while(!__atomic_compare_exchange_n(&lf->head, &old_head, LF_WORD(old_head, index + 1), 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	return STACK_OK;
+}
+
+static int stack_pop_lf(stack_t * stack, void * location)
+{
+	stack_lf_t * lf = stack->lock_free;
+	long long index = lf_pop(lf, &lf->head);
+
+	if(index < 0)
 		return SIZE_ERROR;
 
-	if(!(stack->stack_base = malloc(element_width * BASE_STACK_LENGTH)))
+	memcpy(location, lf_node(lf, index) + LF_NODE_HEADER, stack->element_width);
+	lf_push(lf, &lf->free_head, index);
+
+	__atomic_fetch_sub(&stack->length, 1, __ATOMIC_RELAXED);
+
+	return STACK_OK;
+}
+
+/* Pops one node at a time, so other threads may interleave with the run. If the stack runs dry the elements already taken are pushed back */
+static int stack_pop_n_lf(stack_t * stack, void * location, size_t count)
+{
+	size_t popped;
+
+	for(popped = 0; popped < count; popped++)
+		if(stack_pop_lf(stack, (char *) location + (count - popped - 1) * stack->element_width) != STACK_OK)
+			break;
+
+	if(popped == count)
+		return STACK_OK;
+
+	stack_push_n_lf(stack, (char *) location + (count - popped) * stack->element_width, popped);
+
+	return SIZE_ERROR;
+}
+
+/* Allocates every chunk needed to hold capacity nodes up front */
+static int stack_reserve_lf(stack_t * stack, size_t capacity)
+{
+	stack_lf_t * lf = stack->lock_free;
+	int status = STACK_OK;
+
+	if(capacity > UINT32_MAX)
+		return MEM_ERROR;
+
+	pthread_mutex_lock(&lf->grow_lock);
+
+	for(int chunk = 0; capacity && chunk <= 63 - __builtin_clzll((capacity - 1) / LF_CHUNK_BASE + 1); chunk++) {
+		if(!lf->chunks[chunk]) {
+			unsigned char * storage = malloc((LF_CHUNK_BASE << chunk) * lf->node_width);
+
+			if(!storage) {
+				status = MEM_ERROR;
+				break;
+			}
+
+			__atomic_store_n(&lf->chunks[chunk], storage, __ATOMIC_RELEASE);
+		}
+	}
+
+	pthread_mutex_unlock(&lf->grow_lock);
+
+	return status;
+}
+
+static void stack_destroy_lf(stack_t * stack)
+{
+	for(size_t i = 0; i < LF_CHUNKS; i++)
+		free(stack->lock_free->chunks[i]);
+
+	pthread_mutex_destroy(&stack->lock_free->grow_lock);
+	free(stack->lock_free);
+
+	stack->lock_free = NULL;
+}
+
+static int seg_add(stack_t * stack)
+{
+	stack_seg_t * seg = stack->segmented;
+	size_t blocks = seg->base << seg->count;
+
+	if(seg->count == SEGMENTS || blocks >> seg->count != seg->base || blocks > SIZE_MAX / stack->element_width)
+		return MEM_ERROR;
+
+	if(!(seg->segments[seg->count] = malloc(blocks * stack->element_width)))
 		return MEM_ERROR;
 
+	seg->count++;
+	stack->allocated_blocks += blocks;
+
+	return STACK_OK;
+}
+
+static void seg_drop(stack_t * stack)
+{
+	stack_seg_t * seg = stack->segmented;
+
+	seg->count--;
+	stack->allocated_blocks -= seg->base << seg->count;
+
+	free(seg->segments[seg->count]);
+	seg->segments[seg->count] = NULL;
+}
+
+static inline size_t seg_last(stack_seg_t * seg)
+{
+	return seg->base << (seg->count - 1);
+}
+
+static inline unsigned char * stack_slot(stack_t * stack, size_t index)
+{
+	stack_seg_t * seg = stack->segmented;
+
+	if(!seg)
+		return (unsigned char *) stack->stack_base + index * stack->element_width;
+
+	int k = 63 - __builtin_clzll(index / seg->base + 1);
+
+	return seg->segments[k] + (index - seg->base * ((1ULL << k) - 1)) * stack->element_width;
+}
+
+/* Copies count elements between buffer and the stack starting at index, one memcpy per segment */
+static void stack_copy(stack_t * stack, size_t index, void * buffer, size_t count, int to_stack)
+{
+	stack_seg_t * seg = stack->segmented;
+	unsigned char * data = buffer;
+
+	while(count) {
+		size_t run = count;
+
+		if(seg) {
+			int k = 63 - __builtin_clzll(index / seg->base + 1);
+			size_t end = seg->base * ((2ULL << k) - 1);
+
+			if(run > end - index)
+				run = end - index;
+		}
+
+		if(to_stack)
+			memcpy(stack_slot(stack, index), data, run * stack->element_width);
+		else
+			memcpy(data, stack_slot(stack, index), run * stack->element_width);
+
+		data += run * stack->element_width;
+		index += run;
+		count -= run;
+	}
+}
+
+/* Called with the stack locked. A failed resize leaves the old buffer in place. Segmented stacks
+ * round to whole segments, adding them until blocks fit and dropping them while blocks still fit */
+static int stack_resize(stack_t * stack, size_t blocks)
+{
+	if(stack->segmented) {
+		while(stack->allocated_blocks < blocks)
+			if(seg_add(stack) != STACK_OK)
+				return MEM_ERROR;
+
+		while(stack->segmented->count > 1 && stack->allocated_blocks - seg_last(stack->segmented) >= blocks)
+			seg_drop(stack);
+
+		return STACK_OK;
+	}
+
+	if(blocks > SIZE_MAX / stack->element_width)
+		return MEM_ERROR;
+
+	void * stack_base = realloc(stack->stack_base, blocks * stack->element_width);
+
+	if(!stack_base)
+		return MEM_ERROR;
+
+	stack->stack_base = stack_base;
+	stack->allocated_blocks = blocks;
+
+	return STACK_OK;
+}
+
+static inline size_t stack_floor(stack_t * stack)
+{
+	return stack->reserved_blocks > stack->min_blocks ? stack->reserved_blocks : stack->min_blocks;
+}
+
+/* Called with the stack locked. Doubles the array until it holds length + count elements */
+static int stack_grow(stack_t * stack, size_t count)
+{
+	size_t blocks = stack->allocated_blocks;
+
+	if(count > SIZE_MAX / stack->element_width - stack->length)
+		return MEM_ERROR;
+
+	if(stack->length + count <= blocks)
+		return STACK_OK;
+
+	if(stack->segmented)
+		return stack_resize(stack, stack->length + count);
+
+	while(blocks < stack->length + count)
+		blocks = blocks > SIZE_MAX / 2 / stack->element_width ? stack->length + count : blocks << 1;
+
+	return blocks == stack->allocated_blocks ? STACK_OK : stack_resize(stack, blocks);
+}
+
+/* Called with the stack locked after elements are removed. A failed shrink keeps the larger buffer */
+static void stack_shrink(stack_t * stack)
+{
+	size_t blocks = stack->allocated_blocks;
+
+	if(stack->shrink_ratio == STACK_NEVER_SHRINK)
+		return;
+
+	if(stack->segmented) {
+		stack_seg_t * seg = stack->segmented;
+
+		/* With a ratio of 2 the occupancy test alone would drop a last segment that still holds elements */
+		while(seg->count > 1 && stack->length <= stack->allocated_blocks / stack->shrink_ratio && stack->length <= stack->allocated_blocks - seg_last(seg) && stack->allocated_blocks - seg_last(seg) >= stack_floor(stack))
+			seg_drop(stack);
+
+		return;
+	}
+
+	/* Halving at a quarter full leaves the stack half full, so it takes as many pushes to grow again as pops to shrink again */
+	while(stack->length <= blocks / stack->shrink_ratio && blocks > stack_floor(stack))
+		blocks >>= 1;
+
+	if(blocks < stack_floor(stack))
+		blocks = stack_floor(stack);
+
+	if(blocks < stack->allocated_blocks)
+		stack_resize(stack, blocks);
+}
+
+int stack_init(stack_t * stack, size_t element_width)
+{
+	return stack_init_opts(stack, element_width, NULL);
+}
+
+int stack_init_opts(stack_t * stack, size_t element_width, const stack_options_t * options)
+{
+	if(element_width <= 0)
+		return SIZE_ERROR;
+
 	stack->length = 0;
 	stack->element_width = element_width;
-	stack->allocated_blocks = BASE_STACK_LENGTH;
+	stack->allocated_blocks = 0;
+	stack->stack_base = NULL;
+	stack->lock_free = NULL;
+	stack->segmented = NULL;
+	stack->min_blocks = options && options->min_capacity ? options->min_capacity : BASE_STACK_LENGTH;
+	stack->shrink_ratio = options && options->shrink_ratio ? options->shrink_ratio : STACK_SHRINK_RATIO;
+	stack->reserved_blocks = 0;
+
+	if(stack->shrink_ratio < 2) /* Shrinking at half occupancy or above would thrash */
+		return SIZE_ERROR;
+
+	if(stack->min_blocks > SIZE_MAX / element_width)
+		return MEM_ERROR;
+
+	if(options && options->lock_free) {
+		if(stack_init_lf(stack) != STACK_OK)
+			return MEM_ERROR;
+	} else if(options && options->segmented) {
+		if(!(stack->segmented = calloc(1, sizeof(stack_seg_t))))
+			return MEM_ERROR;
+
+		stack->segmented->base = stack->min_blocks;
+
+		if(seg_add(stack) != STACK_OK) {
+			free(stack->segmented);
+			stack->segmented = NULL;
+			return MEM_ERROR;
+		}
+	} else {
+		if(!(stack->stack_base = malloc(element_width * stack->min_blocks)))
+			return MEM_ERROR;
+
+		stack->allocated_blocks = stack->min_blocks;
+	}
 
 	pthread_mutex_init(&stack->lock, NULL);
 
@@ -39,44 +505,190 @@ int stack_init(stack_t * stack, size_t element_width)
 
 int stack_push(stack_t * stack, void * data)
 {
-	if(stack->length == stack->allocated_blocks) {
-		stack->allocated_blocks <<= 1;
+	if(stack->lock_free)
+		return stack_push_lf(stack, data);
 
-		if(!(stack->stack_base = realloc(stack->stack_base, stack->allocated_blocks * stack->element_width)))
-			return MEM_ERROR;
+	pthread_mutex_lock(&stack->lock);
+
+	if(stack->length == stack->allocated_blocks && stack_grow(stack, 1) != STACK_OK) {
+		pthread_mutex_unlock(&stack->lock);
+		return MEM_ERROR;
 	}
 
-	memcpy(((char *) stack->stack_base) + stack->length * stack->element_width, data, stack->element_width);
+	memcpy(stack_slot(stack, stack->length), data, stack->element_width);
 
 	stack->length++;
 
+	pthread_mutex_unlock(&stack->lock);
+
+	return STACK_OK;
+}
+
+int stack_push_n(stack_t * stack, void * data, size_t count)
+{
+	if(stack->lock_free)
+		return stack_push_n_lf(stack, data, count);
+
+	pthread_mutex_lock(&stack->lock);
+
+	if(stack_grow(stack, count) != STACK_OK) {
+		pthread_mutex_unlock(&stack->lock);
+		return MEM_ERROR;
+	}
+
+	stack_copy(stack, stack->length, data, count, 1);
+
+	stack->length += count;
+
+	pthread_mutex_unlock(&stack->lock);
+
 	return STACK_OK;
 }
 
+void * stack_emplace(stack_t * stack)
+{
+	void * slot;
+
+	if(stack->lock_free) /* The node would be visible to other threads before it was written */
+		return NULL;
+
+	pthread_mutex_lock(&stack->lock);
+
+	if(stack->length == stack->allocated_blocks && stack_grow(stack, 1) != STACK_OK) {
+		pthread_mutex_unlock(&stack->lock);
+		return NULL;
+	}
+
+	slot = stack_slot(stack, stack->length);
+
+	stack->length++;
+
+	pthread_mutex_unlock(&stack->lock);
+
+	return slot;
+}
+
 int stack_pop(stack_t * stack, void * location)
 {
-	if(stack->length == 0)
-		return SIZE_ERROR;
+	if(stack->lock_free)
+		return stack_pop_lf(stack, location);
 
-	if(stack->length == stack->allocated_blocks >> 1) {
-		stack->allocated_blocks >>= 1;
+	pthread_mutex_lock(&stack->lock);
 
-		if(!(stack->stack_base = realloc(stack->stack_base, stack->allocated_blocks * stack->element_width)))
-			return MEM_ERROR;
+	if(stack->length == 0) {
+		pthread_mutex_unlock(&stack->lock);
+		return SIZE_ERROR;
 	}
 
 	stack->length--;
 
-	memcpy(location, ((char *) stack->stack_base) + stack->length * stack->element_width, stack->element_width);
+	memcpy(location, stack_slot(stack, stack->length), stack->element_width);
+
+	stack_shrink(stack);
+
+	pthread_mutex_unlock(&stack->lock);
+
+	return STACK_OK;
+}
+
+int stack_pop_n(stack_t * stack, void * location, size_t count)
+{
+	if(stack->lock_free)
+		return stack_pop_n_lf(stack, location, count);
+
+	pthread_mutex_lock(&stack->lock);
+
+	if(stack->length < count) {
+		pthread_mutex_unlock(&stack->lock);
+		return SIZE_ERROR;
+	}
+
+	stack->length -= count;
+
+	stack_copy(stack, stack->length, location, count, 0);
+
+	stack_shrink(stack);
+
+	pthread_mutex_unlock(&stack->lock);
 
 	return STACK_OK;
 }
 
+void * stack_peek_ref(stack_t * stack)
+{
+	void * top = NULL;
+
+	if(stack->lock_free) /* The top node can be popped and reused while the caller reads it */
+		return NULL;
+
+	pthread_mutex_lock(&stack->lock);
+
+	if(stack->length)
+		top = stack_slot(stack, stack->length - 1);
+
+	pthread_mutex_unlock(&stack->lock);
+
+	return top;
+}
+
+int stack_reserve(stack_t * stack, size_t capacity)
+{
+	int status = STACK_OK;
+
+	if(stack->lock_free)
+		return stack_reserve_lf(stack, capacity);
+
+	pthread_mutex_lock(&stack->lock);
+
+	if(capacity > stack->allocated_blocks)
+		status = stack_resize(stack, capacity);
+
+	if(status == STACK_OK && capacity > stack->reserved_blocks)
+		stack->reserved_blocks = capacity;
+
+	pthread_mutex_unlock(&stack->lock);
+
+	return status;
+}
+
+int stack_shrink_to_fit(stack_t * stack)
+{
+	int status = STACK_OK;
+
+	if(stack->lock_free) /* Nodes are only freed by stack_destroy */
+		return STACK_OK;
+
+	pthread_mutex_lock(&stack->lock);
+
+	stack->reserved_blocks = 0;
+
+	size_t blocks = stack->length > stack->min_blocks ? stack->length : stack->min_blocks;
+
+	if(blocks < stack->allocated_blocks)
+		status = stack_resize(stack, blocks);
+
+	pthread_mutex_unlock(&stack->lock);
+
+	return status;
+}
+
 void stack_destroy(stack_t * stack)
 {
+	if(stack->lock_free)
+		stack_destroy_lf(stack);
+
+	if(stack->segmented) {
+		while(stack->segmented->count)
+			seg_drop(stack);
+
+		free(stack->segmented);
+		stack->segmented = NULL;
+	}
+
 	stack->length = 0;
 	stack->element_width = 0;
 	free(stack->stack_base);
+	stack->stack_base = NULL;
 
 	pthread_mutex_destroy(&stack->lock);
 }
\ No newline at end of file
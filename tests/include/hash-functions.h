@@ -0,0 +1,11 @@
+#ifndef HASH_FUNCTIONS_H
+#define HASH_FUNCTIONS_H
+
+#include <stdlib.h>
+
+typedef size_t (*ht_hash_t)(const void * key, size_t length);	/* Hash length bytes of key into a full width hash value */
+
+size_t hthash_djb2(const void * key, size_t length);			/* Byte at a time DJB2, the original table hash */
+size_t hthash_wy(const void * key, size_t length);				/* wyhash style hash consuming 8 bytes at a time, the default */
+
+#endif
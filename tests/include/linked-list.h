@@ -2,14 +2,25 @@
 #define LLIST_H
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <pthread.h>
 
+#include "pool.h"
+
 /* Return values */
 
 #define LIST_OK 0
 #define MEM_ERROR -1													/* Memory allocation error */
 #define SIZE_ERROR -2													/* list dimension error */
 #define INDEX_ERROR -3													/* No data at given index */
+#define MODE_ERROR -4													/* Operation is not available in the list's mode */
+
+#define LLIST_BLOCK_SIZE (size_t) 256									/* Suggested block size in bytes for unrolled lists */
+#define LLIST_CACHE_LINE (size_t) 64									/* Unrolled blocks are aligned to and sized in multiples of this */
+#define LLIST_SORT_MAX_THREADS 64										/* The most threads llist_sort_parallel, llist_operate_parallel and llist_reduce will use */
+#define LLIST_PARALLEL_MIN (size_t) 4096								/* Elements per thread below which the parallel functions use fewer threads, or just the calling thread */
+#define LLIST_REDUCE_CHUNK (size_t) 4096								/* Elements per partial result in llist_reduce, fixed so the result does not depend on the thread count */
+#define LLIST_SORT_OVERSAMPLE (size_t) 32								/* Samples taken per thread when llist_sort_parallel picks its key ranges */
 
 /* List element data structure */
 
@@ -17,8 +28,19 @@ typedef struct list_element_t
 {
 	void * data;														/* Contains the data stored at this node */
 	struct list_element_t * next;										/* Contains the pointer to the next element, or NULL if it's the tail node */
+	struct list_element_t * prev;										/* Contains the pointer to the previous element, or NULL if it's the head node */
 } llist_element_t;
 
+/* Unrolled list block data structure */
+
+typedef struct list_block_t
+{
+	struct list_block_t * next;											/* The next block, or NULL if it's the tail block */
+	unsigned int first;													/* Index of the first element still in the block, elements before it have been popped */
+	unsigned int count;													/* The number of elements in the block */
+	_Alignas(16) unsigned char data[];									/* The elements, stored back to back */
+} llist_block_t;
+
 /* List master data structure */
 
 typedef struct
@@ -28,20 +50,45 @@ typedef struct
 	llist_element_t *	tail;											/* Pointer to the tail of the list */
 	pthread_mutex_t		lock;											/* Read/write lock to ensure list concurrency */
 	size_t				data_width;										/* The size of each element in the list */
+	pool_t *			pool;											/* Pool elements are allocated from, NULL to use malloc */
+	llist_block_t *		head_block;										/* Pointer to the head block of an unrolled list */
+	llist_block_t *		tail_block;										/* Pointer to the tail block of an unrolled list */
+	size_t				block_capacity;									/* The number of elements per block, 0 unless the list is unrolled */
+	size_t				block_bytes;									/* The size of each block including its header */
 } llist_t;
 
+/* Optional list parameters */
+
+typedef struct
+{
+	pool_t *			pool;											/* Pool to allocate elements from, its objects must be at least llist_node_size(data_width) bytes. NULL uses malloc */
+	size_t				block_size;										/* Non-zero makes the list unrolled, storing elements inline in blocks of about this many bytes */
+} llist_options_t;
+
 /* Interface Functions */
 
 llist_element_t * llist_search(void const * const data, int (*compare)(const void * first_element, const void * second_element), llist_t * list); /* Search the list for an occurance of a given data value using a user defined comparison function */
+void * llist_find(void const * const data, int (*compare)(const void * first_element, const void * second_element), llist_t * list);	/* As llist_search, but return the stored data itself. Works for unrolled lists */
+void * llist_find_u32(uint32_t key, llist_t * list);														/* Return the first element whose leading 4 bytes equal key, without a comparison function. Vectorised for unrolled lists of 4 byte elements */
+void * llist_find_u64(uint64_t key, llist_t * list);														/* As llist_find_u32 for 8 byte keys */
+void * llist_find_u128(void const * const key, llist_t * list);											/* As llist_find_u32 for the 16 bytes at key, such as a UUID */
 int llist_init(llist_t * list, size_t data_size);															/* Initialise the list data structure */
+int llist_init_opts(llist_t * list, size_t data_size, const llist_options_t * options);					/* Initialise the list with explicit options, NULL selects the defaults */
+size_t llist_node_size(size_t data_size);																	/* The size of one element and its data, for sizing a pool shared between lists */
 int llist_insert_before(void const * const data, llist_element_t * element, llist_t * list);				/* Insert an element into the list at the position before a specified element */
 int llist_insert_after(void const * const data, llist_element_t * element, llist_t * list);					/* Insert an element into the list at the position after a specified element */
 int llist_pop(void * const data, llist_t * list);															/* Pop an element from the front of the list, deals with cleanup when the head node is empty */
 int llist_push(void const * const data, llist_t * list);													/* Push an element to the back of the list, creates a new block when tail node is full */
-int llist_remove(llist_element_t * element, llist_t * list);												/* Remove an element from the list and connect the two elements next to it */
-int llist_sort(int (*compare)(const void * first_element, const void * second_element), llist_t * list);	/* Sort all elements in the list using a merge sort */
+void * llist_emplace(llist_t * list);																		/* Push an uninitialised element to the back of the list and return its data for the caller to fill, NULL on failure */
+int llist_remove(llist_element_t * element, llist_t * list);												/* Remove and free an element, connecting the two elements next to it */
+int llist_move_to_front(llist_element_t * element, llist_t * list);											/* Move an element to the head of the list */
+int llist_move_to_back(llist_element_t * element, llist_t * list);											/* Move an element to the tail of the list */
+int llist_sort(int (*compare)(const void * first_element, const void * second_element), llist_t * list);	/* Sort all elements in the list using a stable, iterative natural merge sort */
+int llist_sort_parallel(int (*compare)(const void * first_element, const void * second_element), llist_t * list, int nthreads);	/* As llist_sort, splitting the work across nthreads threads. The result is identical */
 void llist_destroy(llist_t * list);																			/* Destroy the list data structure and any associated nodes */
 void llist_operate(void (*operation)(const void * data, const void * parameter), const void * parameter, llist_t * list);	/* Perform a user defined action on every single element stored in the list */
+int llist_operate_parallel(void (*operation)(const void * data, const void * parameter), const void * parameter, llist_t * list, int nthreads);	/* As llist_operate, splitting the elements across nthreads threads. operation must be safe to run on different elements at once */
+int llist_reduce(void (*map)(const void * data, void * value, const void * parameter), void (*combine)(void * accumulator, const void * value), const void * identity, void * result, size_t width, const void * parameter, llist_t * list, int nthreads);	/* Map every element to a width byte value and fold them into result with combine, starting from identity, on nthreads threads */
 void * llist_peek(void * const data, llist_t * list);														/* Check the contents of the element at the head of the list without popping the list */
 void * llist_peek_tail(void * const data, llist_t * list);													/* Check the contents of the element at the tail of the list */
 
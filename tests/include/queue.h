@@ -0,0 +1,45 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#define QUEUE_OK			0	/* Operation completed successfully */
+#define QUEUE_MEM_ERROR		-1	/* Memory allocation error */
+#define QUEUE_SIZE_ERROR	-2	/* Element width or capacity is not usable */
+#define QUEUE_FULL			-3	/* No free slot to push into */
+#define QUEUE_EMPTY			-4	/* No element to pop */
+#define QUEUE_CLOSED		-5	/* The queue has been closed */
+
+#define QUEUE_CACHE_LINE	64	/* The producer and consumer positions live on separate lines of this size */
+#define QUEUE_SPINS			64	/* Times a blocking call retries before sleeping on a condition variable */
+
+typedef struct queue_t {
+	_Alignas(QUEUE_CACHE_LINE) size_t enqueue_pos;	/* The next position a producer will claim */
+	_Alignas(QUEUE_CACHE_LINE) size_t dequeue_pos;	/* The next position a consumer will claim */
+	_Alignas(QUEUE_CACHE_LINE) unsigned char * cells;	/* Each cell is a sequence number followed by one element */
+	size_t cell_width;				/* The size of a cell, the sequence number and element rounded up to a word */
+	size_t data_width;				/* The size of each element */
+	size_t mask;					/* Capacity - 1, the capacity is a power of two */
+	int closed;						/* Set by queue_close, refuses pushes and wakes every blocked thread */
+	size_t push_waiters;			/* Producers asleep on not_full */
+	size_t pop_waiters;				/* Consumers asleep on not_empty */
+	pthread_mutex_t lock;			/* Only taken by threads going to sleep and the threads waking them */
+	pthread_cond_t not_full;
+	pthread_cond_t not_empty;
+} queue_t;
+
+int queue_init(queue_t * queue, size_t data_width, size_t capacity);					/* Initialise a queue holding at least capacity elements, rounded up to a power of two */
+int queue_try_push(void const * const data, queue_t * queue);							/* Push an element to the back of the queue, QUEUE_FULL instead of waiting */
+int queue_try_pop(void * const data, queue_t * queue);									/* Pop an element from the front of the queue, QUEUE_EMPTY instead of waiting */
+size_t queue_try_push_n(void const * const data, size_t count, queue_t * queue);		/* Push up to count elements without waiting, returns the number pushed */
+size_t queue_try_pop_n(void * const data, size_t count, queue_t * queue);				/* Pop up to count elements without waiting, returns the number popped */
+int queue_push(void const * const data, queue_t * queue);								/* Push an element, waiting for a free slot. QUEUE_CLOSED once closed */
+int queue_pop(void * const data, queue_t * queue);										/* Pop an element, waiting for one. QUEUE_CLOSED once closed and drained */
+int queue_push_n(void const * const data, size_t count, queue_t * queue);				/* Push all count elements, waiting for free slots as needed */
+size_t queue_pop_n(void * const data, size_t count, queue_t * queue);					/* Wait for at least one element and pop up to count, 0 once closed and drained */
+size_t queue_length(queue_t * queue);													/* The number of elements claimed by producers and not yet by consumers */
+void queue_close(queue_t * queue);														/* Refuse further pushes and wake every blocked thread */
+void queue_destroy(queue_t * queue);													/* Free the queue's cells, no thread may still be using it */
+
+#endif
@@ -0,0 +1,733 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#include "../include/hash-table.h"
+#include "../include/flat-table.h"
+#include "../include/typed-table.h"
+#include "../include/linked-list.h"
+#include "../include/stack.h"
+
+#ifndef BENCH_REVISION
+#define BENCH_REVISION "unknown"										/* The Makefile passes the current commit */
+#endif
+
+#define BENCH_BATCH			(size_t) 64									/* Operations timed together as one sample for the percentiles */
+#define BENCH_MAX_SAMPLES	((size_t) 1 << 16)						/* Later samples are still timed but left out of the percentiles */
+#define BENCH_MAX_RESULTS	64
+#define LOOKUP_OPS			(size_t) 1000000
+#define LIST_ELEMENTS		(size_t) 1000000
+#define SEARCH_ELEMENTS		(size_t) 1000
+#define KEY_LENGTH			24
+#define SEARCH_OPS			(size_t) 20000
+#define SORT_ROUNDS			5
+#define STACK_ELEMENTS		(size_t) 1000000
+#define ZIPF_THETA			0.99										/* The skew YCSB uses for its Zipfian workloads */
+
+typedef struct result_t {
+	const char * structure;
+	const char * operation;
+	const char * distribution;
+	size_t size;														/* Elements in the structure */
+	size_t ops;
+	double ns_per_op;
+	double p50;															/* Percentiles of the per batch ns/op */
+	double p90;
+	double p99;
+	double allocs_per_op;
+} result_t;
+
+typedef struct zipf_t {
+	size_t n;
+	double theta;
+	double alpha;
+	double zetan;
+	double eta;
+} zipf_t;
+
+static size_t allocations = 0;
+
+static result_t results[BENCH_MAX_RESULTS];
+static size_t result_count = 0;
+
+static double samples[BENCH_MAX_SAMPLES];
+static size_t sample_count;
+static double batch_start, total_ns;
+static size_t batch_allocations, total_allocations;
+
+static uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+
+void * __real_malloc(size_t size);
+void * __real_calloc(size_t count, size_t size);
+void * __real_realloc(void * pointer, size_t size);
+void * __real_aligned_alloc(size_t alignment, size_t size);
+
+/* Linked with --wrap for each allocator so allocations made by the structures are counted */
+void * __wrap_malloc(size_t size)
+{
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+	return __real_malloc(size);
+}
+
+void * __wrap_calloc(size_t count, size_t size)
+{
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+	return __real_calloc(count, size);
+}
+
+void * __wrap_realloc(void * pointer, size_t size)
+{
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+	return __real_realloc(pointer, size);
+}
+
+void * __wrap_aligned_alloc(size_t alignment, size_t size)
+{
+	__atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+
+	return __real_aligned_alloc(alignment, size);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline uint64_t next_random(void)
+{
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+
+	return random_state;
+}
+
+static double uniform_random(void)
+{
+	return (double) (next_random() >> 11) / (double) (1ULL << 53);
+}
+
+/* Gray et al's generator for ranks 0..n-1 where rank r is drawn with probability proportional to 1/(r+1)^theta */
+static void zipf_init(zipf_t * zipf, size_t n, double theta)
+{
+	double zeta2 = 1 + pow(0.5, theta);
+
+	zipf->n = n;
+	zipf->theta = theta;
+	zipf->alpha = 1 / (1 - theta);
+	zipf->zetan = 0;
+
+	for(size_t i = 1; i <= n; i++)
+		zipf->zetan += 1 / pow((double) i, theta);
+
+	zipf->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zipf->zetan);
+}
+
+static size_t zipf_next(zipf_t * zipf)
+{
+	double u = uniform_random();
+	double uz = u * zipf->zetan;
+
+	if(uz < 1)
+		return 0;
+
+	if(uz < 1 + pow(0.5, zipf->theta))
+		return 1;
+
+	size_t rank = (size_t) (zipf->n * pow(zipf->eta * u - zipf->eta + 1, zipf->alpha));
+
+	return rank < zipf->n ? rank : zipf->n - 1;
+}
+
+static int compare_doubles(const void * first_element, const void * second_element)
+{
+	double first = *(const double *) first_element, second = *(const double *) second_element;
+
+	return (first > second) - (first < second);
+}
+
+static int compare_ints(const void * first_element, const void * second_element)
+{
+	int first = *(const int *) first_element, second = *(const int *) second_element;
+
+	return (first > second) - (first < second);
+}
+
+/* Only the time and allocations between batch_begin and batch_end count towards a result */
+static void bench_begin(void)
+{
+	sample_count = 0;
+	total_ns = 0;
+	total_allocations = 0;
+}
+
+static inline void batch_begin(void)
+{
+	batch_allocations = allocations;
+	batch_start = now_ns();
+}
+
+static inline void batch_end(size_t ops)
+{
+	double elapsed = now_ns() - batch_start;
+
+	total_ns += elapsed;
+	total_allocations += allocations - batch_allocations;
+
+	if(sample_count < BENCH_MAX_SAMPLES)
+		samples[sample_count++] = elapsed / ops;
+}
+
+static void bench_end(const char * structure, const char * operation, const char * distribution, size_t size, size_t ops)
+{
+	result_t * result = &results[result_count];
+
+	qsort(samples, sample_count, sizeof(double), compare_doubles);
+
+	*result = (result_t) {
+		.structure = structure, .operation = operation, .distribution = distribution, .size = size, .ops = ops,
+		.ns_per_op = total_ns / ops, .allocs_per_op = (double) total_allocations / ops,
+		.p50 = samples[sample_count * 50 / 100], .p90 = samples[sample_count * 90 / 100], .p99 = samples[sample_count * 99 / 100]
+	};
+
+	printf("[-] %-12s %-15s %-8s %8zu %9.2f ns/op  p50 %8.2f  p90 %8.2f  p99 %8.2f  %6.3f allocs/op\n", structure, operation, distribution, size,
+		result->ns_per_op, result->p50, result->p90, result->p99, result->allocs_per_op);
+
+	if(result_count + 1 < BENCH_MAX_RESULTS)
+		result_count++;
+}
+
+static int bench_hash_table(size_t size)
+{
+	uint64_t (*keys)[2] = malloc(size * sizeof(keys[0]));
+	size_t * order = malloc(size * sizeof(size_t));
+	size_t * lookups = malloc(LOOKUP_OPS * sizeof(size_t));
+	const char * distributions[] = { "uniform", "zipfian" };
+	table_t table;
+	zipf_t zipf;
+
+	if(!keys || !order || !lookups || htinit(&table, sizeof(size_t), DEFAULT_TABLE_SIZE) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < size; i++) {
+		keys[i][0] = i * 0x9E3779B97F4A7C15ULL;
+		keys[i][1] = i;
+		order[i] = i;
+	}
+
+	for(size_t i = size - 1; i > 0; i--) { /* Deletes run in a different order from the inserts */
+		size_t j = next_random() % (i + 1), swap = order[i];
+
+		order[i] = order[j];
+		order[j] = swap;
+	}
+
+	bench_begin();
+
+	for(size_t i = 0; i < size; i += BENCH_BATCH) {
+		size_t end = i + BENCH_BATCH < size ? i + BENCH_BATCH : size;
+
+		batch_begin();
+
+		for(size_t j = i; j < end; j++)
+			htinsert_n(&table, keys[j], sizeof(keys[j]), &j);
+
+		batch_end(end - i);
+	}
+
+	bench_end("hash-table", "htinsert", "unique", size, size);
+
+	table_t built; /* The same keys again through the bulk builder, finishing on every online CPU */
+	int nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN); /* Asked for before timing starts, as it reads a file */
+
+	bench_begin();
+	batch_begin();
+
+	if(htbuild_begin(&built, sizeof(size_t), size, NULL) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not begin the build!\n");
+		return MEM_ERROR;
+	}
+
+	batch_end(1);
+
+	for(size_t i = 0; i < size; i += BENCH_BATCH) {
+		size_t end = i + BENCH_BATCH < size ? i + BENCH_BATCH : size;
+
+		batch_begin();
+
+		for(size_t j = i; j < end; j++)
+			htbuild_add_n(&built, keys[j], sizeof(keys[j]), &j);
+
+		batch_end(end - i);
+	}
+
+	batch_begin();
+	htbuild_finish(&built, nthreads);
+	batch_end(size);
+
+	bench_end("hash-table", "htbuild", "unique", size, size);
+
+	htdestroy(&built);
+
+	zipf_init(&zipf, size, ZIPF_THETA);
+
+	for(size_t d = 0; d < sizeof(distributions) / sizeof(distributions[0]); d++) {
+		size_t value, found = 0;
+
+		for(size_t i = 0; i < LOOKUP_OPS; i++)
+			lookups[i] = d == 0 ? next_random() % size : zipf_next(&zipf);
+
+		bench_begin();
+
+		for(size_t i = 0; i < LOOKUP_OPS; i += BENCH_BATCH) {
+			batch_begin();
+
+			for(size_t j = i; j < i + BENCH_BATCH && j < LOOKUP_OPS; j++)
+				found += htlookup_n(&table, keys[lookups[j]], sizeof(keys[0]), &value) == TABLE_OK;
+
+			batch_end(i + BENCH_BATCH < LOOKUP_OPS ? BENCH_BATCH : LOOKUP_OPS - i);
+		}
+
+		bench_end("hash-table", "htlookup", distributions[d], size, LOOKUP_OPS);
+
+		if(found != LOOKUP_OPS) {
+			fprintf(stderr, "Error: Only found %zu of %zu keys!\n", found, LOOKUP_OPS);
+			return INVALID_ENTRY;
+		}
+	}
+
+	bench_begin();
+
+	for(size_t i = 0; i < size; i += BENCH_BATCH) {
+		size_t end = i + BENCH_BATCH < size ? i + BENCH_BATCH : size;
+
+		batch_begin();
+
+		for(size_t j = i; j < end; j++)
+			htdelete_n(&table, keys[order[j]], sizeof(keys[0]));
+
+		batch_end(end - i);
+	}
+
+	bench_end("hash-table", "htdelete", "unique", size, size);
+
+	htdestroy(&table);
+	free(keys);
+	free(order);
+	free(lookups);
+
+	return TABLE_OK;
+}
+
+HT_DEFINE(u64map, uint64_t, uint64_t, htkey_hash_u64, htkey_equal_u64)
+
+/* The same uint64_t to uint64_t workload through table_t and through a table specialised by HT_DEFINE */
+static int bench_u64_maps(size_t size)
+{
+	uint64_t * keys = malloc(size * sizeof(uint64_t));
+	size_t * lookups = malloc(LOOKUP_OPS * sizeof(size_t));
+	uint64_t value;
+	size_t found = 0;
+	table_t table;
+	u64map_t map;
+
+	if(!keys || !lookups || htinit(&table, sizeof(uint64_t), DEFAULT_TABLE_SIZE) != TABLE_OK || u64map_init(&map, DEFAULT_TABLE_SIZE) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create tables!\n");
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < size; i++)
+		keys[i] = i * 0x9E3779B97F4A7C15ULL;
+
+	for(size_t i = 0; i < LOOKUP_OPS; i++)
+		lookups[i] = next_random() % size;
+
+	bench_begin();
+
+	for(size_t i = 0; i < size; i += BENCH_BATCH) {
+		size_t end = i + BENCH_BATCH < size ? i + BENCH_BATCH : size;
+
+		batch_begin();
+
+		for(size_t j = i; j < end; j++) {
+			value = j;
+			htinsert_n(&table, &keys[j], sizeof(uint64_t), &value);
+		}
+
+		batch_end(end - i);
+	}
+
+	bench_end("hash-table", "htinsert", "u64", size, size);
+	bench_begin();
+
+	for(size_t i = 0; i < size; i += BENCH_BATCH) {
+		size_t end = i + BENCH_BATCH < size ? i + BENCH_BATCH : size;
+
+		batch_begin();
+
+		for(size_t j = i; j < end; j++)
+			u64map_insert(&map, keys[j], j);
+
+		batch_end(end - i);
+	}
+
+	bench_end("typed-table", "insert", "u64", size, size);
+	bench_begin();
+
+	for(size_t i = 0; i < LOOKUP_OPS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < LOOKUP_OPS; j++)
+			found += htlookup_n(&table, &keys[lookups[j]], sizeof(uint64_t), &value) == TABLE_OK && value == lookups[j];
+
+		batch_end(i + BENCH_BATCH < LOOKUP_OPS ? BENCH_BATCH : LOOKUP_OPS - i);
+	}
+
+	bench_end("hash-table", "htlookup", "u64", size, LOOKUP_OPS);
+	bench_begin();
+
+	for(size_t i = 0; i < LOOKUP_OPS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < LOOKUP_OPS; j++)
+			found += u64map_lookup(&map, keys[lookups[j]], &value) == TABLE_OK && value == lookups[j];
+
+		batch_end(i + BENCH_BATCH < LOOKUP_OPS ? BENCH_BATCH : LOOKUP_OPS - i);
+	}
+
+	bench_end("typed-table", "lookup", "u64", size, LOOKUP_OPS);
+
+	if(found != LOOKUP_OPS * 2) {
+		fprintf(stderr, "Error: Only found %zu of %zu keys!\n", found, LOOKUP_OPS * 2);
+		return INVALID_ENTRY;
+	}
+
+	htdestroy(&table);
+	u64map_destroy(&map);
+	free(keys);
+	free(lookups);
+
+	return TABLE_OK;
+}
+
+/* The same string keyed workload through the chained table and the open addressing table */
+static int bench_string_tables(size_t size)
+{
+	char (*keys)[KEY_LENGTH] = malloc(size * sizeof(keys[0]));
+	size_t * lookups = malloc(LOOKUP_OPS * sizeof(size_t));
+	size_t value, found = 0;
+	table_t table;
+	flat_table_t flat;
+
+	if(!keys || !lookups || htinit(&table, sizeof(size_t), DEFAULT_TABLE_SIZE) != TABLE_OK || ftinit(&flat, sizeof(size_t), FLAT_GROUP_WIDTH) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create tables!\n");
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < size; i++)
+		snprintf(keys[i], KEY_LENGTH, "user:%zu", i);
+
+	for(size_t i = 0; i < LOOKUP_OPS; i++)
+		lookups[i] = next_random() % size;
+
+	bench_begin();
+
+	for(size_t i = 0; i < size; i += BENCH_BATCH) {
+		size_t end = i + BENCH_BATCH < size ? i + BENCH_BATCH : size;
+
+		batch_begin();
+
+		for(size_t j = i; j < end; j++)
+			htinsert(&table, keys[j], &j);
+
+		batch_end(end - i);
+	}
+
+	bench_end("hash-table", "htinsert", "string", size, size);
+	bench_begin();
+
+	for(size_t i = 0; i < size; i += BENCH_BATCH) {
+		size_t end = i + BENCH_BATCH < size ? i + BENCH_BATCH : size;
+
+		batch_begin();
+
+		for(size_t j = i; j < end; j++)
+			ftinsert(&flat, keys[j], &j);
+
+		batch_end(end - i);
+	}
+
+	bench_end("flat-table", "ftinsert", "string", size, size);
+	bench_begin();
+
+	for(size_t i = 0; i < LOOKUP_OPS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < LOOKUP_OPS; j++)
+			found += htlookup(&table, keys[lookups[j]], &value) == TABLE_OK && value == lookups[j];
+
+		batch_end(i + BENCH_BATCH < LOOKUP_OPS ? BENCH_BATCH : LOOKUP_OPS - i);
+	}
+
+	bench_end("hash-table", "htlookup", "string", size, LOOKUP_OPS);
+	bench_begin();
+
+	for(size_t i = 0; i < LOOKUP_OPS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < LOOKUP_OPS; j++)
+			found += ftlookup(&flat, keys[lookups[j]], &value) == TABLE_OK && value == lookups[j];
+
+		batch_end(i + BENCH_BATCH < LOOKUP_OPS ? BENCH_BATCH : LOOKUP_OPS - i);
+	}
+
+	bench_end("flat-table", "ftlookup", "string", size, LOOKUP_OPS);
+
+	if(found != LOOKUP_OPS * 2) {
+		fprintf(stderr, "Error: Only found %zu of %zu keys!\n", found, LOOKUP_OPS * 2);
+		return INVALID_ENTRY;
+	}
+
+	htdestroy(&table);
+	ftdestroy(&flat);
+	free(keys);
+	free(lookups);
+
+	return TABLE_OK;
+}
+
+static int bench_linked_list(size_t block_size)
+{
+	llist_options_t options = { .block_size = block_size };
+	const char * structure = block_size ? "llist-blocks" : "llist";
+	int * values = malloc(LIST_ELEMENTS * sizeof(int));
+	llist_t list;
+	int value;
+
+	if(!values || llist_init_opts(&list, sizeof(int), &options) != LIST_OK) {
+		fprintf(stderr, "Error: Could not create list!\n");
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < LIST_ELEMENTS; i++)
+		values[i] = (int) (next_random() >> 33);
+
+	bench_begin();
+
+	for(size_t i = 0; i < LIST_ELEMENTS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < LIST_ELEMENTS; j++)
+			llist_push(&values[j], &list);
+
+		batch_end(i + BENCH_BATCH < LIST_ELEMENTS ? BENCH_BATCH : LIST_ELEMENTS - i);
+	}
+
+	bench_end(structure, "llist_push", "-", LIST_ELEMENTS, LIST_ELEMENTS);
+
+	bench_begin();
+
+	for(size_t i = 0; i < LIST_ELEMENTS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < LIST_ELEMENTS; j++)
+			llist_pop(&value, &list);
+
+		batch_end(i + BENCH_BATCH < LIST_ELEMENTS ? BENCH_BATCH : LIST_ELEMENTS - i);
+	}
+
+	bench_end(structure, "llist_pop", "-", LIST_ELEMENTS, LIST_ELEMENTS);
+
+	for(int i = 0; i < (int) SEARCH_ELEMENTS; i++)
+		llist_push(&i, &list);
+
+	bench_begin();
+
+	for(size_t i = 0; i < SEARCH_OPS; i += BENCH_BATCH) { /* Every search walks half the list on average */
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < SEARCH_OPS; j++) {
+			value = (int) (j * 7919 % SEARCH_ELEMENTS);
+
+			if(!llist_find(&value, compare_ints, &list))
+				return INDEX_ERROR;
+		}
+
+		batch_end(i + BENCH_BATCH < SEARCH_OPS ? BENCH_BATCH : SEARCH_OPS - i);
+	}
+
+	bench_end(structure, "llist_find", "uniform", SEARCH_ELEMENTS, SEARCH_OPS);
+
+	bench_begin();
+
+	for(size_t i = 0; i < SEARCH_OPS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < SEARCH_OPS; j++)
+			if(!llist_find_u32((uint32_t) (j * 7919 % SEARCH_ELEMENTS), &list))
+				return INDEX_ERROR;
+
+		batch_end(i + BENCH_BATCH < SEARCH_OPS ? BENCH_BATCH : SEARCH_OPS - i);
+	}
+
+	bench_end(structure, "llist_find_u32", "uniform", SEARCH_ELEMENTS, SEARCH_OPS);
+
+	while(llist_pop(&value, &list) == LIST_OK);
+
+	bench_begin();
+
+	for(int round = 0; round < SORT_ROUNDS; round++) { /* Each round is one sample of ns per element sorted */
+		for(size_t i = 0; i < LIST_ELEMENTS; i++)
+			llist_push(&values[i], &list);
+
+		batch_begin();
+		llist_sort(compare_ints, &list);
+		batch_end(LIST_ELEMENTS);
+
+		while(llist_pop(&value, &list) == LIST_OK);
+	}
+
+	bench_end(structure, "llist_sort", "random", LIST_ELEMENTS, LIST_ELEMENTS * SORT_ROUNDS);
+
+	llist_destroy(&list);
+	free(values);
+
+	return LIST_OK;
+}
+
+static int bench_stack(void)
+{
+	stack_t stack;
+	size_t value;
+
+	if(stack_init(&stack, sizeof(size_t)) != STACK_OK) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return MEM_ERROR;
+	}
+
+	bench_begin();
+
+	for(size_t i = 0; i < STACK_ELEMENTS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < STACK_ELEMENTS; j++)
+			stack_push(&stack, &j);
+
+		batch_end(i + BENCH_BATCH < STACK_ELEMENTS ? BENCH_BATCH : STACK_ELEMENTS - i);
+	}
+
+	bench_end("stack", "stack_push", "-", STACK_ELEMENTS, STACK_ELEMENTS);
+
+	bench_begin();
+
+	for(size_t i = 0; i < STACK_ELEMENTS; i += BENCH_BATCH) {
+		batch_begin();
+
+		for(size_t j = i; j < i + BENCH_BATCH && j < STACK_ELEMENTS; j++)
+			stack_pop(&stack, &value);
+
+		batch_end(i + BENCH_BATCH < STACK_ELEMENTS ? BENCH_BATCH : STACK_ELEMENTS - i);
+	}
+
+	bench_end("stack", "stack_pop", "-", STACK_ELEMENTS, STACK_ELEMENTS);
+
+	stack_destroy(&stack);
+
+	return STACK_OK;
+}
+
+static int write_csv(const char * path)
+{
+	FILE * file = fopen(path, "w");
+
+	if(!file)
+		return -1;
+
+	fprintf(file, "revision,structure,operation,distribution,size,ops,ns_per_op,p50_ns,p90_ns,p99_ns,allocs_per_op\n");
+
+	for(size_t i = 0; i < result_count; i++) {
+		result_t * r = &results[i];
+
+		fprintf(file, "%s,%s,%s,%s,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.4f\n", BENCH_REVISION, r->structure, r->operation, r->distribution, r->size, r->ops,
+			r->ns_per_op, r->p50, r->p90, r->p99, r->allocs_per_op);
+	}
+
+	return fclose(file);
+}
+
+static int write_json(const char * path)
+{
+	FILE * file = fopen(path, "w");
+
+	if(!file)
+		return -1;
+
+	fprintf(file, "{\n\t\"revision\": \"%s\",\n\t\"results\": [\n", BENCH_REVISION);
+
+	for(size_t i = 0; i < result_count; i++) {
+		result_t * r = &results[i];
+
+		fprintf(file, "\t\t{ \"structure\": \"%s\", \"operation\": \"%s\", \"distribution\": \"%s\", \"size\": %zu, \"ops\": %zu, "
+			"\"ns_per_op\": %.3f, \"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, \"allocs_per_op\": %.4f }%s\n",
+			r->structure, r->operation, r->distribution, r->size, r->ops, r->ns_per_op, r->p50, r->p90, r->p99, r->allocs_per_op, i + 1 < result_count ? "," : "");
+	}
+
+	fprintf(file, "\t]\n}\n");
+
+	return fclose(file);
+}
+
+int main(int argc, char ** argv)
+{
+	const char * csv_path = NULL, * json_path = NULL;
+	size_t table_sizes[] = { 1000, 65536, 1000000 };
+	int option;
+
+	while((option = getopt(argc, argv, "c:j:")) != -1) {
+		switch(option) {
+			case 'c':
+				csv_path = optarg;
+				break;
+			case 'j':
+				json_path = optarg;
+				break;
+			default:
+				fprintf(stderr, "Usage: %s [-c results.csv] [-j results.json]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	printf("[+] Benchmarking revision %s, percentiles are over batches of %zu operations...\n", BENCH_REVISION, BENCH_BATCH);
+
+	for(size_t i = 0; i < sizeof(table_sizes) / sizeof(table_sizes[0]); i++)
+		if(bench_hash_table(table_sizes[i]) != TABLE_OK || bench_u64_maps(table_sizes[i]) != TABLE_OK || bench_string_tables(table_sizes[i]) != TABLE_OK)
+			return 1;
+
+	if(bench_linked_list(0) != LIST_OK || bench_linked_list(LLIST_BLOCK_SIZE) != LIST_OK)
+		return 1;
+
+	if(bench_stack() != STACK_OK)
+		return 1;
+
+	if((csv_path && write_csv(csv_path)) || (json_path && write_json(json_path))) {
+		fprintf(stderr, "Error: Could not write results!\n");
+		return 1;
+	}
+
+	printf("[+] All benchmarks complete, terminating...\n");
+
+	return 0;
+}
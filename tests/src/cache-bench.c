@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../include/cache.h"
+
+#define KEY_SPACE		((uint64_t) 1 << 20)
+#define CACHE_ENTRIES	(size_t) 65536
+#define BENCH_OPS		(size_t) 4000000
+#define VALUE_WIDTH		64
+
+static uint64_t requests[BENCH_OPS];
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline uint64_t xorshift(uint64_t * state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+/* Read through cache: every miss loads the value and puts it */
+static void bench_policy(const char * name, cache_policy_t policy)
+{
+	cache_options_t options = { .max_entries = CACHE_ENTRIES, .policy = policy };
+	unsigned char value[VALUE_WIDTH] = { 0 };
+	cache_stats_t stats;
+	cache_t cache;
+
+	if(cache_init(&cache, VALUE_WIDTH, &options) != CACHE_OK) {
+		fprintf(stderr, "Error: Could not create cache!\n");
+		return;
+	}
+
+	double start = now_ns();
+
+	for(size_t i = 0; i < BENCH_OPS; i++) {
+		if(cache_get(&cache, &requests[i], sizeof(uint64_t), value) == CACHE_MISS) {
+			value[0] = (unsigned char) requests[i];
+			cache_put(&cache, &requests[i], sizeof(uint64_t), value, 0);
+		}
+	}
+
+	double elapsed = now_ns() - start;
+
+	cache_stats(&cache, &stats);
+
+	printf("[-] %-6s %8.2f ns/request %6.2f%% hits %10zu evictions\n", name, elapsed / BENCH_OPS, 100.0 * stats.hits / (stats.hits + stats.misses), stats.evictions);
+
+	cache_destroy(&cache);
+}
+
+int main()
+{
+	uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+	printf("[+] Generating %zu skewed requests over %lu keys...\n", BENCH_OPS, (unsigned long) KEY_SPACE);
+
+	for(size_t i = 0; i < BENCH_OPS; i++) { /* Cubing a uniform variable concentrates requests on low keys */
+		double u = (double) (xorshift(&state) >> 11) / (double) (1ULL << 53);
+
+		requests[i] = (uint64_t) (u * u * u * KEY_SPACE) * 0x9E3779B97F4A7C15ULL;
+	}
+
+	printf("[+] Serving them through a %zu entry cache...\n", CACHE_ENTRIES);
+
+	bench_policy("LRU", CACHE_LRU);
+	bench_policy("CLOCK", CACHE_CLOCK);
+
+	printf("[+] All benchmarks complete, terminating...\n");
+
+	return 0;
+}
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/cache.h"
+
+#define STRESS_KEYS 5000
+#define STRESS_OPS 200000
+#define STRESS_ENTRIES 1000
+
+void * __real_malloc(size_t size);
+
+static int failing_malloc = -1;	/* The number of allocations left before one fails, negative to never fail */
+
+/* Linked with --wrap=malloc so allocation failures can be forced part way through a put */
+void * __wrap_malloc(size_t size)
+{
+	if(failing_malloc >= 0 && failing_malloc-- == 0)
+		return NULL;
+
+	return __real_malloc(size);
+}
+
+typedef struct evicted_t {
+	char keys[16][64];
+	size_t count;
+} evicted_t;
+
+static void record_eviction(const void * key, size_t length, void * value, void * context)
+{
+	evicted_t * evicted = context;
+
+	(void) value;
+
+	if(evicted->count < 16)
+		snprintf(evicted->keys[evicted->count], sizeof(evicted->keys[0]), "%.*s", (int) length, (const char *) key);
+
+	evicted->count++;
+}
+
+static int put_string(cache_t * cache, const char * key, int value)
+{
+	return cache_put(cache, key, strlen(key), &value, 0);
+}
+
+static int get_string(cache_t * cache, const char * key)
+{
+	int value;
+
+	return cache_get(cache, key, strlen(key), &value) == CACHE_OK ? value : -1;
+}
+
+static int test_policy(cache_policy_t policy, const char * first_victim, const char * second_victim)
+{
+	evicted_t evicted = { .count = 0 };
+	cache_options_t options = { .max_entries = 3, .policy = policy, .evict = record_eviction, .context = &evicted };
+	cache_stats_t stats;
+	cache_t cache;
+
+	if(cache_init(&cache, sizeof(int), &options) != CACHE_OK) {
+		fprintf(stderr, "Error: Could not create cache!\n");
+		return CACHE_MEM_ERROR;
+	}
+
+	put_string(&cache, "a", 1);
+	put_string(&cache, "b", 2);
+	put_string(&cache, "c", 3);
+
+	if(get_string(&cache, "a") != 1 || get_string(&cache, "b") != 2 || get_string(&cache, "z") != -1) {
+		fprintf(stderr, "Error: Lookups returned the wrong values!\n");
+		return CACHE_MISS;
+	}
+
+	put_string(&cache, "d", 4);
+	put_string(&cache, "e", 5);
+
+	cache_stats(&cache, &stats);
+
+	if(evicted.count != 2 || strcmp(evicted.keys[0], first_victim) || strcmp(evicted.keys[1], second_victim)) {
+		fprintf(stderr, "Error: Evicted %zu entries starting with %s and %s, expected %s and %s!\n", evicted.count, evicted.keys[0], evicted.keys[1], first_victim, second_victim);
+		return CACHE_SIZE_ERROR;
+	}
+
+	if(stats.hits != 2 || stats.misses != 1 || stats.evictions != 2 || stats.entries != 3 || get_string(&cache, "b") != 2 || get_string(&cache, "e") != 5) {
+		fprintf(stderr, "Error: Counters or surviving entries are wrong!\n");
+		return CACHE_SIZE_ERROR;
+	}
+
+	if(cache_delete(&cache, "b", 1) != CACHE_OK || cache_delete(&cache, "b", 1) != CACHE_MISS || get_string(&cache, "b") != -1 || evicted.count != 2) {
+		fprintf(stderr, "Error: Deleting an entry failed or called the eviction callback!\n");
+		return CACHE_MISS;
+	}
+
+	cache_destroy(&cache);
+
+	return CACHE_OK;
+}
+
+int main()
+{
+	cache_options_t options = { .max_entries = 0 };
+	cache_stats_t stats;
+	cache_t cache;
+	char key[64];
+
+	printf("[+] Rejecting caches without a budget...\n");
+
+	if(cache_init(&cache, sizeof(int), &options) != CACHE_SIZE_ERROR || cache_init(&cache, 0, &options) != CACHE_SIZE_ERROR) {
+		fprintf(stderr, "Error: Created an unbounded cache!\n");
+		return CACHE_SIZE_ERROR;
+	}
+
+	printf("[+] Evicting the least recently used entries...\n");
+
+	if(test_policy(CACHE_LRU, "c", "a") != CACHE_OK)
+		return CACHE_SIZE_ERROR;
+
+	printf("[+] Evicting with the clock hand...\n");
+
+	if(test_policy(CACHE_CLOCK, "c", "d") != CACHE_OK)
+		return CACHE_SIZE_ERROR;
+
+	printf("[+] Evicting to stay within a byte budget...\n");
+
+	options = (cache_options_t) { .max_bytes = 100 };
+
+	if(cache_init(&cache, sizeof(int), &options) != CACHE_OK) {
+		fprintf(stderr, "Error: Could not create cache!\n");
+		return CACHE_MEM_ERROR;
+	}
+
+	int value = 7;
+
+	cache_put(&cache, "first", 5, &value, 40);
+	cache_put(&cache, "second", 6, &value, 40);
+
+	if(cache_put(&cache, "huge", 4, &value, 101) != CACHE_SIZE_ERROR || cache_put(&cache, "third", 5, &value, 40) != CACHE_OK) {
+		fprintf(stderr, "Error: Charges were not checked against the budget!\n");
+		return CACHE_SIZE_ERROR;
+	}
+
+	cache_stats(&cache, &stats);
+
+	if(stats.bytes != 80 || stats.entries != 2 || cache_get(&cache, "first", 5, NULL) != CACHE_MISS) {
+		fprintf(stderr, "Error: Holding %zu bytes in %zu entries after exceeding the budget!\n", stats.bytes, stats.entries);
+		return CACHE_SIZE_ERROR;
+	}
+
+	value = 8;
+
+	if(cache_put(&cache, "second", 6, &value, 90) != CACHE_OK || *(int *) cache_get_ref(&cache, "second", 6) != 8) {
+		fprintf(stderr, "Error: Could not replace an entry!\n");
+		return CACHE_SIZE_ERROR;
+	}
+
+	cache_stats(&cache, &stats);
+
+	if(stats.bytes != 90 || stats.entries != 1) {
+		fprintf(stderr, "Error: Growing an entry's charge did not evict the others!\n");
+		return CACHE_SIZE_ERROR;
+	}
+
+	cache_destroy(&cache);
+
+	printf("[+] Failing each allocation of a put in turn...\n");
+
+	options = (cache_options_t) { .max_entries = 4, .max_bytes = 1000 };
+
+	if(cache_init(&cache, sizeof(int), &options) != CACHE_OK) {
+		fprintf(stderr, "Error: Could not create cache!\n");
+		return CACHE_MEM_ERROR;
+	}
+
+	put_string(&cache, "kept", 1);
+
+	for(int fail = 0; ; fail++) {
+		failing_malloc = fail;
+		int status = put_string(&cache, fail % 2 ? "short" : "a-long-key-that-is-not-inline", 2);
+		failing_malloc = -1;
+
+		cache_stats(&cache, &stats);
+
+		if(status == CACHE_OK)
+			break;
+
+		if(status != CACHE_MEM_ERROR || stats.entries != 1 || stats.bytes != sizeof(int) + 4 || get_string(&cache, "kept") != 1) {
+			fprintf(stderr, "Error: A failed put left %zu entries charging %zu bytes!\n", stats.entries, stats.bytes);
+			return CACHE_SIZE_ERROR;
+		}
+	}
+
+	if(stats.entries != 2 || stats.evictions != 0) {
+		fprintf(stderr, "Error: The put after the failures evicted entries!\n");
+		return CACHE_SIZE_ERROR;
+	}
+
+	cache_destroy(&cache);
+
+	cache_policy_t policies[] = { CACHE_LRU, CACHE_CLOCK };
+
+	for(size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+		printf("[+] Running %d random operations on %d long keys with policy %zu...\n", STRESS_OPS, STRESS_KEYS, p);
+
+		options = (cache_options_t) { .max_entries = STRESS_ENTRIES, .policy = policies[p] };
+
+		if(cache_init(&cache, sizeof(int), &options) != CACHE_OK) {
+			fprintf(stderr, "Error: Could not create cache!\n");
+			return CACHE_MEM_ERROR;
+		}
+
+		size_t gets = 0;
+
+		srand(1);
+
+		for(int i = 0; i < STRESS_OPS; i++) {
+			int id = rand() % STRESS_KEYS;
+
+			snprintf(key, sizeof(key), "a-long-key-that-is-not-inline-%d", id);
+
+			if(rand() % 2) {
+				put_string(&cache, key, id);
+				continue;
+			}
+
+			gets++;
+
+			if((value = get_string(&cache, key)) != -1 && value != id) {
+				fprintf(stderr, "Error: Found %d under the key for %d!\n", value, id);
+				return CACHE_SIZE_ERROR;
+			}
+		}
+
+		cache_stats(&cache, &stats);
+
+		printf("[-] %zu hits, %zu misses, %zu evictions...\n", stats.hits, stats.misses, stats.evictions);
+
+		if(stats.entries != STRESS_ENTRIES || stats.hits + stats.misses != gets || stats.evictions == 0) {
+			fprintf(stderr, "Error: Counters do not add up!\n");
+			return CACHE_SIZE_ERROR;
+		}
+
+		cache_destroy(&cache);
+	}
+
+	printf("[+] All tests complete, terminating...\n");
+
+	return 0;
+}
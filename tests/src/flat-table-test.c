@@ -0,0 +1,97 @@
+#include <stdio.h>
+
+#include "../include/flat-table.h"
+
+#define STRESS_KEYS 100000
+
+int main()
+{
+	flat_table_t my_flat_table;
+	int data[] = { 12, 432, 62, 145 };
+	int data_out;
+	char * entries[] = { "foo", "bar", "baz", "a key that is too long to be stored inline" };
+	char key[64];
+
+	printf("[+] Generating table...\n");
+
+	if(ftinit(&my_flat_table, sizeof(int), FLAT_GROUP_WIDTH) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Inserting values...\n");
+
+	for(size_t i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+		if(ftinsert(&my_flat_table, entries[i], &data[i]) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+
+		printf("[-] Inserted value %d under key %s...\n", data[i], entries[i]);
+	}
+
+	printf("[+] Searching for values...\n");
+
+	for(size_t i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+		if(ftlookup(&my_flat_table, entries[i], &data_out) != TABLE_OK || data_out != data[i]) {
+			fprintf(stderr, "Error: Value under key %s is missing or wrong!\n", entries[i]);
+			return INVALID_ENTRY;
+		}
+
+		printf("[-] Found value \"%d\" under key %s!\n", data_out, entries[i]);
+	}
+
+	printf("[+] Deleting values...\n");
+
+	for(size_t i = 0; i < sizeof(entries) / sizeof(entries[0]); i++) {
+		if(ftdelete(&my_flat_table, entries[i]) != TABLE_OK || ftlookup(&my_flat_table, entries[i], NULL) != INVALID_ENTRY) {
+			fprintf(stderr, "Error: Could not delete value under key %s!\n", entries[i]);
+			return INVALID_ENTRY;
+		}
+
+		printf("[-] Successfully deleted value under key %s!\n", entries[i]);
+	}
+
+	printf("[+] Inserting %d values to force growth...\n", STRESS_KEYS);
+
+	for(int i = 0; i < STRESS_KEYS; i++) {
+		snprintf(key, sizeof(key), "%s%d", i & 1 ? "https://example.com/some/longer/path/" : "k", i);
+
+		if(ftinsert(&my_flat_table, key, &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	printf("[+] Deleting every third value...\n");
+
+	for(int i = 0; i < STRESS_KEYS; i += 3) {
+		snprintf(key, sizeof(key), "%s%d", i & 1 ? "https://example.com/some/longer/path/" : "k", i);
+
+		if(ftdelete(&my_flat_table, key) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not delete value under key %s!\n", key);
+			return INVALID_ENTRY;
+		}
+	}
+
+	printf("[+] Verifying remaining values...\n");
+
+	for(int i = 0; i < STRESS_KEYS; i++) {
+		snprintf(key, sizeof(key), "%s%d", i & 1 ? "https://example.com/some/longer/path/" : "k", i);
+
+		int status = ftlookup(&my_flat_table, key, &data_out);
+
+		if(i % 3 == 0 ? status != INVALID_ENTRY : status != TABLE_OK || data_out != i) {
+			fprintf(stderr, "Error: Unexpected result for key %s!\n", key);
+			return INVALID_ENTRY;
+		}
+	}
+
+	printf("[+] Destroying table...\n");
+
+	ftdestroy(&my_flat_table);
+
+	printf("[+] All tests complete, terminating...\n");
+
+	return 0;
+}
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "../include/hash-table.h"
+#include "../include/flat-table.h"
+
+#define BENCH_KEYS		200000
+#define BENCH_ROUNDS	20
+#define KEY_LENGTH		128
+#define LARGE_KEYS		(size_t) 2000000
+#define LARGE_LOOKUPS	(size_t) 4000000
+#define SHORT_LENGTH	24
+
+static char large_keys[LARGE_KEYS][SHORT_LENGTH];
+static char * large_names[LARGE_LOOKUPS];
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench_hash(const char * name, ht_hash_t hash, char (*keys)[KEY_LENGTH], size_t * lengths, size_t total_bytes)
+{
+	size_t sink = 0;
+	double start = now_ns();
+
+	for(int round = 0; round < BENCH_ROUNDS; round++)
+		for(size_t i = 0; i < BENCH_KEYS; i++)
+			sink += hash(keys[i], lengths[i]);
+
+	double elapsed = now_ns() - start;
+
+	printf("[-] %-6s hash:   %7.2f ns/key %8.1f MB/s (checksum %zx)\n", name,
+		elapsed / ((double) BENCH_KEYS * BENCH_ROUNDS), (double) total_bytes * BENCH_ROUNDS / (elapsed / 1e9) / 1e6, sink);
+}
+
+static int bench_table(const char * name, ht_hash_t hash, char (*keys)[KEY_LENGTH])
+{
+	ht_options_t options = { .hash = hash };
+	table_t table;
+	double start;
+	size_t found = 0;
+
+	if(htinit_opts(&table, sizeof(size_t), DEFAULT_TABLE_SIZE, &options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	start = now_ns();
+
+	for(size_t i = 0; i < BENCH_KEYS; i++) {
+		if(htinsert(&table, keys[i], &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	double insert_ns = (now_ns() - start) / BENCH_KEYS;
+
+	start = now_ns();
+
+	for(int round = 0; round < BENCH_ROUNDS; round++)
+		for(size_t i = 0; i < BENCH_KEYS; i++)
+			found += htlookup(&table, keys[i], NULL) == TABLE_OK;
+
+	double lookup_ns = (now_ns() - start) / ((double) BENCH_KEYS * BENCH_ROUNDS);
+
+	printf("[-] %-6s table:  %7.2f ns/insert %7.2f ns/lookup (%zu found)\n", name, insert_ns, lookup_ns, found);
+
+	htdestroy(&table);
+
+	return TABLE_OK;
+}
+
+static int bench_batch(void)
+{
+	static size_t values[256];
+	size_t batch_sizes[] = { 16, 64, 256 };
+	table_t table;
+	size_t found = 0;
+
+	if(htinit(&table, sizeof(size_t), DEFAULT_TABLE_SIZE) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < LARGE_KEYS; i++) {
+		if(htinsert(&table, large_keys[i], &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	double start = now_ns();
+
+	for(size_t i = 0; i < LARGE_LOOKUPS; i++)
+		found += htlookup(&table, large_names[i], &values[0]) == TABLE_OK;
+
+	double scalar_ns = (now_ns() - start) / LARGE_LOOKUPS;
+
+	printf("[-] scalar        %7.2f ns/lookup (%zu found)\n", scalar_ns, found);
+
+	for(size_t b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); b++) {
+		found = 0;
+		start = now_ns();
+
+		for(size_t i = 0; i + batch_sizes[b] <= LARGE_LOOKUPS; i += batch_sizes[b])
+			found += htlookup_batch(&table, large_names + i, batch_sizes[b], values, NULL) == TABLE_OK ? batch_sizes[b] : 0;
+
+		double batch_ns = (now_ns() - start) / LARGE_LOOKUPS;
+
+		printf("[-] batch of %3zu %7.2f ns/lookup (%zu found, %.2fx scalar)\n", batch_sizes[b], batch_ns, found, scalar_ns / batch_ns);
+	}
+
+	htdestroy(&table);
+
+	return TABLE_OK;
+}
+
+/* Counts the cache misses of this thread, or returns -1 where perf counters are unavailable */
+static int open_miss_counter(void)
+{
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_HARDWARE, .size = sizeof(attr), .config = PERF_COUNT_HW_CACHE_MISSES,
+		.disabled = 1, .exclude_kernel = 1, .exclude_hv = 1
+	};
+
+	return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counter_start(int counter)
+{
+	if(counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
+}
+
+static double counter_stop(int counter, size_t ops)
+{
+	uint64_t misses = 0;
+
+	if(counter < 0)
+		return -1;
+
+	ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+
+	if(read(counter, &misses, sizeof(misses)) != sizeof(misses))
+		return -1;
+
+	return (double) misses / ops;
+}
+
+static void print_lookups(const char * name, double ns, double misses, size_t found)
+{
+	if(misses < 0)
+		printf("[-] %-6s %7.2f ns/lookup (%zu found, no perf counters)\n", name, ns, found);
+	else
+		printf("[-] %-6s %7.2f ns/lookup %6.2f misses/lookup (%zu found)\n", name, ns, misses, found);
+}
+
+/* The chained table against the open addressing table over the same keys and lookups */
+static int bench_flat(void)
+{
+	int counter = open_miss_counter();
+	size_t value, found;
+	table_t table;
+	flat_table_t flat;
+
+	if(htinit(&table, sizeof(size_t), DEFAULT_TABLE_SIZE) != TABLE_OK || ftinit(&flat, sizeof(size_t), FLAT_GROUP_WIDTH) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create tables!\n");
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < LARGE_KEYS; i++) {
+		if(htinsert(&table, large_keys[i], &i) != TABLE_OK || ftinsert(&flat, large_keys[i], &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	found = 0;
+	counter_start(counter);
+
+	double start = now_ns();
+
+	for(size_t i = 0; i < LARGE_LOOKUPS; i++)
+		found += htlookup(&table, large_names[i], &value) == TABLE_OK;
+
+	double chained_ns = (now_ns() - start) / LARGE_LOOKUPS;
+	double chained_misses = counter_stop(counter, LARGE_LOOKUPS);
+
+	print_lookups("table", chained_ns, chained_misses, found);
+
+	found = 0;
+	counter_start(counter);
+	start = now_ns();
+
+	for(size_t i = 0; i < LARGE_LOOKUPS; i++)
+		found += ftlookup(&flat, large_names[i], &value) == TABLE_OK;
+
+	double flat_ns = (now_ns() - start) / LARGE_LOOKUPS;
+	double flat_misses = counter_stop(counter, LARGE_LOOKUPS);
+
+	print_lookups("flat", flat_ns, flat_misses, found);
+
+	if(flat_misses > 0)
+		printf("[-] flat is %.2fx faster with %.2fx fewer misses\n", chained_ns / flat_ns, chained_misses / flat_misses);
+	else
+		printf("[-] flat is %.2fx faster\n", chained_ns / flat_ns);
+
+	if(counter >= 0)
+		close(counter);
+
+	htdestroy(&table);
+	ftdestroy(&flat);
+
+	return TABLE_OK;
+}
+
+int main()
+{
+	static char keys[BENCH_KEYS][KEY_LENGTH];
+	static size_t lengths[BENCH_KEYS];
+	size_t total_bytes = 0;
+
+	printf("[+] Generating %d URL-like keys...\n", BENCH_KEYS);
+
+	srand(1);
+
+	for(size_t i = 0; i < BENCH_KEYS; i++) {
+		lengths[i] = (size_t) snprintf(keys[i], KEY_LENGTH, "https://www.example.com/catalogue/category-%d/products/item-%zu?ref=campaign-%d&session=%08x",
+			rand() % 64, i, rand() % 1000, (unsigned) rand());
+		total_bytes += lengths[i];
+	}
+
+	printf("[-] Average key length %.1f bytes\n", (double) total_bytes / BENCH_KEYS);
+	printf("[+] Hashing keys...\n");
+
+	bench_hash("djb2", hthash_djb2, keys, lengths, total_bytes);
+	bench_hash("wy", hthash_wy, keys, lengths, total_bytes);
+
+	printf("[+] Inserting and looking up keys...\n");
+
+	if(bench_table("djb2", hthash_djb2, keys) != TABLE_OK || bench_table("wy", hthash_wy, keys) != TABLE_OK)
+		return MEM_ERROR;
+
+	for(size_t i = 0; i < LARGE_KEYS; i++)
+		snprintf(large_keys[i], SHORT_LENGTH, "user:%zu", i);
+
+	for(size_t i = 0; i < LARGE_LOOKUPS; i++)
+		large_names[i] = large_keys[((size_t) rand() * RAND_MAX + rand()) % LARGE_KEYS];
+
+	printf("[+] Looking up random keys in a %zu entry table one at a time and in batches...\n", LARGE_KEYS);
+
+	if(bench_batch() != TABLE_OK)
+		return MEM_ERROR;
+
+	printf("[+] Looking up the same keys in a chained and an open addressing table...\n");
+
+	if(bench_flat() != TABLE_OK)
+		return MEM_ERROR;
+
+	printf("[+] All benchmarks complete, terminating...\n");
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "../include/hash-table.h"
+
+#define BENCH_KEYS		200000
+#define CHURN_KEYS		1024
+#define OPS_PER_THREAD	400000
+#define MAX_THREADS		32
+#define KEY_LENGTH		32
+
+typedef struct worker_t {
+	table_t * table;
+	int id;
+	int read_percent;
+	size_t hits;
+} worker_t;
+
+static char keys[BENCH_KEYS][KEY_LENGTH];
+static char churn_keys[MAX_THREADS][CHURN_KEYS][KEY_LENGTH];
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline uint64_t xorshift(uint64_t * state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+static void * bench_worker(void * argument)
+{
+	worker_t * worker = argument;
+	uint64_t state = 0x9E3779B97F4A7C15ULL * (worker->id + 1);
+	size_t value;
+
+	for(size_t i = 0; i < OPS_PER_THREAD; i++) {
+		uint64_t r = xorshift(&state);
+
+		if((int) (r % 100) < worker->read_percent) {
+			worker->hits += htlookup(worker->table, keys[(r >> 8) % BENCH_KEYS], &value) == TABLE_OK;
+		} else { /* Writers insert or delete their own keys at random so the table size stays flat */
+			char * key = churn_keys[worker->id][(r >> 8) % CHURN_KEYS];
+
+			if(r & (1 << 20))
+				htinsert(worker->table, key, &i);
+			else
+				htdelete(worker->table, key);
+		}
+	}
+
+	return NULL;
+}
+
+int main(int argc, char ** argv)
+{
+	int max_threads = argc > 1 ? atoi(argv[1]) : MAX_THREADS;
+	int read_percents[] = { 100, 95, 50 };
+	ht_options_t options = { .concurrent = 1 };
+	pthread_t threads[MAX_THREADS];
+	worker_t workers[MAX_THREADS];
+	table_t table;
+
+	if(max_threads < 1 || max_threads > MAX_THREADS)
+		max_threads = MAX_THREADS;
+
+	printf("[+] Generating keys...\n");
+
+	for(size_t i = 0; i < BENCH_KEYS; i++)
+		snprintf(keys[i], KEY_LENGTH, "user:%zu:session", i);
+
+	for(int t = 0; t < MAX_THREADS; t++)
+		for(int i = 0; i < CHURN_KEYS; i++)
+			snprintf(churn_keys[t][i], KEY_LENGTH, "churn:%d:%d", t, i);
+
+	if(htinit_opts(&table, sizeof(size_t), DEFAULT_TABLE_SIZE, &options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(size_t i = 0; i < BENCH_KEYS; i++) {
+		if(htinsert(&table, keys[i], &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	printf("[+] Running %d operations per thread on %d preloaded keys...\n", OPS_PER_THREAD, BENCH_KEYS);
+	printf("[-] %8s %8s %12s %14s\n", "threads", "reads", "Mops/s", "Mops/s/thread");
+
+	for(size_t r = 0; r < sizeof(read_percents) / sizeof(read_percents[0]); r++) {
+		for(int nthreads = 1; nthreads <= max_threads; nthreads <<= 1) {
+			double start = now_ns();
+
+			for(int t = 0; t < nthreads; t++) {
+				workers[t] = (worker_t) { .table = &table, .id = t, .read_percent = read_percents[r], .hits = 0 };
+				pthread_create(&threads[t], NULL, bench_worker, &workers[t]);
+			}
+
+			for(int t = 0; t < nthreads; t++)
+				pthread_join(threads[t], NULL);
+
+			double mops = (double) nthreads * OPS_PER_THREAD / ((now_ns() - start) / 1e3);
+
+			printf("[-] %8d %7d%% %12.2f %14.2f\n", nthreads, read_percents[r], mops, mops / nthreads);
+		}
+	}
+
+	htdestroy(&table);
+
+	printf("[+] All benchmarks complete, terminating...\n");
+
+	return 0;
+}
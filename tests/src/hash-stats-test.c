@@ -0,0 +1,134 @@
+#include <stdio.h>
+
+#include "../include/hash-table.h"
+
+#define STATS_BUCKETS 64
+#define STATS_KEYS 256
+#define MISSED_KEYS 100
+
+/* Keys are decimal numbers that hash to themselves, so key k always lands in bucket k % STATS_BUCKETS */
+static size_t number_hash(const void * key, size_t length)
+{
+	size_t hash = 0;
+
+	for(size_t i = 0; i < length; i++)
+		hash = hash * 10 + (size_t) (((const char *) key)[i] - '0');
+
+	return hash;
+}
+
+static int check_stats(table_t * table, int batched)
+{
+	char names[STATS_KEYS + MISSED_KEYS][8];
+	char * name_pointers[STATS_KEYS + MISSED_KEYS];
+	ht_stats_t stats;
+	int value;
+
+	for(int i = 0; i < STATS_KEYS + MISSED_KEYS; i++) {
+		snprintf(names[i], sizeof(names[i]), "%d", i);
+		name_pointers[i] = names[i];
+
+		if(i < STATS_KEYS && htinsert(table, names[i], &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	if(htstats(table, &stats) != TABLE_OK || !stats.counting || stats.lookups != 0) {
+		fprintf(stderr, "Error: Inserts were counted as lookups!\n");
+		return INVALID_ENTRY;
+	}
+
+	if(stats.entry_count != STATS_KEYS || stats.bucket_count != STATS_BUCKETS || stats.load_factor != 4.0 || stats.chain_lengths[4] != STATS_BUCKETS || stats.max_chain != 4) {
+		fprintf(stderr, "Error: Reported %zu entries in %zu buckets with %zu chains of 4, expected every chain to hold 4!\n", stats.entry_count, stats.bucket_count, stats.chain_lengths[4]);
+		return INVALID_ENTRY;
+	}
+
+	if(batched) {
+		htlookup_batch(table, name_pointers, STATS_KEYS + MISSED_KEYS, NULL, NULL);
+	} else {
+		for(int i = 0; i < STATS_KEYS + MISSED_KEYS; i++)
+			htlookup(table, names[i], &value);
+	}
+
+	htstats(table, &stats);
+
+	/* Each chain is walked by its four keys after passing 0, 1, 2 and 3 others, and in full by every miss */
+	if(stats.lookups != STATS_KEYS + MISSED_KEYS || stats.hits != STATS_KEYS || stats.misses != MISSED_KEYS || stats.collisions != STATS_BUCKETS * 6 + MISSED_KEYS * 4 || stats.max_probe != 4) {
+		fprintf(stderr, "Error: Counted %zu lookups, %zu hits, %zu misses, %zu collisions and a longest probe of %zu!\n", stats.lookups, stats.hits, stats.misses, stats.collisions, stats.max_probe);
+		return INVALID_ENTRY;
+	}
+
+	return TABLE_OK;
+}
+
+int main()
+{
+	ht_options_t options = { .max_load_factor = HT_NO_GROWTH, .hash = number_hash };
+	ht_stats_t stats;
+	table_t table;
+
+	printf("[+] Counting lookups in a table with fixed chains...\n");
+
+	if(htinit_opts(&table, sizeof(int), STATS_BUCKETS, &options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	if(check_stats(&table, 0) != TABLE_OK)
+		return INVALID_ENTRY;
+
+	htdestroy(&table);
+
+	printf("[+] Counting batched lookups...\n");
+
+	if(htinit_opts(&table, sizeof(int), STATS_BUCKETS, &options) != TABLE_OK || check_stats(&table, 1) != TABLE_OK)
+		return INVALID_ENTRY;
+
+	htdestroy(&table);
+
+	printf("[+] Counting lookups in a concurrent table...\n");
+
+	options.concurrent = 1;
+
+	if(htinit_opts(&table, sizeof(int), STATS_BUCKETS, &options) != TABLE_OK || check_stats(&table, 0) != TABLE_OK)
+		return INVALID_ENTRY;
+
+	htdestroy(&table);
+
+	printf("[+] Reporting a table part way through growing...\n");
+
+	options = (ht_options_t) { .migrate_step = 1, .hash = number_hash };
+
+	if(htinit_opts(&table, sizeof(int), STATS_BUCKETS, &options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < STATS_BUCKETS + 1; i++) {
+		char name[8];
+
+		snprintf(name, sizeof(name), "%d", i);
+		htinsert(&table, name, &i);
+	}
+
+	htstats(&table, &stats);
+
+	size_t chains = 0, entries = 0;
+
+	for(size_t i = 0; i < HT_STATS_CHAINS; i++) {
+		chains += stats.chain_lengths[i];
+		entries += i * stats.chain_lengths[i];
+	}
+
+	if(stats.entry_count != STATS_BUCKETS + 1 || stats.bucket_count != STATS_BUCKETS * 2 || entries != stats.entry_count || chains != STATS_BUCKETS * 3) {
+		fprintf(stderr, "Error: The histogram of a growing table holds %zu entries in %zu chains!\n", entries, chains);
+		return INVALID_ENTRY;
+	}
+
+	htdestroy(&table);
+
+	printf("[+] All tests complete, terminating...\n");
+
+	return 0;
+}
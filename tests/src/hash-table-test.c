@@ -1,7 +1,337 @@
 #include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "../include/hash-table.h"
 
+#define STRESS_KEYS 100000
+#define CONCURRENT_THREADS 4
+#define CONCURRENT_KEYS 20000
+#define SHARED_KEYS 1000
+#define IMAGE_KEYS 20000
+#define BUILD_KEYS 50000
+
+typedef struct record_t {
+	char * name;
+	int visits;
+} record_t;
+
+static int destroyed_records = 0;
+
+static void destroy_record(void * value)
+{
+	free(((record_t *) value)->name);
+	destroyed_records++;
+}
+
+typedef struct worker_t {
+	table_t * table;
+	int id;
+	int failures;
+} worker_t;
+
+static void * concurrent_worker(void * argument)
+{
+	worker_t * worker = argument;
+	char key[64];
+	int value;
+
+	for(int i = 0; i < CONCURRENT_KEYS; i++) {
+		snprintf(key, sizeof(key), "thread-%d-key-%d", worker->id, i);
+
+		if(htinsert(worker->table, key, &i) != TABLE_OK)
+			worker->failures++;
+
+		if(htlookup(worker->table, key, &value) != TABLE_OK || value != i)
+			worker->failures++;
+
+		if(i % 3 == 0 && htdelete(worker->table, key) != TABLE_OK)
+			worker->failures++;
+
+		int shared = (i * 7 + worker->id) % SHARED_KEYS;
+
+		snprintf(key, sizeof(key), "shared-%d", shared);
+
+		if(htlookup(worker->table, key, &value) != TABLE_OK || value != shared)
+			worker->failures++;
+	}
+
+	return NULL;
+}
+
+static void image_key(char * key, size_t size, int i)
+{
+	snprintf(key, size, i % 3 ? "key-%d" : "a-key-long-enough-to-live-in-a-chunk-%d", i);
+}
+
+static size_t custom_hash(const void * key, size_t length)
+{
+	return hthash_djb2(key, length) + 1;
+}
+
+/* Flip one byte of an image, counting from the end if offset is negative, and check that it no longer opens */
+static int check_corruption(const char * path, long offset)
+{
+	FILE * file = fopen(path, "r+b");
+	int whence = offset < 0 ? SEEK_END : SEEK_SET;
+	int byte, rejected;
+
+	if(!file || fseek(file, offset, whence) || (byte = fgetc(file)) == EOF)
+		return MEM_ERROR;
+
+	fseek(file, offset, whence);
+	fputc(byte ^ 0x40, file);
+	fflush(file);
+
+	table_t * table = htopen_mmap(path);
+
+	if((rejected = table == NULL) == 0)
+		htdestroy(table);
+
+	fseek(file, offset, whence);
+	fputc(byte, file);
+	fclose(file);
+
+	return rejected ? TABLE_OK : INVALID_ENTRY;
+}
+
+/* Overwrite eight bytes of an image, from its start or its first record, then recompute its checksums as an attacker
+ * could and check that it no longer opens. Follows the header layout and checksum blocks of hash-table.c */
+static int check_forgery(const char * path, int in_record, size_t offset, uint64_t forged)
+{
+	FILE * file = fopen(path, "rb");
+	unsigned char * image = NULL;
+	uint64_t checksum = 0, records_offset;
+	long size;
+	int rejected;
+
+	if(!file || fseek(file, 0, SEEK_END) || (size = ftell(file)) < 72 || !(image = malloc((size_t) size)) || fseek(file, 0, SEEK_SET) || fread(image, 1, (size_t) size, file) != (size_t) size)
+		return MEM_ERROR;
+
+	fclose(file);
+
+	memcpy(&records_offset, image + 40, sizeof(records_offset));
+	memcpy(image + (in_record ? records_offset : 0) + offset, &forged, sizeof(forged));
+
+	for(long block = 72; block < size; block += 65536)
+		checksum = checksum * 0x100000001B3ULL ^ hthash_wy(image + block, (size_t) (size - block < 65536 ? size - block : 65536));
+
+	memcpy(image + 56, &checksum, sizeof(checksum));
+	checksum = hthash_wy(image, 64);
+	memcpy(image + 64, &checksum, sizeof(checksum));
+
+	char forged_path[] = "/tmp/hash-forged-XXXXXX";
+	int fd = mkstemp(forged_path);
+
+	if(fd < 0 || write(fd, image, (size_t) size) != size || close(fd) != 0)
+		return MEM_ERROR;
+
+	table_t * table = htopen_mmap(forged_path);
+
+	if((rejected = table == NULL) == 0)
+		htdestroy(table);
+
+	unlink(forged_path);
+	free(image);
+
+	return rejected ? TABLE_OK : INVALID_ENTRY;
+}
+
+static int test_image(void)
+{
+	ht_options_t options = { .migrate_step = 1 };
+	char path[] = "/tmp/hash-image-XXXXXX";
+	char key[64], keys[16][64];
+	char * batch[16];
+	int results[16];
+	ht_stats_t image_stats;
+	table_t table;
+	int fd, value;
+
+	if(htinit_opts(&table, sizeof(int), 16, &options) != TABLE_OK || (fd = mkstemp(path)) < 0) {
+		fprintf(stderr, "Error: Could not create table or image file!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < IMAGE_KEYS; i++) {
+		image_key(key, sizeof(key), i);
+		htinsert(&table, key, &i);
+
+		if(i % 5 == 0)
+			htdelete(&table, key);
+	}
+
+	if(htsave(&table, fd) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not save the table!\n");
+		return MEM_ERROR;
+	}
+
+	close(fd);
+	htdestroy(&table);
+
+	table_t * mapped = htopen_mmap(path);
+
+	if(!mapped) {
+		fprintf(stderr, "Error: Could not open the saved image!\n");
+		return INVALID_ENTRY;
+	}
+
+	for(int i = 0; i < IMAGE_KEYS; i++) {
+		image_key(key, sizeof(key), i);
+
+		int status = htlookup(mapped, key, &value);
+		int * ref = htlookup_ref(mapped, key);
+
+		if(i % 5 == 0 ? status != INVALID_ENTRY || ref : status != TABLE_OK || value != i || !ref || *ref != i) {
+			fprintf(stderr, "Error: Unexpected result for key %s in the image!\n", key);
+			return INVALID_ENTRY;
+		}
+	}
+
+	for(int i = 0; i < 16; i++) {
+		image_key(keys[i], sizeof(keys[i]), i);
+		batch[i] = keys[i];
+	}
+
+	htlookup_batch(mapped, batch, 16, NULL, results);
+	htstats(mapped, &image_stats);
+
+	if(results[0] != INVALID_ENTRY || results[1] != TABLE_OK || image_stats.entry_count != IMAGE_KEYS - IMAGE_KEYS / 5 || image_stats.load_factor > 1.0) {
+		fprintf(stderr, "Error: Batch lookups or statistics are wrong for the image!\n");
+		return INVALID_ENTRY;
+	}
+
+	if(htinsert(mapped, key, &value) != UNSUPPORTED || htdelete(mapped, key) != UNSUPPORTED || htinsert_batch(mapped, batch, 1, &value) != UNSUPPORTED) {
+		fprintf(stderr, "Error: Modified a mapped table!\n");
+		return INVALID_ENTRY;
+	}
+
+	char copy_path[] = "/tmp/hash-image-XXXXXX";
+	table_t * copy = NULL;
+
+	if((fd = mkstemp(copy_path)) < 0 || htsave(mapped, fd) != TABLE_OK || close(fd) != 0 || !(copy = htopen_mmap(copy_path)) || htlookup(copy, "key-1", &value) != TABLE_OK || value != 1) {
+		fprintf(stderr, "Error: Could not save a mapped table and open the copy!\n");
+		return INVALID_ENTRY;
+	}
+
+	htdestroy(copy);
+	unlink(copy_path);
+	htdestroy(mapped);
+
+	printf("[+] Rejecting damaged images...\n");
+
+	if(check_corruption(path, 8) != TABLE_OK || check_corruption(path, 100) != TABLE_OK || check_corruption(path, -1) != TABLE_OK) {
+		fprintf(stderr, "Error: Opened a damaged image!\n");
+		return INVALID_ENTRY;
+	}
+
+	printf("[+] Rejecting images with forged records and recomputed checksums...\n");
+
+	/* Byte 8 of a record is its key length. With a 4 byte value, a key length of 2^64 - 32 makes a record of
+	 * 0 bytes, which would otherwise loop forever. Byte 16 of the header is the entry width */
+	if(check_forgery(path, 1, 8, (uint64_t) 0 - 32) != TABLE_OK || check_forgery(path, 1, 8, (uint64_t) 1 << 40) != TABLE_OK
+		|| check_forgery(path, 1, 8, 0) != TABLE_OK || check_forgery(path, 0, 16, (uint64_t) 0 - 16) != TABLE_OK) {
+		fprintf(stderr, "Error: Opened an image with forged records!\n");
+		return INVALID_ENTRY;
+	}
+
+	if(truncate(path, 4096) != 0 || htopen_mmap(path) || htopen_mmap("/nonexistent/image")) {
+		fprintf(stderr, "Error: Opened a truncated or missing image!\n");
+		return INVALID_ENTRY;
+	}
+
+	unlink(path);
+
+	options.hash = custom_hash;
+
+	if(htinit_opts(&table, sizeof(int), 16, &options) != TABLE_OK || htsave(&table, STDOUT_FILENO) != UNSUPPORTED) {
+		fprintf(stderr, "Error: Saved a table whose hash function cannot be recorded!\n");
+		return INVALID_ENTRY;
+	}
+
+	htdestroy(&table);
+
+	return TABLE_OK;
+}
+
+/* Every fourth key is added twice, the second time with its value plus one, which must win */
+static int test_build(size_t expected, int nthreads)
+{
+	ht_options_t options = { 0 };	/* Every option left at its default, growth included */
+	char key[64];
+	table_t table;
+	int value;
+
+	if(htbuild_begin(&table, sizeof(int), expected, &options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not begin the build!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < BUILD_KEYS; i++) {
+		image_key(key, sizeof(key), i);
+
+		if(htbuild_add(&table, key, &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not add an entry to the build!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	for(int i = 0; i < BUILD_KEYS; i += 4) {
+		int replacement = i + 1;
+
+		image_key(key, sizeof(key), i);
+		htbuild_add(&table, key, &replacement);
+	}
+
+	if(htbuild_finish(&table, nthreads) != TABLE_OK || htbuild_finish(&table, nthreads) != UNSUPPORTED) {
+		fprintf(stderr, "Error: Could not finish the build!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < BUILD_KEYS; i++) {
+		image_key(key, sizeof(key), i);
+
+		if(htlookup(&table, key, &value) != TABLE_OK || value != (i % 4 ? i : i + 1)) {
+			fprintf(stderr, "Error: Built table holds the wrong value for %s!\n", key);
+			return INVALID_ENTRY;
+		}
+	}
+
+	if(table.entry_count != BUILD_KEYS) {
+		fprintf(stderr, "Error: Built table holds %zu entries, expected %d!\n", table.entry_count, BUILD_KEYS);
+		return INVALID_ENTRY;
+	}
+
+	/* Built entries are deleted and replaced like any other, and the table grows past its expected size */
+	for(int i = 0; i < BUILD_KEYS; i += 2) {
+		image_key(key, sizeof(key), i);
+		htdelete(&table, key);
+		image_key(key, sizeof(key), i + BUILD_KEYS);
+		htinsert(&table, key, &i);
+	}
+
+	for(int i = 0; i < BUILD_KEYS * 2; i++) {
+		image_key(key, sizeof(key), i);
+
+		int present = i < BUILD_KEYS ? i % 2 : i % 2 == 0;
+
+		if((htlookup(&table, key, NULL) == TABLE_OK) != present) {
+			fprintf(stderr, "Error: Key %s should%s be in the built table!\n", key, present ? "" : " not");
+			return INVALID_ENTRY;
+		}
+	}
+
+	if((double) table.bucket_count * DEFAULT_LOAD_FACTOR < (double) table.entry_count) {
+		fprintf(stderr, "Error: Built table stopped growing at %zu buckets!\n", table.bucket_count);
+		return INVALID_ENTRY;
+	}
+
+	htdestroy(&table);
+
+	return TABLE_OK;
+}
+
 int main()
 {
 	table_t my_hash_table;
@@ -61,6 +391,431 @@ int main()
 	
 	htdestroy(&my_hash_table);
 
+	printf("[+] Generating a small table to force growth...\n");
+
+	ht_options_t options = { .max_load_factor = 2.0, .migrate_step = 1 };
+	char key[64];
+
+	if(htinit_opts(&my_hash_table, sizeof(int), 8, &options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Inserting %d values...\n", STRESS_KEYS);
+
+	for(int i = 0; i < STRESS_KEYS; i++) {
+		snprintf(key, sizeof(key), "key-%d", i);
+
+		if(htinsert(&my_hash_table, key, &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+
+		if(i % 7 == 0 && htdelete(&my_hash_table, key) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not delete value under key %s!\n", key);
+			return INVALID_ENTRY;
+		}
+	}
+
+	printf("[-] Table grew to %zu buckets...\n", my_hash_table.bucket_count);
+	printf("[+] Verifying values...\n");
+
+	for(int i = 0; i < STRESS_KEYS; i++) {
+		snprintf(key, sizeof(key), "key-%d", i);
+
+		int status = htlookup(&my_hash_table, key, &data_out);
+
+		if(i % 7 == 0 ? status != INVALID_ENTRY : status != TABLE_OK || data_out != i) {
+			fprintf(stderr, "Error: Unexpected result for key %s!\n", key);
+			return INVALID_ENTRY;
+		}
+	}
+
+	printf("[+] Checking the table's statistics...\n");
+
+	ht_stats_t table_stats;
+	size_t chained = 0;
+
+	htstats(&my_hash_table, &table_stats);
+
+	for(size_t i = 0; i < HT_STATS_CHAINS; i++)
+		chained += i * table_stats.chain_lengths[i];
+
+	printf("[-] Load factor %.2f, longest chain %zu...\n", table_stats.load_factor, table_stats.max_chain);
+
+	if(table_stats.entry_count != my_hash_table.entry_count || table_stats.bucket_count != my_hash_table.bucket_count || table_stats.max_chain < 1 || (table_stats.max_chain < HT_STATS_CHAINS && chained != table_stats.entry_count)) {
+		fprintf(stderr, "Error: Statistics do not match the table!\n");
+		return INVALID_ENTRY;
+	}
+
+	printf("[+] Destroying table...\n");
+
+	htdestroy(&my_hash_table);
+
+	printf("[+] Generating a table that never grows...\n");
+
+	options = (ht_options_t) { .max_load_factor = HT_NO_GROWTH };
+
+	if(htinit_opts(&my_hash_table, sizeof(int), 8, &options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < 64; i++) {
+		snprintf(key, sizeof(key), "key-%d", i);
+		htinsert(&my_hash_table, key, &i);
+	}
+
+	if(my_hash_table.bucket_count != 8 || my_hash_table.old_buckets) {
+		fprintf(stderr, "Error: A table without growth grew to %zu buckets!\n", my_hash_table.bucket_count);
+		return INVALID_ENTRY;
+	}
+
+	htdestroy(&my_hash_table);
+
+	printf("[+] Generating a table for binary keys...\n");
+
+	unsigned char binary_key[256];
+
+	if(htinit(&my_hash_table, sizeof(int), DEFAULT_TABLE_SIZE) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Inserting keys of every length from 0 to %zu bytes with embedded zero bytes...\n", sizeof(binary_key));
+
+	for(size_t round = 0; round < 2; round++) {
+		for(int i = 0; i <= (int) sizeof(binary_key); i++) {
+			memset(binary_key, 0, sizeof(binary_key));
+			binary_key[i / 2] = (unsigned char) i;
+
+			if(htinsert_n(&my_hash_table, binary_key, (size_t) i, &i) != TABLE_OK) {
+				fprintf(stderr, "Error: Could not insert element to table!\n");
+				return MEM_ERROR;
+			}
+		}
+
+		for(int i = 0; i <= (int) sizeof(binary_key); i++) {
+			memset(binary_key, 0, sizeof(binary_key));
+			binary_key[i / 2] = (unsigned char) i;
+
+			if(htlookup_n(&my_hash_table, binary_key, (size_t) i, &data_out) != TABLE_OK || data_out != i) {
+				fprintf(stderr, "Error: Unexpected result for a %d byte key!\n", i);
+				return INVALID_ENTRY;
+			}
+
+			if(htdelete_n(&my_hash_table, binary_key, (size_t) i) != TABLE_OK || htlookup_n(&my_hash_table, binary_key, (size_t) i, NULL) != INVALID_ENTRY) {
+				fprintf(stderr, "Error: Could not delete a %d byte key!\n", i);
+				return INVALID_ENTRY;
+			}
+		}
+
+		printf("[-] Round %zu inserted, found and deleted every key...\n", round + 1);
+	}
+
+	printf("[+] Destroying table...\n");
+
+	htdestroy(&my_hash_table);
+
+	printf("[+] Generating a table for batch operations...\n");
+
+	char batch_keys[256][32];
+	char * batch_names[256];
+	int batch_data[256];
+	int batch_out[256];
+	int batch_results[256];
+
+	if(htinit(&my_hash_table, sizeof(int), 64) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < 256; i++) {
+		snprintf(batch_keys[i], sizeof(batch_keys[i]), "batch-%d", i);
+		batch_names[i] = batch_keys[i];
+		batch_data[i] = i * 3;
+	}
+
+	printf("[+] Inserting the even keys as one batch...\n");
+
+	for(int i = 0; i < 128; i++) {
+		batch_names[i] = batch_keys[i * 2];
+		batch_data[i] = i * 2 * 3;
+	}
+
+	if(htinsert_batch(&my_hash_table, batch_names, 128, batch_data) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not insert batch to table!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Looking up every key as one batch...\n");
+
+	for(int i = 0; i < 256; i++)
+		batch_names[i] = batch_keys[i];
+
+	if(htlookup_batch(&my_hash_table, batch_names, 256, batch_out, batch_results) != INVALID_ENTRY) {
+		fprintf(stderr, "Error: Batch lookup did not report the missing keys!\n");
+		return INVALID_ENTRY;
+	}
+
+	for(int i = 0; i < 256; i++) {
+		if(i % 2 ? batch_results[i] != INVALID_ENTRY : batch_results[i] != TABLE_OK || batch_out[i] != i * 3) {
+			fprintf(stderr, "Error: Unexpected batch result for key %s!\n", batch_keys[i]);
+			return INVALID_ENTRY;
+		}
+	}
+
+	printf("[+] Destroying table...\n");
+
+	htdestroy(&my_hash_table);
+
+	printf("[+] Generating a table of records with a destructor...\n");
+
+	ht_options_t record_options = { .destructor = destroy_record };
+	record_t * record;
+
+	if(htinit_opts(&my_hash_table, sizeof(record_t), 8, &record_options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Constructing %d records in place...\n", 1000);
+
+	for(int i = 0; i < 1000; i++) {
+		snprintf(key, sizeof(key), "record-%d", i);
+
+		if(htemplace(&my_hash_table, key, (void **) &record) != TABLE_OK || !(record->name = strdup(key))) {
+			fprintf(stderr, "Error: Could not emplace element in table!\n");
+			return MEM_ERROR;
+		}
+
+		record->visits = 0;
+	}
+
+	printf("[+] Updating records through references...\n");
+
+	for(int round = 0; round < 3; round++) {
+		for(int i = 0; i < 1000; i++) {
+			snprintf(key, sizeof(key), "record-%d", i);
+
+			if(!(record = htlookup_ref(&my_hash_table, key)) || strcmp(record->name, key)) {
+				fprintf(stderr, "Error: Could not find record %s!\n", key);
+				return INVALID_ENTRY;
+			}
+
+			record->visits++;
+		}
+	}
+
+	if(htlookup_ref(&my_hash_table, "record-missing")) {
+		fprintf(stderr, "Error: Found a reference for a missing key!\n");
+		return INVALID_ENTRY;
+	}
+
+	record_t record_out;
+
+	if(htlookup(&my_hash_table, "record-42", &record_out) != TABLE_OK || record_out.visits != 3) {
+		fprintf(stderr, "Error: Updates through a reference were not kept!\n");
+		return INVALID_ENTRY;
+	}
+
+	printf("[+] Replacing and deleting records...\n");
+
+	if(htemplace(&my_hash_table, "record-0", (void **) &record) != TABLE_OK || destroyed_records != 1) {
+		fprintf(stderr, "Error: Emplacing over a record did not destroy it!\n");
+		return INVALID_ENTRY;
+	}
+
+	record->name = strdup("replaced");
+	record->visits = 0;
+	record_out = (record_t) { .name = strdup("inserted"), .visits = 0 };
+
+	if(htinsert(&my_hash_table, "record-1", &record_out) != TABLE_OK || destroyed_records != 2) {
+		fprintf(stderr, "Error: Inserting over a record did not destroy it!\n");
+		return INVALID_ENTRY;
+	}
+
+	for(int i = 0; i < 1000; i += 2) {
+		snprintf(key, sizeof(key), "record-%d", i);
+
+		if(htdelete(&my_hash_table, key) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not delete element from table!\n");
+			return INVALID_ENTRY;
+		}
+	}
+
+	if(destroyed_records != 502) {
+		fprintf(stderr, "Error: Expected 502 destroyed records, saw %d!\n", destroyed_records);
+		return INVALID_ENTRY;
+	}
+
+	printf("[+] Destroying table...\n");
+
+	htdestroy(&my_hash_table);
+
+	if(destroyed_records != 1002) {
+		fprintf(stderr, "Error: Destroying the table left %d records undestroyed!\n", 1002 - destroyed_records);
+		return INVALID_ENTRY;
+	}
+
+	printf("[+] Generating a table backed by a pool...\n");
+
+	ht_options_t pool_options = { 0 };
+	pool_stats_t stats;
+	pool_t pool;
+
+	if(pool_init(&pool, sizeof(int)) != POOL_OK) {
+		fprintf(stderr, "Error: Could not create pool!\n");
+		return MEM_ERROR;
+	}
+
+	pool_options.pool = &pool;
+
+	if(htinit_opts(&my_hash_table, sizeof(int), 8, &pool_options) == TABLE_OK) {
+		fprintf(stderr, "Error: Created a table from a pool of undersized objects!\n");
+		return MEM_ERROR;
+	}
+
+	pool_destroy(&pool);
+
+	if(pool_init(&pool, htnode_size(sizeof(int))) != POOL_OK || htinit_opts(&my_hash_table, sizeof(int), 8, &pool_options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < 10000; i++) {
+		snprintf(key, sizeof(key), "pooled-%d", i);
+
+		if(htinsert(&my_hash_table, key, &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	pool_stats(&pool, &stats);
+
+	printf("[-] %zu live, %zu free, %zu total bytes...\n", stats.live_bytes, stats.free_bytes, stats.total_bytes);
+
+	if(stats.live_bytes != 10000 * pool.object_size) {
+		fprintf(stderr, "Error: Pool counters do not match the table size!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < 10000; i++) {
+		snprintf(key, sizeof(key), "pooled-%d", i);
+
+		if(htlookup(&my_hash_table, key, &data_out) != TABLE_OK || data_out != i || htdelete(&my_hash_table, key) != TABLE_OK) {
+			fprintf(stderr, "Error: Unexpected result for key %s!\n", key);
+			return INVALID_ENTRY;
+		}
+	}
+
+	pool_stats(&pool, &stats);
+
+	if(stats.live_bytes != 0) {
+		fprintf(stderr, "Error: Deleted entries were not returned to the pool!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Destroying table...\n");
+
+	htdestroy(&my_hash_table);
+
+	printf("[+] Generating a concurrent table sharing the pool...\n");
+
+	ht_options_t concurrent_options = { .migrate_step = 1, .concurrent = 1, .pool = &pool };
+	pthread_t threads[CONCURRENT_THREADS];
+	worker_t workers[CONCURRENT_THREADS];
+
+	if(htinit_opts(&my_hash_table, sizeof(int), 8, &concurrent_options) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < SHARED_KEYS; i++) {
+		snprintf(key, sizeof(key), "shared-%d", i);
+
+		if(htinsert(&my_hash_table, key, &i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	printf("[+] Running %d threads inserting, looking up and deleting...\n", CONCURRENT_THREADS);
+
+	for(int i = 0; i < CONCURRENT_THREADS; i++) {
+		workers[i] = (worker_t) { .table = &my_hash_table, .id = i, .failures = 0 };
+		pthread_create(&threads[i], NULL, concurrent_worker, &workers[i]);
+	}
+
+	for(int i = 0; i < CONCURRENT_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+
+		if(workers[i].failures) {
+			fprintf(stderr, "Error: Thread %d saw %d failed operations!\n", i, workers[i].failures);
+			return INVALID_ENTRY;
+		}
+	}
+
+	printf("[-] Table grew to %zu buckets...\n", my_hash_table.bucket_count);
+	printf("[+] Verifying values...\n");
+
+	void * slot;
+
+	if(htemplace(&my_hash_table, "shared-0", &slot) != UNSUPPORTED || htlookup_ref(&my_hash_table, "shared-0")) {
+		fprintf(stderr, "Error: In-place access was allowed on a concurrent table!\n");
+		return INVALID_ENTRY;
+	}
+
+	for(int t = 0; t < CONCURRENT_THREADS; t++) {
+		for(int i = 0; i < CONCURRENT_KEYS; i++) {
+			snprintf(key, sizeof(key), "thread-%d-key-%d", t, i);
+
+			int status = htlookup(&my_hash_table, key, &data_out);
+
+			if(i % 3 == 0 ? status != INVALID_ENTRY : status != TABLE_OK || data_out != i) {
+				fprintf(stderr, "Error: Unexpected result for key %s!\n", key);
+				return INVALID_ENTRY;
+			}
+		}
+	}
+
+	printf("[+] Destroying table and pool...\n");
+
+	htdestroy(&my_hash_table);
+	pool_stats(&pool, &stats);
+
+	if(stats.live_bytes != 0) {
+		fprintf(stderr, "Error: Destroying the table left %zu bytes live!\n", stats.live_bytes);
+		return MEM_ERROR;
+	}
+
+	pool_destroy(&pool);
+
+	printf("[+] Building tables in bulk...\n");
+
+	if(test_build(BUILD_KEYS, 1) != TABLE_OK || test_build(100, 1) != TABLE_OK || test_build(BUILD_KEYS, 4) != TABLE_OK)
+		return INVALID_ENTRY;
+
+	if(htinit(&my_hash_table, sizeof(int), 16) != TABLE_OK || htbuild_add(&my_hash_table, "foo", &data[0]) != UNSUPPORTED || htbuild_finish(&my_hash_table, 1) != UNSUPPORTED) {
+		fprintf(stderr, "Error: Added to a table that is not being built!\n");
+		return INVALID_ENTRY;
+	}
+
+	htdestroy(&my_hash_table);
+
+	if(htbuild_begin(&my_hash_table, sizeof(int), 0, NULL) != TABLE_OK || htbuild_add(&my_hash_table, "a-key-long-enough-to-live-in-a-chunk", &data[0]) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not begin an empty build!\n");
+		return MEM_ERROR;
+	}
+
+	htdestroy(&my_hash_table); /* Abandoning a build must not leak its arenas or keys */
+
+	printf("[+] Saving a table and serving lookups from the mapped image...\n");
+
+	if(test_image() != TABLE_OK)
+		return INVALID_ENTRY;
+
 	printf("[+] All tests complete, terminating...\n");
 
 	return 0;
@@ -0,0 +1,572 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/linked-list.h"
+
+#define LIST_ELEMENTS 10000
+#define SORT_ELEMENTS 200000
+
+typedef struct record_t {
+	int key;
+	int sequence;
+} record_t;
+
+typedef struct wide_t {
+	int value;
+	char padding[300];
+} wide_t;
+
+static int compare_ints(const void * first_element, const void * second_element)
+{
+	return *(const int *) first_element - *(const int *) second_element;
+}
+
+static int compare_keys(const void * first_element, const void * second_element)
+{
+	return ((const record_t *) first_element)->key - ((const record_t *) second_element)->key;
+}
+
+static void check_order(const void * data, const void * parameter)
+{
+	const record_t * record = data;
+	record_t * previous = (record_t *) parameter;
+
+	if(previous->key > record->key || (previous->key == record->key && previous->sequence > record->sequence))
+		previous->sequence = -1; /* Poisons every later comparison */
+	else if(previous->sequence >= 0)
+		*previous = *record;
+}
+
+/* Walk the list checking every prev link, the tail and the length */
+static int check_links(llist_t * list)
+{
+	llist_element_t * prev = NULL;
+	int length = 0;
+
+	for(llist_element_t * curr = list->head; curr != NULL; curr = curr->next, length++) {
+		if(curr->prev != prev)
+			return INDEX_ERROR;
+
+		prev = curr;
+	}
+
+	return list->tail == prev && list->length == length ? LIST_OK : INDEX_ERROR;
+}
+
+/* Check the list holds exactly the ints in expected, in order */
+static int check_ints(llist_t * list, const int * expected, int count)
+{
+	llist_element_t * curr = list->head;
+
+	for(int i = 0; i < count; i++, curr = curr->next)
+		if(curr == NULL || *(int *) curr->data != expected[i])
+			return INDEX_ERROR;
+
+	return curr == NULL ? check_links(list) : INDEX_ERROR;
+}
+
+static int test_links(void)
+{
+	llist_t list;
+	llist_element_t * elements[LIST_ELEMENTS];
+
+	if(llist_init(&list, sizeof(int)) != LIST_OK) {
+		fprintf(stderr, "Error: Could not create list!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < 6; i++)
+		llist_push(&i, &list);
+
+	int value = 10;
+	int after_remove[] = { 1, 2, 4 };
+	int after_insert[] = { 10, 1, 11, 2, 4, 12 };
+	int after_move[] = { 12, 10, 11, 2, 4, 1 };
+
+	if(llist_remove(list.head, &list) != LIST_OK || llist_remove(list.tail, &list) != LIST_OK || llist_remove(list.head->next->next, &list) != LIST_OK || check_ints(&list, after_remove, 3) != LIST_OK) {
+		fprintf(stderr, "Error: Removing the head, tail and a middle element broke the list!\n");
+		return INDEX_ERROR;
+	}
+
+	if(llist_insert_before(&value, list.head, &list) != LIST_OK) {
+		fprintf(stderr, "Error: Could not insert before the head!\n");
+		return INDEX_ERROR;
+	}
+
+	value++;
+	llist_insert_before(&value, list.head->next->next, &list);
+	value++;
+	llist_insert_after(&value, list.tail, &list);
+
+	if(check_ints(&list, after_insert, 6) != LIST_OK) {
+		fprintf(stderr, "Error: Inserting elements broke the list!\n");
+		return INDEX_ERROR;
+	}
+
+	if(llist_move_to_front(list.tail, &list) != LIST_OK || llist_move_to_back(list.head->next->next, &list) != LIST_OK || llist_move_to_front(list.head, &list) != LIST_OK || llist_move_to_back(list.tail, &list) != LIST_OK || check_ints(&list, after_move, 6) != LIST_OK) {
+		fprintf(stderr, "Error: Moving elements broke the list!\n");
+		return INDEX_ERROR;
+	}
+
+	while(list.head)
+		llist_remove(list.tail, &list);
+
+	if(check_links(&list) != LIST_OK || llist_remove(NULL, &list) != INDEX_ERROR || llist_move_to_front(NULL, &list) != INDEX_ERROR) {
+		fprintf(stderr, "Error: Removing every element left the list inconsistent!\n");
+		return INDEX_ERROR;
+	}
+
+	printf("[+] Touching %d elements in least recently used order...\n", LIST_ELEMENTS);
+
+	for(int i = 0; i < LIST_ELEMENTS; i++) {
+		llist_push(&i, &list);
+		elements[i] = list.tail;
+	}
+
+	for(int i = 0; i < LIST_ELEMENTS * 10; i++) /* Touch one in seven, which leaves the list rotated */
+		llist_move_to_back(elements[(i * 7) % LIST_ELEMENTS], &list);
+
+	if(check_links(&list) != LIST_OK || *(int *) list.tail->data != ((LIST_ELEMENTS * 10 - 1) * 7) % LIST_ELEMENTS) {
+		fprintf(stderr, "Error: Moving elements to the back broke the list!\n");
+		return INDEX_ERROR;
+	}
+
+	for(int i = 0; i < LIST_ELEMENTS; i += 2)
+		llist_remove(elements[i], &list);
+
+	if(check_links(&list) != LIST_OK || list.length != LIST_ELEMENTS / 2) {
+		fprintf(stderr, "Error: Removing every other element broke the list!\n");
+		return INDEX_ERROR;
+	}
+
+	llist_destroy(&list);
+
+	return LIST_OK;
+}
+
+static int sort_list(llist_t * list, int pattern)
+{
+	record_t record;
+
+	while(llist_pop(&record, list) == LIST_OK);
+
+	for(int i = 0; i < SORT_ELEMENTS; i++) {
+		switch(pattern) {
+			case 0: record.key = rand() % 1000; break;					/* Random with many ties */
+			case 1: record.key = i; break;								/* Already sorted */
+			case 2: record.key = SORT_ELEMENTS - i; break;				/* Reversed */
+			default: record.key = (i % 1000) + rand() % 3; break;		/* Long ascending runs */
+		}
+
+		record.sequence = i;
+
+		if(llist_push(&record, list) != LIST_OK) {
+			fprintf(stderr, "Error: Could not push to list!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	if(llist_sort(compare_keys, list) != LIST_OK) {
+		fprintf(stderr, "Error: Could not sort list!\n");
+		return MEM_ERROR;
+	}
+
+	record_t previous = { .key = -1, .sequence = 0 };
+
+	llist_operate(check_order, &previous, list);
+
+	if(previous.sequence < 0 || list->length != SORT_ELEMENTS || compare_keys(llist_peek_tail(NULL, list), &previous) || (!list->block_capacity && check_links(list) != LIST_OK)) {
+		fprintf(stderr, "Error: Sort pattern %d is out of order, unstable or lost its tail!\n", pattern);
+		return INDEX_ERROR;
+	}
+
+	record.key = SORT_ELEMENTS + 1;
+
+	if(llist_push(&record, list) != LIST_OK || ((record_t *) llist_peek_tail(NULL, list))->key != SORT_ELEMENTS + 1) {
+		fprintf(stderr, "Error: Could not push after sorting!\n");
+		return INDEX_ERROR;
+	}
+
+	return LIST_OK;
+}
+
+static int sort_parallel(int pattern, int nthreads)
+{
+	llist_t sequential, parallel;
+	record_t record;
+
+	if(llist_init(&sequential, sizeof(record_t)) != LIST_OK || llist_init(&parallel, sizeof(record_t)) != LIST_OK) {
+		fprintf(stderr, "Error: Could not create list!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < SORT_ELEMENTS; i++) {
+		record.key = pattern == 0 ? rand() % 100 : pattern == 1 ? i / 7 : SORT_ELEMENTS - i / 3;
+		record.sequence = i;
+
+		if(llist_push(&record, &sequential) != LIST_OK || llist_push(&record, &parallel) != LIST_OK) {
+			fprintf(stderr, "Error: Could not push to list!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	if(llist_sort(compare_keys, &sequential) != LIST_OK || llist_sort_parallel(compare_keys, &parallel, nthreads) != LIST_OK) {
+		fprintf(stderr, "Error: Could not sort list!\n");
+		return MEM_ERROR;
+	}
+
+	llist_element_t * first = sequential.head;
+	llist_element_t * second = parallel.head;
+
+	for(; first != NULL && second != NULL; first = first->next, second = second->next)
+		if(memcmp(first->data, second->data, sizeof(record_t)))
+			break;
+
+	if(first != NULL || second != NULL || memcmp(sequential.tail->data, parallel.tail->data, sizeof(record_t)) || check_links(&parallel) != LIST_OK) {
+		fprintf(stderr, "Error: Parallel sort with %d threads differs from the sequential sort for pattern %d!\n", nthreads, pattern);
+		return INDEX_ERROR;
+	}
+
+	llist_destroy(&sequential);
+	llist_destroy(&parallel);
+
+	return LIST_OK;
+}
+
+static void sum_ints(const void * data, const void * parameter)
+{
+	*(long *) parameter += *(const int *) data;
+}
+
+static int exercise_list(llist_t * list)
+{
+	long sum = 0;
+	int value;
+
+	for(int i = 0; i < LIST_ELEMENTS; i++) {
+		if(llist_push(&i, list) != LIST_OK) {
+			fprintf(stderr, "Error: Could not push to list!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	if(list->length != LIST_ELEMENTS || *(int *) llist_peek(&value, list) != 0 || value != 0 || *(int *) llist_peek_tail(NULL, list) != LIST_ELEMENTS - 1) {
+		fprintf(stderr, "Error: List ends do not match the pushed values!\n");
+		return INDEX_ERROR;
+	}
+
+	value = 4321;
+
+	int * found = llist_find(&value, compare_ints, list);
+
+	if(!found || *found != 4321) {
+		fprintf(stderr, "Error: Could not find a pushed value!\n");
+		return INDEX_ERROR;
+	}
+
+	value = LIST_ELEMENTS;
+
+	if(llist_find(&value, compare_ints, list)) {
+		fprintf(stderr, "Error: Found a value that was never pushed!\n");
+		return INDEX_ERROR;
+	}
+
+	if((found = llist_find_u32(4321, list)) == NULL || *found != 4321 || llist_find_u32(LIST_ELEMENTS, list) || llist_find_u64(4321, list)) {
+		fprintf(stderr, "Error: Typed search did not match llist_find!\n");
+		return INDEX_ERROR;
+	}
+
+	llist_operate(sum_ints, &sum, list);
+
+	if(sum != (long) LIST_ELEMENTS * (LIST_ELEMENTS - 1) / 2) {
+		fprintf(stderr, "Error: Operation visited the wrong elements!\n");
+		return INDEX_ERROR;
+	}
+
+	for(int i = 0; i < LIST_ELEMENTS; i++) {
+		if(llist_pop(&value, list) != LIST_OK || value != i) {
+			fprintf(stderr, "Error: Popped %d where %d was expected!\n", value, i);
+			return INDEX_ERROR;
+		}
+
+		if(i % 3 == 0 && llist_push(&i, list) != LIST_OK) { /* Keep the tail moving while the head is consumed */
+			fprintf(stderr, "Error: Could not push to list!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	for(int i = 0; i < LIST_ELEMENTS; i += 3) {
+		if(llist_pop(&value, list) != LIST_OK || value != i) {
+			fprintf(stderr, "Error: Popped %d where %d was expected!\n", value, i);
+			return INDEX_ERROR;
+		}
+	}
+
+	if(list->length != 0 || llist_pop(&value, list) != INDEX_ERROR || llist_peek(NULL, list) || llist_peek_tail(NULL, list)) {
+		fprintf(stderr, "Error: List is not empty after popping every element!\n");
+		return INDEX_ERROR;
+	}
+
+	return LIST_OK;
+}
+
+/* Search every position for 8 and 16 byte keys, both packed and at the front of wider elements */
+static int test_find_keys(size_t block_size)
+{
+	llist_options_t options = { .block_size = block_size };
+	llist_t ids, wide_ids, records;
+	unsigned char id[16] = { 0 }, scratch[16];
+
+	if(llist_init_opts(&ids, sizeof(uint64_t), &options) != LIST_OK || llist_init_opts(&wide_ids, sizeof(id), &options) != LIST_OK || llist_init_opts(&records, sizeof(record_t), &options) != LIST_OK) {
+		fprintf(stderr, "Error: Could not create list!\n");
+		return MEM_ERROR;
+	}
+
+	for(int i = 0; i < 1000; i++) {
+		uint64_t value = (uint64_t) i << 32 | 7;
+		record_t record = { .key = i, .sequence = -i };
+
+		id[15] = (unsigned char) i;
+		id[0] = (unsigned char) (i >> 8);
+
+		llist_push(&value, &ids);
+		llist_push(id, &wide_ids);
+		llist_push(&record, &records);
+	}
+
+	for(int i = 0; i < 10; i++) { /* Leaves the head blocks partly consumed */
+		llist_pop(scratch, &ids);
+		llist_pop(scratch, &wide_ids);
+		llist_pop(scratch, &records);
+	}
+
+	for(int i = 0; i < 1000; i++) {
+		uint64_t * value = llist_find_u64((uint64_t) i << 32 | 7, &ids);
+		record_t * record = llist_find_u32((uint32_t) i, &records);
+
+		id[15] = (unsigned char) i;
+		id[0] = (unsigned char) (i >> 8);
+
+		unsigned char * found = llist_find_u128(id, &wide_ids);
+
+		if(i < 10 ? value || found || record : !value || *value != ((uint64_t) i << 32 | 7) || !found || memcmp(found, id, sizeof(id)) || !record || record->sequence != -i) {
+			fprintf(stderr, "Error: Typed search for key %d returned the wrong element!\n", i);
+			return INDEX_ERROR;
+		}
+	}
+
+	if(llist_find_u64(7, &ids) || llist_find_u64((uint64_t) 1000 << 32 | 7, &ids)) {
+		fprintf(stderr, "Error: Matched half of an 8 byte key!\n");
+		return INDEX_ERROR;
+	}
+
+	llist_destroy(&ids);
+	llist_destroy(&wide_ids);
+	llist_destroy(&records);
+
+	return LIST_OK;
+}
+
+static void double_int(const void * data, const void * parameter)
+{
+	(void) parameter;
+
+	*(int *) data *= 2;
+}
+
+static void scale_int(const void * data, void * value, const void * parameter)
+{
+	*(double *) value = *(const int *) data * *(const double *) parameter;
+}
+
+static void add_doubles(void * accumulator, const void * value)
+{
+	*(double *) accumulator += *(const double *) value;
+}
+
+/* Doubles every element in parallel, then sums them in floating point, which must give the same bits on any number of threads */
+static int test_reduce(size_t block_size)
+{
+	llist_options_t options = { .block_size = block_size };
+	int thread_counts[] = { 1, 2, 3, 8, 100 };
+	double identity = 0, scale = 0.1, expected = 0, sum;
+	long total = 0;
+	llist_t list;
+
+	if(llist_init_opts(&list, sizeof(int), &options) != LIST_OK) {
+		fprintf(stderr, "Error: Could not create list!\n");
+		return MEM_ERROR;
+	}
+
+	if(llist_reduce(scale_int, add_doubles, &identity, &sum, sizeof(double), &scale, &list, 4) != LIST_OK || sum != 0 || llist_reduce(scale_int, add_doubles, &identity, &sum, 0, &scale, &list, 4) != SIZE_ERROR) {
+		fprintf(stderr, "Error: Reducing an empty list did not give the identity!\n");
+		return SIZE_ERROR;
+	}
+
+	for(int i = 0; i < SORT_ELEMENTS; i++)
+		llist_push(&i, &list);
+
+	if(llist_operate_parallel(double_int, NULL, &list, 4) != LIST_OK) {
+		fprintf(stderr, "Error: Could not operate on the list in parallel!\n");
+		return MEM_ERROR;
+	}
+
+	llist_operate(sum_ints, &total, &list);
+
+	if(total != (long) SORT_ELEMENTS * (SORT_ELEMENTS - 1)) {
+		fprintf(stderr, "Error: Parallel operation visited the wrong elements!\n");
+		return INDEX_ERROR;
+	}
+
+	for(size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+		if(llist_reduce(scale_int, add_doubles, &identity, &sum, sizeof(double), &scale, &list, thread_counts[i]) != LIST_OK) {
+			fprintf(stderr, "Error: Could not reduce the list!\n");
+			return MEM_ERROR;
+		}
+
+		if(i == 0)
+			expected = sum;
+
+		if(memcmp(&sum, &expected, sizeof(double)) || sum < total * scale * 0.999 || sum > total * scale * 1.001) {
+			fprintf(stderr, "Error: Reducing on %d threads gave %f, expected %f!\n", thread_counts[i], sum, expected);
+			return INDEX_ERROR;
+		}
+	}
+
+	llist_destroy(&list);
+
+	return LIST_OK;
+}
+
+int main()
+{
+	llist_t list;
+
+	printf("[+] Generating list...\n");
+
+	if(llist_init(&list, sizeof(int)) != LIST_OK) {
+		fprintf(stderr, "Error: Could not create list!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Pushing, searching and popping %d elements...\n", LIST_ELEMENTS);
+
+	if(exercise_list(&list) != LIST_OK)
+		return INDEX_ERROR;
+
+	printf("[+] Destroying list...\n");
+
+	llist_destroy(&list);
+
+	printf("[+] Removing, inserting and moving elements...\n");
+
+	if(test_links() != LIST_OK)
+		return INDEX_ERROR;
+
+	printf("[+] Searching for 4, 8 and 16 byte keys...\n");
+
+	if(test_find_keys(0) != LIST_OK || test_find_keys(LLIST_BLOCK_SIZE) != LIST_OK)
+		return INDEX_ERROR;
+
+	size_t block_sizes[] = { 1, LLIST_BLOCK_SIZE, 4096 };
+
+	for(size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++) {
+		llist_options_t options = { .block_size = block_sizes[i] };
+
+		printf("[+] Generating an unrolled list with %zu byte blocks...\n", block_sizes[i]);
+
+		if(llist_init_opts(&list, sizeof(int), &options) != LIST_OK) {
+			fprintf(stderr, "Error: Could not create list!\n");
+			return MEM_ERROR;
+		}
+
+		printf("[-] %zu elements per %zu byte block...\n", list.block_capacity, list.block_bytes);
+
+		if(list.block_bytes % LLIST_CACHE_LINE || list.block_capacity < 1) {
+			fprintf(stderr, "Error: Blocks are not a whole number of cache lines!\n");
+			return SIZE_ERROR;
+		}
+
+		printf("[+] Pushing, searching and popping %d elements...\n", LIST_ELEMENTS);
+
+		if(exercise_list(&list) != LIST_OK)
+			return INDEX_ERROR;
+
+		if(llist_insert_after(&i, NULL, &list) != MODE_ERROR || llist_remove(NULL, &list) != MODE_ERROR || llist_search(&i, compare_ints, &list)) {
+			fprintf(stderr, "Error: Element operations were allowed on an unrolled list!\n");
+			return MODE_ERROR;
+		}
+
+		printf("[+] Destroying list with elements left in it...\n");
+
+		for(int j = 0; j < 100; j++)
+			llist_push(&j, &list);
+
+		llist_destroy(&list);
+	}
+
+	for(size_t block_size = 0; block_size <= LLIST_BLOCK_SIZE; block_size += LLIST_BLOCK_SIZE) {
+		llist_options_t sort_options = { .block_size = block_size };
+
+		printf("[+] Sorting %d records in a list with %zu byte blocks...\n", SORT_ELEMENTS, block_size);
+
+		if(llist_init_opts(&list, sizeof(record_t), &sort_options) != LIST_OK) {
+			fprintf(stderr, "Error: Could not create list!\n");
+			return MEM_ERROR;
+		}
+
+		if(llist_sort(compare_keys, &list) != INDEX_ERROR) {
+			fprintf(stderr, "Error: Sorted an empty list!\n");
+			return INDEX_ERROR;
+		}
+
+		for(int pattern = 0; pattern < 4; pattern++)
+			if(sort_list(&list, pattern) != LIST_OK)
+				return INDEX_ERROR;
+
+		llist_destroy(&list);
+	}
+
+	int thread_counts[] = { 1, 2, 3, 8, 16, 100 };
+
+	for(size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+		printf("[+] Comparing parallel sorts on %d threads with the sequential sort...\n", thread_counts[i]);
+
+		for(int pattern = 0; pattern < 3; pattern++)
+			if(sort_parallel(pattern, thread_counts[i]) != LIST_OK)
+				return INDEX_ERROR;
+	}
+
+	printf("[+] Mapping and reducing %d elements on several threads...\n", SORT_ELEMENTS);
+
+	if(test_reduce(0) != LIST_OK || test_reduce(LLIST_BLOCK_SIZE) != LIST_OK)
+		return INDEX_ERROR;
+
+	printf("[+] Generating an unrolled list of elements wider than a block...\n");
+
+	llist_options_t options = { .block_size = LLIST_BLOCK_SIZE };
+	wide_t wide = { 0 };
+
+	if(llist_init_opts(&list, sizeof(wide_t), &options) != LIST_OK || list.block_capacity != 1) {
+		fprintf(stderr, "Error: Could not create list!\n");
+		return MEM_ERROR;
+	}
+
+	for(wide.value = 0; wide.value < 100; wide.value++)
+		llist_push(&wide, &list);
+
+	for(int i = 0; i < 100; i++) {
+		if(llist_pop(&wide, &list) != LIST_OK || wide.value != i) {
+			fprintf(stderr, "Error: Popped %d where %d was expected!\n", wide.value, i);
+			return INDEX_ERROR;
+		}
+	}
+
+	printf("[+] Destroying list...\n");
+
+	llist_destroy(&list);
+
+	printf("[+] All tests complete, terminating...\n");
+
+	return 0;
+}
@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../include/pool.h"
+#include "../include/linked-list.h"
+
+#define POOL_OBJECTS 10000
+#define QUEUE_ROUNDS 100000
+#define POOL_THREADS 4
+
+typedef struct worker_t {
+	pool_t * pool;
+	int failures;
+} worker_t;
+
+static void * pool_worker(void * argument)
+{
+	worker_t * worker = argument;
+	size_t * objects[64];
+
+	for(int round = 0; round < 2000; round++) {
+		for(size_t i = 0; i < 64; i++) {
+			if(!(objects[i] = pool_alloc(worker->pool))) {
+				worker->failures++;
+				return NULL;
+			}
+
+			*objects[i] = (size_t) objects[i];
+		}
+
+		for(size_t i = 0; i < 64; i++) {
+			if(*objects[i] != (size_t) objects[i])
+				worker->failures++;
+
+			pool_free(worker->pool, objects[i]);
+		}
+	}
+
+	return NULL;
+}
+
+int main()
+{
+	static char * objects[POOL_OBJECTS];
+	pool_t pool;
+	pool_stats_t stats;
+
+	printf("[+] Generating pool...\n");
+
+	if(pool_init(&pool, 0) != POOL_SIZE_ERROR) {
+		fprintf(stderr, "Error: Created a pool of empty objects!\n");
+		return POOL_SIZE_ERROR;
+	}
+
+	if(pool_init(&pool, 40) != POOL_OK) {
+		fprintf(stderr, "Error: Could not create pool!\n");
+		return POOL_MEM_ERROR;
+	}
+
+	printf("[+] Allocating %d objects...\n", POOL_OBJECTS);
+
+	for(int i = 0; i < POOL_OBJECTS; i++) {
+		if(!(objects[i] = pool_alloc(&pool))) {
+			fprintf(stderr, "Error: Could not allocate from pool!\n");
+			return POOL_MEM_ERROR;
+		}
+
+		if((uintptr_t) objects[i] % _Alignof(max_align_t)) {
+			fprintf(stderr, "Error: Object %d is misaligned!\n", i);
+			return POOL_SIZE_ERROR;
+		}
+
+		memset(objects[i], i & 0xFF, 40);
+	}
+
+	for(int i = 0; i < POOL_OBJECTS; i++) {
+		for(int j = 0; j < 40; j++) {
+			if(objects[i][j] != (char) (i & 0xFF)) {
+				fprintf(stderr, "Error: Object %d overlaps another object!\n", i);
+				return POOL_MEM_ERROR;
+			}
+		}
+	}
+
+	pool_stats(&pool, &stats);
+
+	printf("[-] %zu live, %zu free, %zu total bytes...\n", stats.live_bytes, stats.free_bytes, stats.total_bytes);
+
+	if(stats.live_bytes != POOL_OBJECTS * pool.object_size || stats.live_bytes + stats.free_bytes != stats.total_bytes) {
+		fprintf(stderr, "Error: Pool counters do not match the allocated objects!\n");
+		return POOL_MEM_ERROR;
+	}
+
+	printf("[+] Freeing and reallocating every object...\n");
+
+	size_t total_bytes = stats.total_bytes;
+
+	for(int i = 0; i < POOL_OBJECTS; i++)
+		pool_free(&pool, objects[i]);
+
+	pool_stats(&pool, &stats);
+
+	if(stats.live_bytes != 0 || stats.total_bytes != total_bytes) {
+		fprintf(stderr, "Error: Freed objects are still counted as live!\n");
+		return POOL_MEM_ERROR;
+	}
+
+	for(int i = 0; i < POOL_OBJECTS; i++) {
+		if(!(objects[i] = pool_alloc(&pool))) {
+			fprintf(stderr, "Error: Could not allocate from pool!\n");
+			return POOL_MEM_ERROR;
+		}
+	}
+
+	pool_stats(&pool, &stats);
+
+	if(stats.total_bytes != total_bytes) {
+		fprintf(stderr, "Error: Pool grew instead of reusing freed objects!\n");
+		return POOL_MEM_ERROR;
+	}
+
+	printf("[+] Destroying pool...\n");
+
+	pool_destroy(&pool);
+
+	printf("[+] Generating a pool shared by %d threads...\n", POOL_THREADS);
+
+	pthread_t threads[POOL_THREADS];
+	worker_t workers[POOL_THREADS];
+
+	if(pool_init(&pool, sizeof(size_t)) != POOL_OK) {
+		fprintf(stderr, "Error: Could not create pool!\n");
+		return POOL_MEM_ERROR;
+	}
+
+	for(int i = 0; i < POOL_THREADS; i++) {
+		workers[i] = (worker_t) { .pool = &pool, .failures = 0 };
+		pthread_create(&threads[i], NULL, pool_worker, &workers[i]);
+	}
+
+	for(int i = 0; i < POOL_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+
+		if(workers[i].failures) {
+			fprintf(stderr, "Error: Thread %d saw %d corrupted objects!\n", i, workers[i].failures);
+			return POOL_MEM_ERROR;
+		}
+	}
+
+	pool_stats(&pool, &stats);
+
+	if(stats.live_bytes != 0) {
+		fprintf(stderr, "Error: %zu bytes still live after every thread freed its objects!\n", stats.live_bytes);
+		return POOL_MEM_ERROR;
+	}
+
+	pool_destroy(&pool);
+
+	printf("[+] Alternating between two pools %d generations apart...\n", POOL_CACHE_SLOTS);
+
+	pool_t other;
+
+	if(pool_init(&pool, sizeof(size_t)) != POOL_OK) {
+		fprintf(stderr, "Error: Could not create pool!\n");
+		return POOL_MEM_ERROR;
+	}
+
+	for(int i = 1; i < POOL_CACHE_SLOTS; i++) {
+		pool_init(&other, sizeof(size_t));
+		pool_destroy(&other);
+	}
+
+	if(pool_init(&other, sizeof(size_t)) != POOL_OK || other.generation - pool.generation != POOL_CACHE_SLOTS) {
+		fprintf(stderr, "Error: Could not create a second pool %d generations on!\n", POOL_CACHE_SLOTS);
+		return POOL_MEM_ERROR;
+	}
+
+	for(int i = 0; i < POOL_OBJECTS; i++) {
+		void * first = pool_alloc(&pool);
+		void * second = pool_alloc(&other);
+
+		pool_free(&pool, first);
+		pool_free(&other, second);
+	}
+
+	if(pool.depot_count || other.depot_count) {
+		fprintf(stderr, "Error: The pools evicted each other's free lists, leaving %zu and %zu objects in their depots!\n", pool.depot_count, other.depot_count);
+		return POOL_MEM_ERROR;
+	}
+
+	pool_destroy(&pool);
+	pool_destroy(&other);
+
+	printf("[+] Generating a list backed by a pool...\n");
+
+	llist_options_t options = { .pool = &pool };
+	llist_t list;
+	size_t value;
+
+	if(pool_init(&pool, llist_node_size(sizeof(size_t))) != POOL_OK || llist_init_opts(&list, sizeof(size_t), &options) != LIST_OK) {
+		fprintf(stderr, "Error: Could not create list!\n");
+		return POOL_MEM_ERROR;
+	}
+
+	printf("[+] Running %d queue rounds...\n", QUEUE_ROUNDS);
+
+	for(size_t i = 0; i < QUEUE_ROUNDS; i++) {
+		if(llist_push(&i, &list) != LIST_OK) {
+			fprintf(stderr, "Error: Could not push to list!\n");
+			return POOL_MEM_ERROR;
+		}
+
+		if(i % 4 == 3) {
+			for(size_t j = 0; j < 3; j++) {
+				if(llist_pop(&value, &list) != LIST_OK || value != i / 4 * 3 + j) {
+					fprintf(stderr, "Error: Unexpected value popped from list!\n");
+					return POOL_MEM_ERROR;
+				}
+			}
+		}
+	}
+
+	pool_stats(&pool, &stats);
+
+	printf("[-] %zu live, %zu free, %zu total bytes...\n", stats.live_bytes, stats.free_bytes, stats.total_bytes);
+
+	if(stats.live_bytes != (size_t) list.length * pool.object_size) {
+		fprintf(stderr, "Error: Pool counters do not match the list length!\n");
+		return POOL_MEM_ERROR;
+	}
+
+	printf("[+] Destroying list and pool...\n");
+
+	llist_destroy(&list);
+	pool_stats(&pool, &stats);
+
+	if(stats.live_bytes != 0) {
+		fprintf(stderr, "Error: Destroying the list left %zu bytes live!\n", stats.live_bytes);
+		return POOL_MEM_ERROR;
+	}
+
+	pool_destroy(&pool);
+
+	printf("[+] All tests complete, terminating...\n");
+
+	return 0;
+}
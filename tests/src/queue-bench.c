@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "../include/queue.h"
+#include "../include/linked-list.h"
+
+#define BENCH_OPS		((uint64_t) 10 << 20)
+#define QUEUE_CAPACITY	4096
+#define BATCH_SIZE		64
+
+typedef struct bench_t {
+	queue_t queue;
+	llist_t list;
+	pthread_mutex_t list_lock;
+	int mode;
+	uint64_t sum;
+} bench_t;
+
+enum { MODE_LIST, MODE_QUEUE, MODE_BATCH };
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void * producer(void * argument)
+{
+	bench_t * bench = argument;
+	uint64_t batch[BATCH_SIZE];
+
+	for(uint64_t i = 0; i < BENCH_OPS;) {
+		switch(bench->mode) {
+			case MODE_LIST: /* How llist_t is shared between threads today, with a lock held around each call */
+				pthread_mutex_lock(&bench->list_lock);
+				llist_push(&i, &bench->list);
+				pthread_mutex_unlock(&bench->list_lock);
+				i++;
+				break;
+			case MODE_QUEUE:
+				queue_push(&i, &bench->queue);
+				i++;
+				break;
+			case MODE_BATCH:
+				for(size_t j = 0; j < BATCH_SIZE; j++)
+					batch[j] = i + j;
+
+				queue_push_n(batch, BATCH_SIZE, &bench->queue);
+				i += BATCH_SIZE;
+				break;
+		}
+	}
+
+	return NULL;
+}
+
+static void * consumer(void * argument)
+{
+	bench_t * bench = argument;
+	uint64_t batch[BATCH_SIZE];
+	uint64_t value;
+
+	for(uint64_t i = 0; i < BENCH_OPS;) {
+		switch(bench->mode) {
+			case MODE_LIST:
+				pthread_mutex_lock(&bench->list_lock);
+
+				if(llist_pop(&value, &bench->list) == LIST_OK) {
+					bench->sum += value;
+					i++;
+				}
+
+				pthread_mutex_unlock(&bench->list_lock);
+
+				if(i % 1024 == 0)
+					sched_yield(); /* Lets the producer in when the list runs dry on a single core */
+				break;
+			case MODE_QUEUE:
+				queue_pop(&value, &bench->queue);
+				bench->sum += value;
+				i++;
+				break;
+			case MODE_BATCH:
+				for(size_t count = queue_pop_n(batch, BATCH_SIZE, &bench->queue), j = 0; j < count; j++, i++)
+					bench->sum += batch[j];
+				break;
+		}
+	}
+
+	return NULL;
+}
+
+static void bench_pair(const char * name, int mode)
+{
+	bench_t bench = { .mode = mode, .sum = 0 };
+	pthread_t threads[2];
+
+	if(llist_init(&bench.list, sizeof(uint64_t)) != LIST_OK || queue_init(&bench.queue, sizeof(uint64_t), QUEUE_CAPACITY) != QUEUE_OK) {
+		fprintf(stderr, "Error: Could not create queue!\n");
+		return;
+	}
+
+	pthread_mutex_init(&bench.list_lock, NULL);
+
+	double start = now_ns();
+
+	pthread_create(&threads[0], NULL, producer, &bench);
+	pthread_create(&threads[1], NULL, consumer, &bench);
+	pthread_join(threads[0], NULL);
+	pthread_join(threads[1], NULL);
+
+	double elapsed = now_ns() - start;
+
+	printf("[-] %-26s %8.2f Mops/s %8.2f ns/element (checksum %s)\n", name, BENCH_OPS / (elapsed / 1e3), elapsed / BENCH_OPS,
+		bench.sum == BENCH_OPS * (BENCH_OPS - 1) / 2 ? "ok" : "BAD");
+
+	pthread_mutex_destroy(&bench.list_lock);
+	queue_destroy(&bench.queue);
+	llist_destroy(&bench.list);
+}
+
+int main()
+{
+	printf("[+] Passing %lu elements from one producer to one consumer...\n", (unsigned long) BENCH_OPS);
+
+	bench_pair("llist_push/llist_pop", MODE_LIST);
+	bench_pair("queue_push/queue_pop", MODE_QUEUE);
+	bench_pair("queue_push_n/queue_pop_n", MODE_BATCH);
+
+	printf("[+] All benchmarks complete, terminating...\n");
+
+	return 0;
+}
@@ -0,0 +1,263 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "../include/queue.h"
+
+#define QUEUE_CAPACITY 1000
+#define QUEUE_THREADS 4
+#define THREAD_ELEMENTS 100000
+#define BATCH_SIZE 37
+
+typedef struct worker_t {
+	queue_t * queue;
+	int id;
+	int batched;
+	size_t popped;
+	uint64_t sum;
+	int failures;
+} worker_t;
+
+static void * producer(void * argument)
+{
+	worker_t * worker = argument;
+	uint64_t batch[BATCH_SIZE];
+
+	for(uint64_t i = 0; i < THREAD_ELEMENTS;) {
+		if(worker->batched) {
+			size_t count = 0;
+
+			while(count < BATCH_SIZE && i < THREAD_ELEMENTS)
+				batch[count++] = (uint64_t) worker->id * THREAD_ELEMENTS + i++;
+
+			if(queue_push_n(batch, count, worker->queue) != QUEUE_OK)
+				worker->failures++;
+		} else {
+			uint64_t value = (uint64_t) worker->id * THREAD_ELEMENTS + i++;
+
+			if(queue_push(&value, worker->queue) != QUEUE_OK)
+				worker->failures++;
+		}
+	}
+
+	return NULL;
+}
+
+static void * consumer(void * argument)
+{
+	worker_t * worker = argument;
+	uint64_t batch[BATCH_SIZE];
+	uint64_t last[QUEUE_THREADS];
+
+	for(int i = 0; i < QUEUE_THREADS; i++)
+		last[i] = UINT64_MAX;
+
+	for(;;) {
+		size_t count;
+
+		if(worker->batched) {
+			count = queue_pop_n(batch, BATCH_SIZE, worker->queue);
+		} else {
+			count = queue_pop(&batch[0], worker->queue) == QUEUE_OK;
+		}
+
+		if(count == 0)
+			return NULL;
+
+		for(size_t i = 0; i < count; i++) { /* Elements from any one producer must arrive in order */
+			uint64_t producer_id = batch[i] / THREAD_ELEMENTS;
+
+			if(last[producer_id] != UINT64_MAX && batch[i] <= last[producer_id])
+				worker->failures++;
+
+			last[producer_id] = batch[i];
+			worker->sum += batch[i];
+		}
+
+		worker->popped += count;
+	}
+}
+
+static int test_threads(int batched)
+{
+	pthread_t producers[QUEUE_THREADS], consumers[QUEUE_THREADS];
+	worker_t producer_workers[QUEUE_THREADS], consumer_workers[QUEUE_THREADS];
+	queue_t queue;
+	size_t popped = 0;
+	uint64_t sum = 0;
+	int failures = 0;
+
+	if(queue_init(&queue, sizeof(uint64_t), 64) != QUEUE_OK) {
+		fprintf(stderr, "Error: Could not create queue!\n");
+		return QUEUE_MEM_ERROR;
+	}
+
+	for(int i = 0; i < QUEUE_THREADS; i++) {
+		producer_workers[i] = (worker_t) { .queue = &queue, .id = i, .batched = batched };
+		consumer_workers[i] = (worker_t) { .queue = &queue, .id = i, .batched = batched };
+		pthread_create(&producers[i], NULL, producer, &producer_workers[i]);
+		pthread_create(&consumers[i], NULL, consumer, &consumer_workers[i]);
+	}
+
+	for(int i = 0; i < QUEUE_THREADS; i++) {
+		pthread_join(producers[i], NULL);
+		failures += producer_workers[i].failures;
+	}
+
+	queue_close(&queue);
+
+	for(int i = 0; i < QUEUE_THREADS; i++) {
+		pthread_join(consumers[i], NULL);
+		failures += consumer_workers[i].failures;
+		popped += consumer_workers[i].popped;
+		sum += consumer_workers[i].sum;
+	}
+
+	uint64_t total = (uint64_t) QUEUE_THREADS * THREAD_ELEMENTS;
+
+	if(failures || popped != total || sum != total * (total - 1) / 2) {
+		fprintf(stderr, "Error: Popped %zu elements summing to %lu with %d failures!\n", popped, (unsigned long) sum, failures);
+		return QUEUE_SIZE_ERROR;
+	}
+
+	queue_destroy(&queue);
+
+	return QUEUE_OK;
+}
+
+int main()
+{
+	queue_t queue;
+	uint64_t value, values[2048];
+
+	printf("[+] Generating queue...\n");
+
+	if(queue_init(&queue, sizeof(uint64_t), 0) != QUEUE_SIZE_ERROR || queue_init(&queue, 0, 16) != QUEUE_SIZE_ERROR) {
+		fprintf(stderr, "Error: Accepted an empty queue!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	if(queue_init(&queue, sizeof(uint64_t), QUEUE_CAPACITY) != QUEUE_OK || queue.mask + 1 != 1024) {
+		fprintf(stderr, "Error: Could not create queue!\n");
+		return QUEUE_MEM_ERROR;
+	}
+
+	printf("[+] Filling and draining the queue several times over...\n");
+
+	for(int lap = 0; lap < 5; lap++) {
+		for(value = 0; queue_try_push(&value, &queue) == QUEUE_OK; value++);
+
+		if(value != 1024 || queue_length(&queue) != 1024) {
+			fprintf(stderr, "Error: Queue filled after %lu elements!\n", (unsigned long) value);
+			return QUEUE_SIZE_ERROR;
+		}
+
+		for(uint64_t i = 0; i < 1024; i++) {
+			if(queue_try_pop(&value, &queue) != QUEUE_OK || value != i) {
+				fprintf(stderr, "Error: Popped %lu where %lu was expected!\n", (unsigned long) value, (unsigned long) i);
+				return QUEUE_SIZE_ERROR;
+			}
+		}
+
+		if(queue_try_pop(&value, &queue) != QUEUE_EMPTY) {
+			fprintf(stderr, "Error: Popped from an empty queue!\n");
+			return QUEUE_SIZE_ERROR;
+		}
+	}
+
+	printf("[+] Pushing and popping in batches...\n");
+
+	for(uint64_t i = 0; i < 2048; i++)
+		values[i] = i;
+
+	if(queue_try_push_n(values, 1000, &queue) != 1000 || queue_try_push_n(values + 1000, 1048, &queue) != 24 || queue_try_push_n(values, 1, &queue) != 0) {
+		fprintf(stderr, "Error: Batches did not stop at the queue's capacity!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	if(queue_try_pop_n(values, 10, &queue) != 10 || queue_try_pop_n(values + 10, 2048, &queue) != 1014 || queue_try_pop_n(values, 1, &queue) != 0) {
+		fprintf(stderr, "Error: Batches did not stop once the queue was empty!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	for(uint64_t i = 0; i < 1024; i++) {
+		if(values[i] != i) {
+			fprintf(stderr, "Error: Popped %lu where %lu was expected!\n", (unsigned long) values[i], (unsigned long) i);
+			return QUEUE_SIZE_ERROR;
+		}
+	}
+
+	printf("[+] Batching around a cell another thread is part way through...\n");
+
+	if(queue_try_push_n(values, 4, &queue) != 4) {
+		fprintf(stderr, "Error: Could not push a batch!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	queue.enqueue_pos++; /* A producer that claimed the next position and has not written it yet */
+
+	if(queue_try_pop_n(values, 8, &queue) != 4 || queue_try_pop_n(values, 8, &queue) != 0) {
+		fprintf(stderr, "Error: A batch pop did not stop at a cell still being written!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	__atomic_store_n((size_t *) (queue.cells + (queue.dequeue_pos & queue.mask) * queue.cell_width), queue.dequeue_pos + 1, __ATOMIC_RELEASE);
+
+	if(queue_try_pop(&value, &queue) != QUEUE_OK || queue_try_push_n(values, 2048, &queue) != 1024) {
+		fprintf(stderr, "Error: Could not refill the queue!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	queue.dequeue_pos++; /* A consumer that claimed the oldest element and has not read it yet */
+
+	if(queue_try_push_n(values, 8, &queue) != 0) {
+		fprintf(stderr, "Error: A batch push did not stop at a cell still being read!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	__atomic_store_n((size_t *) (queue.cells + ((queue.dequeue_pos - 1) & queue.mask) * queue.cell_width), queue.dequeue_pos - 1 + queue.mask + 1, __ATOMIC_RELEASE);
+
+	if(queue_try_push_n(values, 8, &queue) != 1 || queue_try_pop_n(values, 2048, &queue) != 1024) {
+		fprintf(stderr, "Error: Batches did not resume once the cells were handed over!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	printf("[+] Closing the queue...\n");
+
+	value = 7;
+
+	if(queue_push(&value, &queue) != QUEUE_OK) {
+		fprintf(stderr, "Error: Could not push to the queue!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	queue_close(&queue);
+
+	if(queue_push(&value, &queue) != QUEUE_CLOSED || queue_push_n(values, 4, &queue) != QUEUE_CLOSED) {
+		fprintf(stderr, "Error: Pushed to a closed queue!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	if(queue_pop(&value, &queue) != QUEUE_OK || value != 7 || queue_pop(&value, &queue) != QUEUE_CLOSED || queue_pop_n(values, 4, &queue) != 0) {
+		fprintf(stderr, "Error: A closed queue was not drained before reporting it was closed!\n");
+		return QUEUE_SIZE_ERROR;
+	}
+
+	printf("[+] Destroying queue...\n");
+
+	queue_destroy(&queue);
+
+	printf("[+] Running %d producers and %d consumers one element at a time...\n", QUEUE_THREADS, QUEUE_THREADS);
+
+	if(test_threads(0) != QUEUE_OK)
+		return QUEUE_SIZE_ERROR;
+
+	printf("[+] Running %d producers and %d consumers in batches of %d...\n", QUEUE_THREADS, QUEUE_THREADS, BATCH_SIZE);
+
+	if(test_threads(1) != QUEUE_OK)
+		return QUEUE_SIZE_ERROR;
+
+	printf("[+] All tests complete, terminating...\n");
+
+	return 0;
+}
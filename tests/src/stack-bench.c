@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "../include/stack.h"
+
+#define OPS_PER_THREAD	200000
+#define MAX_THREADS		64
+#define PRELOAD			1024
+#define CHURN_OPS		2000000
+#define CHURN_LENGTH	(size_t) 4096
+#define FRAME_WIDTH		64
+#define FRAME_RUN		4096
+#define FRAME_ROUNDS	500
+#define GROWTH_PUSHES	((size_t) 8 << 20)
+
+typedef struct worker_t {
+	stack_t * stack;
+	size_t empty;
+} worker_t;
+
+static size_t realloc_calls = 0;
+
+void * __real_realloc(void * pointer, size_t size);
+
+/* Linked with --wrap=realloc so every resize made by the stack is counted */
+void * __wrap_realloc(void * pointer, size_t size)
+{
+	__atomic_fetch_add(&realloc_calls, 1, __ATOMIC_RELAXED);
+
+	return __real_realloc(pointer, size);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Work queue pattern: every thread pops a task and pushes a new one in its place */
+static void * bench_worker(void * argument)
+{
+	worker_t * worker = argument;
+	uint64_t task = 0;
+
+	for(size_t i = 0; i < OPS_PER_THREAD; i++) {
+		if(stack_pop(worker->stack, &task) != STACK_OK)
+			worker->empty++;
+
+		task++;
+		stack_push(worker->stack, &task);
+	}
+
+	return NULL;
+}
+
+static double bench_stack(int lock_free, int nthreads)
+{
+	stack_options_t options = { .lock_free = lock_free };
+	pthread_t threads[MAX_THREADS];
+	worker_t workers[MAX_THREADS];
+	stack_t stack;
+
+	if(stack_init_opts(&stack, sizeof(uint64_t), &options) != STACK_OK) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return 0;
+	}
+
+	for(uint64_t i = 0; i < PRELOAD; i++)
+		stack_push(&stack, &i);
+
+	double start = now_ns();
+
+	for(int t = 0; t < nthreads; t++) {
+		workers[t] = (worker_t) { .stack = &stack, .empty = 0 };
+		pthread_create(&threads[t], NULL, bench_worker, &workers[t]);
+	}
+
+	for(int t = 0; t < nthreads; t++)
+		pthread_join(threads[t], NULL);
+
+	double elapsed = now_ns() - start;
+
+	stack_destroy(&stack);
+
+	return 2.0 * nthreads * OPS_PER_THREAD / (elapsed / 1e3);
+}
+
+/* Push and pop across a power of two boundary, which made the old halve at half full policy reallocate every time */
+static void bench_churn(const char * name, size_t shrink_ratio)
+{
+	stack_options_t options = { .min_capacity = 16, .shrink_ratio = shrink_ratio };
+	uint64_t value = 0;
+	stack_t stack;
+
+	if(stack_init_opts(&stack, sizeof(uint64_t), &options) != STACK_OK) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return;
+	}
+
+	while(stack.length < CHURN_LENGTH)
+		stack_push(&stack, &value);
+
+	size_t reallocs = realloc_calls;
+	double start = now_ns();
+
+	for(size_t i = 0; i < CHURN_OPS; i++) {
+		stack_push(&stack, &value);
+		stack_pop(&stack, &value);
+	}
+
+	double elapsed = now_ns() - start;
+
+	printf("[-] %-24s %8.2f ns/op %10zu reallocs\n", name, elapsed / (2.0 * CHURN_OPS), realloc_calls - reallocs);
+
+	stack_destroy(&stack);
+}
+
+/* Parser pattern: push a run of fixed width frames and pop it again, one element per call or one run per call */
+static void bench_frames(void)
+{
+	static unsigned char frames[FRAME_RUN][FRAME_WIDTH];
+	stack_t stack;
+	double start, single, bulk, emplace;
+
+	if(stack_init(&stack, FRAME_WIDTH) != STACK_OK || stack_reserve(&stack, FRAME_RUN) != STACK_OK) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return;
+	}
+
+	memset(frames, 0xA5, sizeof(frames));
+
+	start = now_ns();
+
+	for(int round = 0; round < FRAME_ROUNDS; round++) {
+		for(int i = 0; i < FRAME_RUN; i++)
+			stack_push(&stack, frames[i]);
+
+		for(int i = FRAME_RUN - 1; i >= 0; i--)
+			stack_pop(&stack, frames[i]);
+	}
+
+	single = (now_ns() - start) / (2.0 * FRAME_ROUNDS * FRAME_RUN);
+	start = now_ns();
+
+	for(int round = 0; round < FRAME_ROUNDS; round++) {
+		stack_push_n(&stack, frames, FRAME_RUN);
+		stack_pop_n(&stack, frames, FRAME_RUN);
+	}
+
+	bulk = (now_ns() - start) / (2.0 * FRAME_ROUNDS * FRAME_RUN);
+	start = now_ns();
+
+	for(int round = 0; round < FRAME_ROUNDS; round++) {
+		for(int i = 0; i < FRAME_RUN; i++)
+			memset(stack_emplace(&stack), i, FRAME_WIDTH);
+
+		stack_pop_n(&stack, frames, FRAME_RUN);
+	}
+
+	emplace = (now_ns() - start) / (2.0 * FRAME_ROUNDS * FRAME_RUN);
+
+	printf("[-] push/pop          %8.2f ns/frame\n", single);
+	printf("[-] push_n/pop_n      %8.2f ns/frame (%.2fx)\n", bulk, single / bulk);
+	printf("[-] emplace/pop_n     %8.2f ns/frame (%.2fx)\n", emplace, single / emplace);
+
+	stack_destroy(&stack);
+}
+
+/* Grow a large stack from empty, tracking the slowest single push */
+static void bench_growth(const char * name, int segmented)
+{
+	stack_options_t options = { .segmented = segmented };
+	unsigned char frame[32] = { 0 };
+	double worst = 0;
+	stack_t stack;
+
+	if(stack_init_opts(&stack, sizeof(frame), &options) != STACK_OK) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return;
+	}
+
+	double start = now_ns();
+
+	for(size_t i = 0; i < GROWTH_PUSHES; i++) {
+		double before = now_ns();
+
+		stack_push(&stack, frame);
+
+		if(now_ns() - before > worst)
+			worst = now_ns() - before;
+	}
+
+	double elapsed = now_ns() - start;
+
+	printf("[-] %-10s %8.2f ns/push %10.3f ms worst push\n", name, elapsed / GROWTH_PUSHES, worst / 1e6);
+
+	stack_destroy(&stack);
+}
+
+int main(int argc, char ** argv)
+{
+	int max_threads = argc > 1 ? atoi(argv[1]) : MAX_THREADS;
+
+	if(max_threads < 1 || max_threads > MAX_THREADS)
+		max_threads = MAX_THREADS;
+
+	printf("[+] Pushing and popping %d times around a length of %zu...\n", CHURN_OPS, CHURN_LENGTH);
+
+	bench_churn("halve at 1/2 full", 2);
+	bench_churn("halve at 1/4 full", STACK_SHRINK_RATIO);
+
+	printf("[+] Growing a stack to %zu elements of 32 bytes...\n", GROWTH_PUSHES);
+
+	bench_growth("array", 0);
+	bench_growth("segmented", 1);
+
+	printf("[+] Moving runs of %d frames of %d bytes...\n", FRAME_RUN, FRAME_WIDTH);
+
+	bench_frames();
+
+	printf("[+] Running %d pop/push pairs per thread on a stack of %d tasks...\n", OPS_PER_THREAD, PRELOAD);
+	printf("[-] %8s %14s %16s %8s\n", "threads", "locked Mops/s", "lock-free Mops/s", "ratio");
+
+	for(int nthreads = 1; nthreads <= max_threads; nthreads <<= 1) {
+		double locked = bench_stack(0, nthreads);
+		double lock_free = bench_stack(1, nthreads);
+
+		printf("[-] %8d %14.2f %16.2f %7.2fx\n", nthreads, locked, lock_free, lock_free / locked);
+	}
+
+	printf("[+] All benchmarks complete, terminating...\n");
+
+	return 0;
+}
\ No newline at end of file
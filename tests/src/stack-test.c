@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "../include/stack.h"
+
+#define STACK_ELEMENTS 100000
+#define STACK_THREADS 8
+#define THREAD_ELEMENTS 20000
+
+typedef struct worker_t {
+	stack_t * stack;
+	int id;
+	long popped;
+	int failures;
+} worker_t;
+
+static void * stack_worker(void * argument)
+{
+	worker_t * worker = argument;
+	long value;
+
+	for(long i = 0; i < THREAD_ELEMENTS; i++) {
+		value = worker->id * (long) THREAD_ELEMENTS + i;
+
+		if(stack_push(worker->stack, &value) != STACK_OK)
+			worker->failures++;
+
+		if(i % 2 && stack_pop(worker->stack, &value) == STACK_OK)
+			worker->popped += value;
+	}
+
+	return NULL;
+}
+
+static int test_stack(const stack_options_t * options)
+{
+	stack_t stack;
+	long value;
+
+	if(stack_init_opts(&stack, sizeof(long), options) != STACK_OK) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Pushing and popping %d elements...\n", STACK_ELEMENTS);
+
+	for(long i = 0; i < STACK_ELEMENTS; i++) {
+		if(stack_push(&stack, &i) != STACK_OK) {
+			fprintf(stderr, "Error: Could not push to stack!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	if(stack.length != STACK_ELEMENTS) {
+		fprintf(stderr, "Error: Stack length is %zu after %d pushes!\n", stack.length, STACK_ELEMENTS);
+		return SIZE_ERROR;
+	}
+
+	for(long i = STACK_ELEMENTS - 1; i >= 0; i--) {
+		if(stack_pop(&stack, &value) != STACK_OK || value != i) {
+			fprintf(stderr, "Error: Popped %ld where %ld was expected!\n", value, i);
+			return SIZE_ERROR;
+		}
+	}
+
+	if(stack_pop(&stack, &value) != SIZE_ERROR || stack.length != 0) {
+		fprintf(stderr, "Error: Popped from an empty stack!\n");
+		return SIZE_ERROR;
+	}
+
+	printf("[+] Running %d threads pushing and popping...\n", STACK_THREADS);
+
+	pthread_t threads[STACK_THREADS];
+	worker_t workers[STACK_THREADS];
+	long total = 0;
+
+	for(int i = 0; i < STACK_THREADS; i++) {
+		workers[i] = (worker_t) { .stack = &stack, .id = i, .popped = 0, .failures = 0 };
+		pthread_create(&threads[i], NULL, stack_worker, &workers[i]);
+	}
+
+	for(int i = 0; i < STACK_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+
+		if(workers[i].failures) {
+			fprintf(stderr, "Error: Thread %d could not push %d elements!\n", i, workers[i].failures);
+			return MEM_ERROR;
+		}
+
+		total += workers[i].popped;
+	}
+
+	while(stack_pop(&stack, &value) == STACK_OK)
+		total += value;
+
+	long expected = (long) STACK_THREADS * THREAD_ELEMENTS * (STACK_THREADS * THREAD_ELEMENTS - 1) / 2;
+
+	if(total != expected) {
+		fprintf(stderr, "Error: Popped elements sum to %ld instead of %ld!\n", total, expected);
+		return SIZE_ERROR;
+	}
+
+	printf("[+] Destroying stack...\n");
+
+	stack_destroy(&stack);
+
+	return STACK_OK;
+}
+
+static int test_capacity(void)
+{
+	stack_options_t options = { .min_capacity = 16 };
+	stack_options_t oversized = { .min_capacity = SIZE_MAX / sizeof(long) + 3 };
+	stack_t stack;
+	long value;
+
+	if(stack_init_opts(&stack, sizeof(long), &oversized) != MEM_ERROR) {
+		fprintf(stderr, "Error: Created a stack with an unrepresentable capacity!\n");
+		return SIZE_ERROR;
+	}
+
+	if(stack_init_opts(&stack, sizeof(long), &options) != STACK_OK || stack.allocated_blocks != 16) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Growing to 64 elements and popping back down...\n");
+
+	for(long i = 0; i < 64; i++)
+		stack_push(&stack, &i);
+
+	size_t expected[65] = { 0 };
+
+	for(size_t length = 0; length <= 64; length++) /* Halves on reaching a quarter full, never below the floor */
+		expected[length] = length > 16 ? 64 : length > 8 ? 32 : 16;
+
+	for(long i = 63; i >= 0; i--) {
+		if(stack_pop(&stack, &value) != STACK_OK || value != i || stack.allocated_blocks != expected[stack.length]) {
+			fprintf(stderr, "Error: Capacity %zu at length %zu, expected %zu!\n", stack.allocated_blocks, stack.length, expected[stack.length]);
+			return SIZE_ERROR;
+		}
+	}
+
+	printf("[+] Oscillating around a power of two...\n");
+
+	for(long i = 0; i < 32; i++)
+		stack_push(&stack, &i);
+
+	for(int i = 0; i < 1000; i++) {
+		stack_push(&stack, &value);
+		stack_pop(&stack, &value);
+
+		if(stack.allocated_blocks != 64) {
+			fprintf(stderr, "Error: Capacity changed to %zu while oscillating!\n", stack.allocated_blocks);
+			return SIZE_ERROR;
+		}
+	}
+
+	printf("[+] Reserving capacity and shrinking to fit...\n");
+
+	if(stack_reserve(&stack, 100000) != STACK_OK || stack.allocated_blocks != 100000) {
+		fprintf(stderr, "Error: Could not reserve capacity!\n");
+		return MEM_ERROR;
+	}
+
+	if(stack_reserve(&stack, SIZE_MAX / sizeof(long) + 3) != MEM_ERROR || stack.allocated_blocks != 100000) {
+		fprintf(stderr, "Error: Reserved an unrepresentable capacity!\n");
+		return SIZE_ERROR;
+	}
+
+	while(stack_pop(&stack, &value) == STACK_OK);
+
+	if(stack.allocated_blocks != 100000) {
+		fprintf(stderr, "Error: Reserved capacity was released by popping!\n");
+		return SIZE_ERROR;
+	}
+
+	for(long i = 0; i < 20; i++)
+		stack_push(&stack, &i);
+
+	if(stack_shrink_to_fit(&stack) != STACK_OK || stack.allocated_blocks != 20) {
+		fprintf(stderr, "Error: Shrinking left a capacity of %zu!\n", stack.allocated_blocks);
+		return SIZE_ERROR;
+	}
+
+	for(long i = 19; i >= 0; i--) {
+		if(stack_pop(&stack, &value) != STACK_OK || value != i) {
+			fprintf(stderr, "Error: Popped %ld where %ld was expected!\n", value, i);
+			return SIZE_ERROR;
+		}
+	}
+
+	if(stack_shrink_to_fit(&stack) != STACK_OK || stack.allocated_blocks != 16) {
+		fprintf(stderr, "Error: Shrinking went below the floor!\n");
+		return SIZE_ERROR;
+	}
+
+	stack_destroy(&stack);
+
+	options.shrink_ratio = 1;
+
+	if(stack_init_opts(&stack, sizeof(long), &options) != SIZE_ERROR) {
+		fprintf(stderr, "Error: Accepted a shrink ratio that would thrash!\n");
+		return SIZE_ERROR;
+	}
+
+	return STACK_OK;
+}
+
+static int test_segmented(void)
+{
+	static long * slots[STACK_ELEMENTS];
+	static long popped[STACK_ELEMENTS];
+	stack_options_t options = { .segmented = 1, .min_capacity = 16 };
+	stack_t stack;
+	long value;
+
+	if(stack_init_opts(&stack, sizeof(long), &options) != STACK_OK || stack.allocated_blocks != 16) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Emplacing %d elements across segments...\n", STACK_ELEMENTS);
+
+	for(long i = 0; i < STACK_ELEMENTS; i++) {
+		if(!(slots[i] = stack_emplace(&stack))) {
+			fprintf(stderr, "Error: Could not emplace an element!\n");
+			return MEM_ERROR;
+		}
+
+		*slots[i] = i;
+	}
+
+	for(long i = 0; i < STACK_ELEMENTS; i++) { /* Growth must not have moved anything */
+		if(*slots[i] != i) {
+			fprintf(stderr, "Error: Element %ld moved or changed to %ld!\n", i, *slots[i]);
+			return SIZE_ERROR;
+		}
+	}
+
+	if(stack.allocated_blocks != 16 * ((1 << 13) - 1) || stack_peek_ref(&stack) != slots[STACK_ELEMENTS - 1]) {
+		fprintf(stderr, "Error: Capacity %zu after %d elements!\n", stack.allocated_blocks, STACK_ELEMENTS);
+		return SIZE_ERROR;
+	}
+
+	if(stack_pop_n(&stack, popped, STACK_ELEMENTS) != STACK_OK || stack.allocated_blocks != 16) {
+		fprintf(stderr, "Error: Capacity %zu after popping every element!\n", stack.allocated_blocks);
+		return SIZE_ERROR;
+	}
+
+	for(long i = 0; i < STACK_ELEMENTS; i++) {
+		if(popped[i] != i) {
+			fprintf(stderr, "Error: Popped %ld where %ld was expected!\n", popped[i], i);
+			return SIZE_ERROR;
+		}
+	}
+
+	printf("[+] Oscillating around a segment boundary...\n");
+
+	for(long i = 0; i < 48; i++)
+		stack_push(&stack, &i);
+
+	for(int i = 0; i < 1000; i++) {
+		stack_push(&stack, &value);
+		stack_pop(&stack, &value);
+
+		if(stack.allocated_blocks != 112) {
+			fprintf(stderr, "Error: Capacity changed to %zu while oscillating!\n", stack.allocated_blocks);
+			return SIZE_ERROR;
+		}
+	}
+
+	printf("[+] Reserving capacity and shrinking to fit...\n");
+
+	if(stack_reserve(&stack, STACK_ELEMENTS) != STACK_OK || stack.allocated_blocks < STACK_ELEMENTS) {
+		fprintf(stderr, "Error: Could not reserve capacity!\n");
+		return MEM_ERROR;
+	}
+
+	stack_push(&stack, &value);
+
+	if(stack_shrink_to_fit(&stack) != STACK_OK || stack.allocated_blocks != 112) {
+		fprintf(stderr, "Error: Shrinking left a capacity of %zu!\n", stack.allocated_blocks);
+		return SIZE_ERROR;
+	}
+
+	stack_destroy(&stack);
+
+	printf("[+] Shrinking by halves without dropping live elements...\n");
+
+	options = (stack_options_t) { .segmented = 1, .min_capacity = 4, .shrink_ratio = 2 };
+
+	if(stack_init_opts(&stack, sizeof(long), &options) != STACK_OK) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return MEM_ERROR;
+	}
+
+	for(long i = 0; i < 12; i++)
+		stack_push(&stack, &i);
+
+	for(long i = 11; i >= 0; i--) {
+		if(stack_pop(&stack, &value) != STACK_OK || value != i) {
+			fprintf(stderr, "Error: Popped %ld where %ld was expected!\n", value, i);
+			return SIZE_ERROR;
+		}
+
+		if(stack.allocated_blocks < stack.length) {
+			fprintf(stderr, "Error: Capacity %zu is below the length %zu!\n", stack.allocated_blocks, stack.length);
+			return SIZE_ERROR;
+		}
+	}
+
+	stack_destroy(&stack);
+
+	return STACK_OK;
+}
+
+static int test_bulk(const stack_options_t * options)
+{
+	static long values[STACK_ELEMENTS], popped[STACK_ELEMENTS + 1];
+	stack_t stack;
+	long value;
+
+	if(stack_init_opts(&stack, sizeof(long), options) != STACK_OK) {
+		fprintf(stderr, "Error: Could not create stack!\n");
+		return MEM_ERROR;
+	}
+
+	for(long i = 0; i < STACK_ELEMENTS; i++)
+		values[i] = i;
+
+	printf("[-] Pushing %d elements in one call...\n", STACK_ELEMENTS);
+
+	if(stack_push_n(&stack, values, STACK_ELEMENTS) != STACK_OK || stack.length != STACK_ELEMENTS) {
+		fprintf(stderr, "Error: Could not push %d elements!\n", STACK_ELEMENTS);
+		return MEM_ERROR;
+	}
+
+	if(stack_pop(&stack, &value) != STACK_OK || value != STACK_ELEMENTS - 1 || stack_push(&stack, &value) != STACK_OK) {
+		fprintf(stderr, "Error: The last element pushed is not on top!\n");
+		return SIZE_ERROR;
+	}
+
+	if(stack_pop_n(&stack, popped, STACK_ELEMENTS + 1) != SIZE_ERROR || stack.length != STACK_ELEMENTS) {
+		fprintf(stderr, "Error: Popped more elements than were stored!\n");
+		return SIZE_ERROR;
+	}
+
+	printf("[-] Popping them back in runs of 1000...\n");
+
+	for(long i = STACK_ELEMENTS; i > 0; i -= 1000) {
+		if(stack_pop_n(&stack, popped + i - 1000, 1000) != STACK_OK) {
+			fprintf(stderr, "Error: Could not pop a run of elements!\n");
+			return SIZE_ERROR;
+		}
+	}
+
+	for(long i = 0; i < STACK_ELEMENTS; i++) {
+		if(popped[i] != i) {
+			fprintf(stderr, "Error: Popped %ld where %ld was expected!\n", popped[i], i);
+			return SIZE_ERROR;
+		}
+	}
+
+	if(stack.length != 0 || stack_pop_n(&stack, popped, 0) != STACK_OK || stack_push_n(&stack, values, 0) != STACK_OK || stack.length != 0) {
+		fprintf(stderr, "Error: Empty runs changed the stack!\n");
+		return SIZE_ERROR;
+	}
+
+	if(options->lock_free) {
+		if(stack_peek_ref(&stack) || stack_emplace(&stack)) {
+			fprintf(stderr, "Error: Lock-free stacks handed out element references!\n");
+			return SIZE_ERROR;
+		}
+	} else {
+		printf("[-] Constructing elements in place...\n");
+
+		if(stack_peek_ref(&stack)) {
+			fprintf(stderr, "Error: Peeked at an empty stack!\n");
+			return SIZE_ERROR;
+		}
+
+		for(long i = 0; i < STACK_ELEMENTS; i++) {
+			long * slot = stack_emplace(&stack);
+
+			if(!slot) {
+				fprintf(stderr, "Error: Could not emplace an element!\n");
+				return MEM_ERROR;
+			}
+
+			*slot = i;
+
+			if(stack_peek_ref(&stack) != slot) {
+				fprintf(stderr, "Error: The emplaced element is not on top!\n");
+				return SIZE_ERROR;
+			}
+		}
+
+		*(long *) stack_peek_ref(&stack) = -1;
+
+		if(stack_pop(&stack, &value) != STACK_OK || value != -1 || stack_pop(&stack, &value) != STACK_OK || value != STACK_ELEMENTS - 2) {
+			fprintf(stderr, "Error: Elements written in place were lost!\n");
+			return SIZE_ERROR;
+		}
+	}
+
+	stack_destroy(&stack);
+
+	return STACK_OK;
+}
+
+int main()
+{
+	stack_options_t options = { .lock_free = 0 };
+
+	printf("[+] Testing stack capacity policy...\n");
+
+	if(test_capacity() != STACK_OK)
+		return SIZE_ERROR;
+
+	printf("[+] Testing a locked stack...\n");
+
+	if(test_stack(&options) != STACK_OK)
+		return SIZE_ERROR;
+
+	printf("[+] Testing bulk operations on a locked stack...\n");
+
+	if(test_bulk(&options) != STACK_OK)
+		return SIZE_ERROR;
+
+	printf("[+] Testing a segmented stack...\n");
+
+	options.segmented = 1;
+
+	if(test_segmented() != STACK_OK || test_stack(&options) != STACK_OK || test_bulk(&options) != STACK_OK)
+		return SIZE_ERROR;
+
+	options.segmented = 0;
+	options.lock_free = 1;
+
+	stack_t stack;
+
+	if(stack_init_opts(&stack, sizeof(long), &options) != STACK_OK || stack_reserve(&stack, 5000) != STACK_OK || stack_shrink_to_fit(&stack) != STACK_OK) {
+		fprintf(stderr, "Error: Could not reserve lock-free stack capacity!\n");
+		return MEM_ERROR;
+	}
+
+	stack_destroy(&stack);
+
+	printf("[+] Testing a lock-free stack...\n");
+
+	if(test_stack(&options) != STACK_OK)
+		return SIZE_ERROR;
+
+	printf("[+] Testing bulk operations on a lock-free stack...\n");
+
+	if(test_bulk(&options) != STACK_OK)
+		return SIZE_ERROR;
+
+	printf("[+] All tests complete, terminating...\n");
+
+	return 0;
+}
\ No newline at end of file
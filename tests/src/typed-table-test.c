@@ -0,0 +1,107 @@
+#include <stdio.h>
+
+#include "../include/typed-table.h"
+
+#define STRESS_KEYS 100000
+
+typedef struct point_t {
+	int x;
+	int y;
+} point_t;
+
+static inline size_t point_hash(point_t point)
+{
+	return htkey_hash_u64(((uint64_t) (uint32_t) point.x << 32) | (uint32_t) point.y);
+}
+
+#define POINT_EQUAL(first, second) ((first).x == (second).x && (first).y == (second).y)
+
+HT_DEFINE(u64map, uint64_t, uint64_t, htkey_hash_u64, htkey_equal_u64)
+HT_DEFINE(pointmap, point_t, double, point_hash, POINT_EQUAL)
+
+int main()
+{
+	u64map_t map;
+	pointmap_t points;
+	uint64_t value;
+
+	printf("[+] Generating a uint64_t to uint64_t table...\n");
+
+	if(u64map_init(&map, 16) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	printf("[+] Inserting %d values to force growth...\n", STRESS_KEYS);
+
+	for(uint64_t i = 0; i < STRESS_KEYS; i++) {
+		if(u64map_insert(&map, i * 0x9E3779B97F4A7C15ULL, i) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not insert element to table!\n");
+			return MEM_ERROR;
+		}
+	}
+
+	if(map.entry_count != STRESS_KEYS || map.bucket_count < STRESS_KEYS / 2) {
+		fprintf(stderr, "Error: Table holds %zu entries in %zu buckets after %d inserts!\n", map.entry_count, map.bucket_count, STRESS_KEYS);
+		return INVALID_ENTRY;
+	}
+
+	printf("[+] Replacing, deleting and verifying values...\n");
+
+	for(uint64_t i = 0; i < STRESS_KEYS; i += 2)
+		u64map_insert(&map, i * 0x9E3779B97F4A7C15ULL, i + 1);
+
+	for(uint64_t i = 0; i < STRESS_KEYS; i += 3) {
+		if(u64map_delete(&map, i * 0x9E3779B97F4A7C15ULL) != TABLE_OK) {
+			fprintf(stderr, "Error: Could not delete key %lu!\n", (unsigned long) i);
+			return INVALID_ENTRY;
+		}
+	}
+
+	for(uint64_t i = 0; i < STRESS_KEYS; i++) {
+		int status = u64map_lookup(&map, i * 0x9E3779B97F4A7C15ULL, &value);
+
+		if(i % 3 == 0 ? status != INVALID_ENTRY : status != TABLE_OK || value != (i % 2 ? i : i + 1)) {
+			fprintf(stderr, "Error: Unexpected result for key %lu!\n", (unsigned long) i);
+			return INVALID_ENTRY;
+		}
+	}
+
+	if(u64map_delete(&map, 0) != INVALID_ENTRY || u64map_lookup(&map, STRESS_KEYS, NULL) != INVALID_ENTRY) {
+		fprintf(stderr, "Error: Found a key that was never inserted!\n");
+		return INVALID_ENTRY;
+	}
+
+	uint64_t * ref = u64map_lookup_ref(&map, 1 * 0x9E3779B97F4A7C15ULL);
+
+	if(!ref || *ref != 1 || (*ref = 42, u64map_lookup(&map, 1 * 0x9E3779B97F4A7C15ULL, &value)) != TABLE_OK || value != 42) {
+		fprintf(stderr, "Error: Could not update a value through its reference!\n");
+		return INVALID_ENTRY;
+	}
+
+	u64map_destroy(&map);
+
+	printf("[+] Using structures as keys...\n");
+
+	if(pointmap_init(&points, 1) != TABLE_OK) {
+		fprintf(stderr, "Error: Could not create table!\n");
+		return MEM_ERROR;
+	}
+
+	for(int x = -50; x < 50; x++)
+		for(int y = -50; y < 50; y++)
+			pointmap_insert(&points, (point_t) { x, y }, x * 0.5 + y);
+
+	double distance;
+
+	if(points.entry_count != 10000 || pointmap_lookup(&points, (point_t) { -3, 7 }, &distance) != TABLE_OK || distance != 5.5 || pointmap_lookup(&points, (point_t) { 50, 0 }, NULL) != INVALID_ENTRY) {
+		fprintf(stderr, "Error: Structure keys were not stored or compared correctly!\n");
+		return INVALID_ENTRY;
+	}
+
+	pointmap_destroy(&points);
+
+	printf("[+] All tests complete, terminating...\n");
+
+	return 0;
+}